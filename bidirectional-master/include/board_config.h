@@ -32,6 +32,114 @@
 #define LORA_SYNC_WORD 0x12             // Private network sync word
 #define LORA_TX_POWER 17                // TX power in dBm (2-20)
 
+// Duty cycle: share of airtime the radio may use, per mille, averaged over
+// DUTY_CYCLE_WINDOW_S (EU 433 MHz SRD band: 10%). Frames over the budget wait.
+#define DUTY_CYCLE_PERMILLE 100
+#define DUTY_CYCLE_WINDOW_S 3600
+
+// Listen before talk: CAD before each transmission, random backoff while
+// the channel is busy, frame dropped after LBT_MAX_WAIT_MS of busy channel
+#define LBT_ENABLED 1
+#define LBT_MAX_WAIT_MS 2000
+
+// RX ring buffer (packets held between the DIO0 ISR and loop())
+#ifdef BOARD_ARDUINO_UNO
+    #define LORA_RX_RING_SLOTS 1        // 2KB RAM: one packet waits for loop()
+#else
+    #define LORA_RX_RING_SLOTS 8
+#endif
+
+// Addressing (set per board via build flags, e.g. -DNODE_ADDRESS=0x10 -DPEER_ADDRESS=0x11)
+#ifndef NODE_ADDRESS
+    #define NODE_ADDRESS 0x00   // 0x00 = unaddressed frames, accept all traffic
+#endif
+
+#ifndef PEER_ADDRESS
+    #define PEER_ADDRESS 0xFF   // Destination of outgoing messages, the one ARQ peer (0xFF = broadcast)
+#endif
+
+// Sliding-window ARQ (frames awaiting ACK, each holds a frame copy). The
+// Uno stores frames only as large as it sends: a sensor response, or text
+// up to ARQ_FRAME_SIZE - MSG_MAX_HEADER_SIZE - MSG_MAX_TRAILER_SIZE bytes.
+#ifdef BOARD_ARDUINO_UNO
+    #define ARQ_WINDOW_SIZE 2
+    #define ARQ_FRAME_SIZE (MSG_MAX_HEADER_SIZE + MSG_SENSOR_RESPONSE_MAX_PAYLOAD + MSG_MAX_TRAILER_SIZE)
+#else
+    #define ARQ_WINDOW_SIZE 8
+#endif
+
+// RX inbox (decoded frames waiting for the state machine, one full frame each)
+#define RX_INBOX_SLOTS 8
+
+// Optional features, compiled out where RAM is short. The Uno keeps the
+// core link (ARQ, delayed ACKs, duplicate filter, duty cycle, LBT) and
+// handles frames straight from the RX ring instead of an inbox.
+#ifdef BOARD_ARDUINO_UNO
+    #define RX_INBOX_ENABLED 0
+    #define STREAM_ENABLED 0
+    #define POLL_ENABLED 0
+    #define FRAGMENT_ENABLED 0
+    #define ADR_ENABLED 0
+#else
+    #define RX_INBOX_ENABLED 1
+    #define STREAM_ENABLED 1
+    #define POLL_ENABLED 1
+    #define FRAGMENT_ENABLED 1
+    #define ADR_ENABLED 1
+#endif
+
+// TX priority queue: window frames are queued by reference, only ACKs and
+// streamed readings are copied, so slots stay small (window size plus room
+// for an ACK, a poll reply and one reading per streamed sensor)
+#if STREAM_ENABLED
+    #define TX_QUEUE_SLOTS (ARQ_WINDOW_SIZE + 5)
+    #define TX_QUEUE_CLASS_DEPTH (ARQ_WINDOW_SIZE + 4)
+#else
+    #define TX_QUEUE_SLOTS (ARQ_WINDOW_SIZE + 2)
+    #define TX_QUEUE_CLASS_DEPTH (ARQ_WINDOW_SIZE + 1)
+#endif
+#define TX_QUEUE_FRAME_SIZE MSG_MAX_STREAM_SIZE
+
+// Duplicate filter and response cache (peers tracked at once)
+#ifdef BOARD_ARDUINO_UNO
+    #define DUP_CACHE_PEERS 2
+#else
+    #define DUP_CACHE_PEERS 8
+#endif
+
+// ACK timeout bounds, scaled by the LoRa symbol time (SF7/125 kHz: 1 ms, SF12: 33 ms)
+// so the same firmware behaves at any spreading factor. Between the bounds the
+// timeout follows the measured round-trip time.
+#define LORA_SYMBOL_TIME_MS ((float)(1L << LORA_SPREADING_FACTOR) * 1000.0f / LORA_SIGNAL_BANDWIDTH)
+#define ARQ_RTO_INITIAL_MS ((unsigned long)(LORA_SYMBOL_TIME_MS * 600))  // Before the first sample: longest frame + ACK
+#define ARQ_RTO_MIN_MS ((unsigned long)(LORA_SYMBOL_TIME_MS * 60))       // Shortest frame + ACK
+#define ARQ_RTO_MAX_MS 60000
+
+// ACKs wait this long for an outgoing data frame to ride on before going out alone
+#define ARQ_ACK_HOLDOFF_MS ((unsigned long)(LORA_SYMBOL_TIME_MS * 20))
+
+// Sensor streaming: seconds a subscription lasts without traffic from the
+// subscriber (renewed by any frame, explicitly at half the lease)
+#define STREAM_LEASE_S 60
+
+// Polling engine (master of many addressed slaves)
+#define POLL_MAX_NODES 32
+#define POLL_TIMEOUT_MS ARQ_RTO_INITIAL_MS  // Poll + reply at the longest frame size
+
+// Reassembly of fragmented payloads (each slot buffers one whole transfer)
+#define REASSEMBLY_SLOTS 2
+#define REASSEMBLY_BUFFER_SIZE 16384
+#define REASSEMBLY_TIMEOUT_MS 30000
+
+// Adaptive data rate (enabled at run time with "adr on")
+#define ADR_MAX_PEERS 8
+#define ADR_HISTORY_SIZE 16
+#define ADR_MIN_SAMPLES 10
+#define ADR_INTERVAL_MS 30000           // Between step evaluations
+#define ADR_FALLBACK_MS 5000            // Plus retries at the new rate: revert if the peer stays silent
+#define ADR_TARGET_PDR 90               // % of frames ACKed
+#define ADR_MARGIN_DB 10                // SNR headroom kept for fading
+
 // Serial Configuration
 #define SERIAL_BAUD 9600
 
@@ -0,0 +1,337 @@
+#include "ArqWindow.h"
+
+// ===== RttEstimator =====
+
+RttEstimator::RttEstimator() {
+    reset();
+}
+
+void RttEstimator::reset(unsigned long initialRto) {
+    srtt8 = 0;
+    rttvar4 = 0;
+    samples = 0;
+    rto = (initialRto < ARQ_RTO_MAX_MS) ? initialRto : ARQ_RTO_MAX_MS;
+}
+
+void RttEstimator::addSample(unsigned long rttMs) {
+    if (samples == 0) {
+        // First sample: SRTT = R, RTTVAR = R / 2
+        srtt8 = rttMs << 3;
+        rttvar4 = rttMs << 1;
+    } else {
+        int32_t error = (int32_t)rttMs - (int32_t)(srtt8 >> 3);
+        srtt8 += error;
+        if (error < 0) {
+            error = -error;
+        }
+        rttvar4 += error - (int32_t)(rttvar4 >> 2);
+    }
+    samples++;
+
+    rto = (srtt8 >> 3) + rttvar4;
+    if (rto < ARQ_RTO_MIN_MS) {
+        rto = ARQ_RTO_MIN_MS;
+    } else if (rto > ARQ_RTO_MAX_MS) {
+        rto = ARQ_RTO_MAX_MS;
+    }
+}
+
+unsigned long RttEstimator::getRto() const {
+    return rto;
+}
+
+unsigned long RttEstimator::getSrtt() const {
+    return srtt8 >> 3;
+}
+
+unsigned long RttEstimator::getRttVar() const {
+    return rttvar4 >> 2;
+}
+
+uint32_t RttEstimator::getSampleCount() const {
+    return samples;
+}
+
+// ===== ArqWindow =====
+
+ArqWindow::ArqWindow() : head(0), tail(0), lastSent(nullptr), limit(ARQ_WINDOW_SIZE) {
+}
+
+ArqSlot& ArqWindow::slotAt(uint8_t index) {
+    return slots[index & (ARQ_WINDOW_SIZE - 1)];
+}
+
+uint8_t* ArqWindow::nextFrame() {
+    if (isFull()) {
+        return nullptr;
+    }
+    return slotAt(head).frame;
+}
+
+void ArqWindow::commit(size_t length, uint16_t messageId, uint8_t priority) {
+    if (isFull()) {
+        return;
+    }
+
+    ArqSlot& slot = slotAt(head);
+    slot.length = (uint8_t)length;
+    slot.messageId = messageId;
+    slot.retries = 0;
+    slot.priority = priority;
+    slot.sentAt = millis();
+    slot.queued = true;
+    slot.sacked = false;
+    slot.lost = false;
+
+    head++;
+}
+
+uint8_t ArqWindow::acknowledge(uint16_t messageId) {
+    uint8_t released = 0;
+
+    // Frames leave in send order, so release from the oldest
+    while (!isEmpty() && !arqBefore(messageId, slotAt(tail).messageId)) {
+        ArqSlot& slot = slotAt(tail);
+        if (slot.messageId == messageId && slot.retries == 0 && !slot.sacked) {
+            rtt.addSample(millis() - slot.sentAt);
+        }
+        if (lastSent == &slot) {
+            lastSent = nullptr;
+        }
+        tail++;
+        released++;
+    }
+
+    return released;
+}
+
+uint8_t ArqWindow::acknowledgeSelective(uint16_t messageId, uint32_t bitmap) {
+    uint8_t marked = 0;
+    bool haveNewest = false;
+    unsigned long newestSentAt = 0;
+
+    for (uint8_t i = tail; i != head; i++) {
+        ArqSlot& slot = slotAt(i);
+        uint16_t offset = (uint16_t)(slot.messageId - messageId - 1);
+        if (offset >= 32 || (bitmap & (1UL << offset)) == 0) {
+            continue;
+        }
+        if (!slot.sacked) {
+            slot.sacked = true;
+            slot.lost = false;
+            marked++;
+        }
+        if (!haveNewest || (long)(slot.sentAt - newestSentAt) > 0) {
+            newestSentAt = slot.sentAt;
+            haveNewest = true;
+        }
+    }
+
+    // LoRa does not reorder: a frame sent before one that arrived is lost
+    if (haveNewest) {
+        for (uint8_t i = tail; i != head; i++) {
+            ArqSlot& slot = slotAt(i);
+            if (!slot.sacked && !slot.queued && (long)(slot.sentAt - newestSentAt) < 0) {
+                slot.lost = true;
+            }
+        }
+    }
+
+    return marked;
+}
+
+ArqSlot* ArqWindow::nextExpired() {
+    unsigned long now = millis();
+
+    for (uint8_t i = tail; i != head; i++) {
+        ArqSlot& slot = slotAt(i);
+        if (slot.sacked || slot.queued) {
+            continue;
+        }
+        if (slot.lost || now - slot.sentAt >= getTimeout(slot.retries)) {
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+ArqSlot* ArqWindow::find(uint16_t messageId) {
+    for (uint8_t i = tail; i != head; i++) {
+        if (slotAt(i).messageId == messageId) {
+            return &slotAt(i);
+        }
+    }
+    return nullptr;
+}
+
+unsigned long ArqWindow::timeUntilExpiry() {
+    unsigned long now = millis();
+    unsigned long next = ARQ_NO_TIMEOUT;
+
+    for (uint8_t i = tail; i != head; i++) {
+        ArqSlot& slot = slotAt(i);
+        if (slot.sacked || slot.queued) {
+            continue;
+        }
+        if (slot.lost) {
+            return 0;
+        }
+        unsigned long elapsed = now - slot.sentAt;
+        unsigned long timeout = getTimeout(slot.retries);
+        if (elapsed >= timeout) {
+            return 0;
+        }
+        if (timeout - elapsed < next) {
+            next = timeout - elapsed;
+        }
+    }
+
+    return next;
+}
+
+unsigned long ArqWindow::getTimeout(uint8_t retries) {
+    // Exponential backoff on the estimated RTO
+    unsigned long timeout = rtt.getRto();
+    for (uint8_t i = 0; i < retries && timeout < ARQ_RTO_MAX_MS; i++) {
+        timeout <<= 1;
+    }
+    return (timeout < ARQ_RTO_MAX_MS) ? timeout : ARQ_RTO_MAX_MS;
+}
+
+const RttEstimator& ArqWindow::getRtt() {
+    return rtt;
+}
+
+void ArqWindow::resetRtt(unsigned long initialRto) {
+    rtt.reset(initialRto);
+}
+
+void ArqWindow::markRetransmitted(ArqSlot* slot) {
+    slot->retries++;
+    slot->queued = true;
+    slot->lost = false;
+}
+
+bool ArqWindow::markSent(const uint8_t* frame) {
+    for (uint8_t i = tail; i != head; i++) {
+        ArqSlot& slot = slotAt(i);
+        if (slot.frame == frame) {
+            slot.sentAt = millis();
+            slot.queued = false;
+            lastSent = &slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ArqWindow::holdLastTimer() {
+    if (lastSent != nullptr) {
+        lastSent->sentAt = millis();
+    }
+}
+
+uint8_t ArqWindow::clear() {
+    uint8_t dropped = getOutstanding();
+    tail = head;
+    lastSent = nullptr;
+    return dropped;
+}
+
+uint8_t ArqWindow::getOutstanding() {
+    return (uint8_t)(head - tail);
+}
+
+bool ArqWindow::isEmpty() {
+    return head == tail;
+}
+
+bool ArqWindow::isFull() {
+    return getOutstanding() >= limit;
+}
+
+void ArqWindow::setLimit(uint8_t frames) {
+    if (frames < 1) {
+        frames = 1;
+    } else if (frames > ARQ_WINDOW_SIZE) {
+        frames = ARQ_WINDOW_SIZE;
+    }
+    limit = frames;
+}
+
+// ===== ArqReceiver =====
+
+ArqReceiver::ArqReceiver() {
+    reset();
+}
+
+void ArqReceiver::reset() {
+    synced = false;
+    restarted = false;
+    base = 0;
+    received = 0;
+    openingId = 0;
+}
+
+bool ArqReceiver::accept(uint16_t messageId, bool syn) {
+    restarted = false;
+
+    // A SYN frame other than a retransmission of the current opening
+    // frame starts the peer's sequence over, wherever its ID falls
+    if (syn && !(synced && messageId == openingId)) {
+        restarted = synced;
+        synced = false;
+        openingId = messageId;
+    }
+
+    if (!synced) {
+        synced = true;
+        base = messageId;
+        received = 0;
+    }
+
+    int16_t offset = (int16_t)(messageId - base);
+
+    if (offset < 0) {
+        // Already acknowledged, unless far behind (peer restarted its IDs)
+        if (offset > -ARQ_RX_WINDOW) {
+            return false;
+        }
+        base = messageId;
+        received = 0;
+        offset = 0;
+    } else if (offset >= ARQ_RX_WINDOW) {
+        // Peer gave up on the frames in between: restart from here
+        base = messageId;
+        received = 0;
+        offset = 0;
+    }
+
+    uint32_t bit = 1UL << offset;
+    if (received & bit) {
+        return false;
+    }
+    received |= bit;
+
+    // Advance the cumulative ACK point over the gap-free run
+    // (ID 0 is never generated, so it does not leave a gap at wraparound)
+    while ((received & 1) || base == 0) {
+        received >>= 1;
+        base++;
+    }
+
+    return true;
+}
+
+bool ArqReceiver::wasRestarted() {
+    return restarted;
+}
+
+uint16_t ArqReceiver::getCumulativeAck() {
+    return base - 1;
+}
+
+uint32_t ArqReceiver::getSelectiveBitmap() {
+    return received;
+}
@@ -0,0 +1,209 @@
+#ifndef ARQ_WINDOW_H
+#define ARQ_WINDOW_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Retransmission timeout bounds (ms)
+#ifndef ARQ_RTO_INITIAL_MS
+    #define ARQ_RTO_INITIAL_MS 1000
+#endif
+#ifndef ARQ_RTO_MIN_MS
+    #define ARQ_RTO_MIN_MS 200
+#endif
+#ifndef ARQ_RTO_MAX_MS
+    #define ARQ_RTO_MAX_MS 60000
+#endif
+
+// Delayed ACK: time to wait for a data frame to piggyback on (ms)
+#ifndef ARQ_ACK_HOLDOFF_MS
+    #define ARQ_ACK_HOLDOFF_MS 50
+#endif
+
+// Frames a sender may have on air without an ACK
+#ifndef ARQ_WINDOW_SIZE
+    #define ARQ_WINDOW_SIZE 4
+#endif
+
+// Bytes kept per window slot: the largest frame this node sends sequenced
+#ifndef ARQ_FRAME_SIZE
+    #define ARQ_FRAME_SIZE MSG_MAX_PACKET_SIZE
+#endif
+
+// Message IDs the receiver tracks above its cumulative ACK point.
+// A frame further ahead restarts the receive window (peer gave up on
+// older frames and skipped its sequence by this much).
+#define ARQ_RX_WINDOW 32
+
+// timeUntilExpiry() with nothing outstanding
+#define ARQ_NO_TIMEOUT 0xFFFFFFFFUL
+
+// Power of two: slots are found by masking free-running uint8_t counters,
+// which only map consistently across the 255 -> 0 wrap if the size divides 256
+static_assert(ARQ_WINDOW_SIZE >= 1 && ARQ_WINDOW_SIZE <= ARQ_RX_WINDOW / 2 &&
+              (ARQ_WINDOW_SIZE & (ARQ_WINDOW_SIZE - 1)) == 0,
+              "ARQ_WINDOW_SIZE must be a power of two between 1 and ARQ_RX_WINDOW / 2");
+
+// True if message ID a was sent before b (16-bit wraparound)
+inline bool arqBefore(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) < 0;
+}
+
+// Smoothed round-trip time and variance (Jacobson/Karels, RFC 6298):
+// SRTT += (R - SRTT) / 8, RTTVAR += (|R - SRTT| - RTTVAR) / 4,
+// RTO = SRTT + 4 * RTTVAR, kept in fixed point to stay integer-only
+class RttEstimator {
+public:
+    RttEstimator();
+
+    // Feed one round-trip measurement (ms)
+    void addSample(unsigned long rttMs);
+
+    // Current retransmission timeout (ms)
+    unsigned long getRto() const;
+
+    // Smoothed RTT and RTT variance (ms), 0 before the first sample
+    unsigned long getSrtt() const;
+    unsigned long getRttVar() const;
+
+    // Number of samples taken
+    uint32_t getSampleCount() const;
+
+    // Forget all samples and start over from this timeout
+    void reset(unsigned long initialRto = ARQ_RTO_INITIAL_MS);
+
+private:
+    uint32_t srtt8;    // SRTT << 3
+    uint32_t rttvar4;  // RTTVAR << 2
+    uint32_t samples;
+    unsigned long rto;
+};
+
+// One outstanding frame, kept encoded for retransmission
+struct ArqSlot {
+    uint8_t frame[ARQ_FRAME_SIZE];
+    uint8_t length;
+    uint16_t messageId;
+    uint8_t retries;
+    uint8_t priority;      // Caller's TX class, reused for retransmissions
+    unsigned long sentAt;  // millis() of the last (re)transmission
+    bool queued;           // Waiting for the radio: timer not running yet
+    bool sacked;           // Selectively ACKed: waits for the cumulative ACK, never resent
+    bool lost;             // A later frame was SACKed: resend without waiting for the timeout
+};
+
+// Sender side: frames awaiting a cumulative ACK, oldest first.
+// Each frame has its own retransmit timer: the peer's RTO, doubled per retry.
+class ArqWindow {
+public:
+    ArqWindow();
+
+    // ARQ_FRAME_SIZE buffer to encode the next frame into, nullptr if the window is full
+    uint8_t* nextFrame();
+
+    // Track the frame encoded into nextFrame(). Its timer starts with
+    // markSent(), once it actually leaves the radio queue.
+    void commit(size_t length, uint16_t messageId, uint8_t priority = 0);
+
+    // Cumulative ACK: release every frame up to and including messageId.
+    // Returns number of frames released (0 for stale or duplicate ACKs).
+    // The frame named by the ACK gives an RTT sample unless it was
+    // retransmitted (Karn's rule: the ACK could belong to either copy)
+    // or already SACKed (the ACK waited for an earlier hole).
+    uint8_t acknowledge(uint16_t messageId);
+
+    // Selective ACK: bit i of bitmap marks messageId + 1 + i as received.
+    // Those frames are no longer retransmitted; unmarked frames sent before
+    // the newest marked one are holes and expire at once. Call after
+    // acknowledge(messageId). Returns number of frames newly marked.
+    uint8_t acknowledgeSelective(uint16_t messageId, uint32_t bitmap);
+
+    // Oldest frame whose ACK timeout has expired (or a SACK hole), nullptr if none
+    ArqSlot* nextExpired();
+
+    // Ms until the next ACK timeout expires, ARQ_NO_TIMEOUT if the window is empty
+    unsigned long timeUntilExpiry();
+
+    // Outstanding frame with this message ID, nullptr if not in the window
+    ArqSlot* find(uint16_t messageId);
+
+    // Timeout for a frame after the given number of retries
+    unsigned long getTimeout(uint8_t retries);
+
+    // Round-trip estimator for this peer
+    const RttEstimator& getRtt();
+
+    // Start RTT estimation over, e.g. after the data rate changed
+    void resetRtt(unsigned long initialRto);
+
+    // Record a retransmission (queued again until markSent())
+    void markRetransmitted(ArqSlot* slot);
+
+    // The frame stored at this buffer went to the radio: start its timer.
+    // False if no outstanding frame uses the buffer (ACKed while queued).
+    bool markSent(const uint8_t* frame);
+
+    // Restart the timer of the frame sent last (still on air)
+    void holdLastTimer();
+
+    // Drop every outstanding frame, returns number dropped
+    uint8_t clear();
+
+    // Window occupancy
+    uint8_t getOutstanding();
+    bool isEmpty();
+    bool isFull();
+
+    // Frames allowed on air at once (1 .. ARQ_WINDOW_SIZE), e.g. 1 while
+    // the opening SYN frame waits for the peer's first ACK
+    void setLimit(uint8_t frames);
+
+private:
+    // Ring of slots; head and tail are free-running counters, masked on access
+    ArqSlot slots[ARQ_WINDOW_SIZE];
+    uint8_t head;
+    uint8_t tail;
+    ArqSlot* lastSent;
+    uint8_t limit;
+    RttEstimator rtt;
+
+    ArqSlot& slotAt(uint8_t index);
+};
+
+// Receiver side: which message IDs from the peer have arrived.
+// Frames may be processed out of order; the cumulative ACK point only
+// advances over gap-free runs.
+class ArqReceiver {
+public:
+    ArqReceiver();
+
+    // Record an incoming message ID. Returns false for a duplicate
+    // (acknowledge it again, but do not process it twice).
+    // A SYN frame (MessageView::isSyn) opens a new sequence: the window
+    // restarts on it unless it repeats the frame that opened the current one.
+    bool accept(uint16_t messageId, bool syn = false);
+
+    // The last accept() restarted the window on a SYN frame
+    // (peer rebooted or gave up: forget its cached responses)
+    bool wasRestarted();
+
+    // Highest ID received with no gaps before it
+    uint16_t getCumulativeAck();
+
+    // IDs received above the cumulative ACK (bit i: cumulative + 1 + i),
+    // 0 if nothing arrived out of order
+    uint32_t getSelectiveBitmap();
+
+    // Forget the peer's sequence (next frame starts a new window)
+    void reset();
+
+private:
+    bool synced;
+    bool restarted;
+    uint16_t base;       // Lowest ID not yet received
+    uint32_t received;   // Bit i set: base + i received
+    uint16_t openingId;  // SYN frame that opened the current sequence, 0 if none
+};
+
+#endif // ARQ_WINDOW_H
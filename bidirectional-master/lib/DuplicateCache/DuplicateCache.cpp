@@ -0,0 +1,113 @@
+#include "DuplicateCache.h"
+
+DuplicateCache::DuplicateCache() : hits(0) {
+    for (uint8_t i = 0; i < DUP_CACHE_PEERS; i++) {
+        peers[i].address = MSG_ADDR_NONE;
+        peers[i].newest = 0;
+        peers[i].seen = 0;
+        peers[i].requestId = 0;
+        peers[i].responseId = 0;
+        peers[i].lastHeard = 0;
+    }
+}
+
+bool DuplicateCache::check(uint8_t address, uint16_t messageId) {
+    if (address == MSG_ADDR_NONE || messageId == 0) {
+        return false;
+    }
+
+    DupPeer* known = find(address);
+    DupPeer& peer = (known != nullptr) ? *known : peerFor(address);
+    peer.lastHeard = millis();
+
+    if (known == nullptr) {
+        // First frame from this peer
+        peer.newest = messageId;
+        peer.seen = 1;
+        return false;
+    }
+
+    int16_t offset = (int16_t)(peer.newest - messageId);
+
+    if (offset < 0) {
+        // Newer than anything seen: slide the window up
+        uint16_t shift = (uint16_t)(-offset);
+        peer.seen = (shift < DUP_CACHE_WINDOW) ? (peer.seen << shift) | 1 : 1;
+        peer.newest = messageId;
+        return false;
+    }
+
+    if (offset >= DUP_CACHE_WINDOW) {
+        // Far behind the window: the peer restarted its IDs
+        peer.newest = messageId;
+        peer.seen = 1;
+        peer.responseId = 0;
+        return false;
+    }
+
+    uint32_t bit = 1UL << offset;
+    if (peer.seen & bit) {
+        hits++;
+        return true;
+    }
+    peer.seen |= bit;
+    return false;
+}
+
+void DuplicateCache::setResponse(uint8_t address, uint16_t requestId, uint16_t responseId) {
+    DupPeer* peer = find(address);
+    if (peer != nullptr) {
+        peer->requestId = requestId;
+        peer->responseId = responseId;
+    }
+}
+
+uint16_t DuplicateCache::getResponse(uint8_t address, uint16_t requestId) {
+    DupPeer* peer = find(address);
+    if (peer == nullptr || peer->responseId == 0 || peer->requestId != requestId) {
+        return 0;
+    }
+    return peer->responseId;
+}
+
+void DuplicateCache::forget(uint8_t address) {
+    DupPeer* peer = find(address);
+    if (peer != nullptr) {
+        peer->address = MSG_ADDR_NONE;
+        peer->seen = 0;
+        peer->responseId = 0;
+    }
+}
+
+uint32_t DuplicateCache::getHits() {
+    return hits;
+}
+
+DupPeer* DuplicateCache::find(uint8_t address) {
+    for (uint8_t i = 0; i < DUP_CACHE_PEERS; i++) {
+        if (peers[i].address == address) {
+            return &peers[i];
+        }
+    }
+    return nullptr;
+}
+
+DupPeer& DuplicateCache::peerFor(uint8_t address) {
+    uint8_t slot = 0;
+
+    for (uint8_t i = 0; i < DUP_CACHE_PEERS; i++) {
+        if (peers[i].address == MSG_ADDR_NONE) {
+            slot = i;
+            break;
+        }
+        if (millis() - peers[i].lastHeard > millis() - peers[slot].lastHeard) {
+            slot = i;
+        }
+    }
+
+    peers[slot].address = address;
+    peers[slot].newest = 0;
+    peers[slot].seen = 0;
+    peers[slot].responseId = 0;
+    return peers[slot];
+}
@@ -0,0 +1,173 @@
+#include "LinkAdr.h"
+
+LinkAdr::LinkAdr() {
+    for (uint8_t i = 0; i < ADR_MAX_PEERS; i++) {
+        peers[i].address = MSG_ADDR_NONE;
+    }
+    reset();
+}
+
+PeerLink* LinkAdr::find(uint8_t address) {
+    for (uint8_t i = 0; i < ADR_MAX_PEERS; i++) {
+        if (peers[i].address == address) {
+            return &peers[i];
+        }
+    }
+    return nullptr;
+}
+
+void LinkAdr::addSample(uint8_t peer, int16_t rssi, float snr) {
+    PeerLink* link = find(peer);
+    if (link == nullptr) {
+        // New peer: take a free slot, or the one heard from least
+        link = find(MSG_ADDR_NONE);
+        if (link == nullptr) {
+            link = &peers[0];
+            for (uint8_t i = 1; i < ADR_MAX_PEERS; i++) {
+                if (peers[i].count < link->count) {
+                    link = &peers[i];
+                }
+            }
+        }
+        link->address = peer;
+        link->count = 0;
+        link->next = 0;
+    }
+
+    float quarters = snr * 4.0f;
+    quarters = (quarters > 127.0f) ? 127.0f : (quarters < -128.0f) ? -128.0f : quarters;
+
+    link->snr[link->next] = (int8_t)(quarters + (quarters >= 0 ? 0.5f : -0.5f));
+    link->rssi[link->next] = rssi;
+    link->next = (link->next + 1) % ADR_HISTORY_SIZE;
+    if (link->count < ADR_HISTORY_SIZE) {
+        link->count++;
+    }
+}
+
+void LinkAdr::recordTransmission() {
+    transmissions++;
+}
+
+void LinkAdr::recordDelivered(uint8_t frames) {
+    delivered += frames;
+}
+
+void LinkAdr::reset() {
+    for (uint8_t i = 0; i < ADR_MAX_PEERS; i++) {
+        peers[i].count = 0;
+        peers[i].next = 0;
+    }
+    transmissions = 0;
+    delivered = 0;
+}
+
+int16_t LinkAdr::getRequiredSnr(uint8_t spreadingFactor) {
+    // -7.5 dB at SF7, 2.5 dB lower per step up to -20 dB at SF12
+    return -30 - 10 * (int16_t)(spreadingFactor - 7);
+}
+
+bool LinkAdr::getMargin(uint8_t peer, uint8_t spreadingFactor, int16_t& margin) {
+    PeerLink* link = find(peer);
+    if (link == nullptr || link->count == 0) {
+        return false;
+    }
+
+    // Best recent SNR, as LoRaWAN network servers do: fades show up in
+    // the delivery ratio instead
+    int16_t best = link->snr[0];
+    for (uint8_t i = 1; i < link->count; i++) {
+        if (link->snr[i] > best) {
+            best = link->snr[i];
+        }
+    }
+
+    margin = best - getRequiredSnr(spreadingFactor) - ADR_MARGIN_DB * 4;
+    return true;
+}
+
+uint8_t LinkAdr::getPdr() {
+    if (transmissions == 0) {
+        return 100;
+    }
+    uint32_t pdr = (delivered * 100UL) / transmissions;
+    return (pdr > 100) ? 100 : (uint8_t)pdr;
+}
+
+bool LinkAdr::evaluate(uint8_t peer, const RadioSettings& current, RadioSettings& next) {
+    PeerLink* link = find(peer);
+    int16_t margin;
+    if (link == nullptr || link->count < ADR_MIN_SAMPLES || !getMargin(peer, current.spreadingFactor, margin)) {
+        return false;
+    }
+
+    next = current;
+    bool delivering = transmissions < ADR_MIN_SAMPLES || getPdr() >= ADR_TARGET_PDR;
+
+    if (!delivering || margin < 0) {
+        // Too weak: more power is cheaper than airtime
+        if (current.txPower < ADR_MAX_TX_POWER) {
+            next.txPower = current.txPower + ADR_POWER_STEP_DB;
+            if (next.txPower > ADR_MAX_TX_POWER) {
+                next.txPower = ADR_MAX_TX_POWER;
+            }
+            return true;
+        }
+        if (current.spreadingFactor < 12) {
+            next.spreadingFactor = current.spreadingFactor + 1;
+            return true;
+        }
+        return false;
+    }
+
+    // Headroom left: a faster spreading factor costs 2.5 dB ...
+    if (margin >= 10 && current.spreadingFactor > 7) {
+        next.spreadingFactor = current.spreadingFactor - 1;
+        return true;
+    }
+
+    // ... then trade the rest for battery
+    if (margin >= ADR_POWER_STEP_DB * 4 && current.txPower > ADR_MIN_TX_POWER) {
+        next.txPower = current.txPower - ADR_POWER_STEP_DB;
+        if (next.txPower < ADR_MIN_TX_POWER) {
+            next.txPower = ADR_MIN_TX_POWER;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void LinkAdr::printStats(uint8_t spreadingFactor) {
+    Serial.print(F("Link quality (PDR "));
+    Serial.print(getPdr());
+    Serial.print(F("%, "));
+    Serial.print(delivered);
+    Serial.print(F("/"));
+    Serial.print(transmissions);
+    Serial.println(F("):"));
+
+    for (uint8_t i = 0; i < ADR_MAX_PEERS; i++) {
+        const PeerLink& link = peers[i];
+        if (link.address == MSG_ADDR_NONE || link.count == 0) {
+            continue;
+        }
+
+        int32_t rssiSum = 0;
+        for (uint8_t s = 0; s < link.count; s++) {
+            rssiSum += link.rssi[s];
+        }
+        int16_t margin = 0;
+        getMargin(link.address, spreadingFactor, margin);
+
+        Serial.print(F("  0x"));
+        Serial.print(link.address, HEX);
+        Serial.print(F(": avg RSSI "));
+        Serial.print(rssiSum / link.count);
+        Serial.print(F(" dBm, margin "));
+        Serial.print(margin / 4.0f, 1);
+        Serial.print(F(" dB ("));
+        Serial.print(link.count);
+        Serial.println(F(" samples)"));
+    }
+}
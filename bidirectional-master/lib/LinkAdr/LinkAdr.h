@@ -0,0 +1,102 @@
+#ifndef LINK_ADR_H
+#define LINK_ADR_H
+
+#include <Arduino.h>
+#include "LoRaComm.h"
+#include "board_config.h"
+
+// Peers whose link quality is tracked
+#ifndef ADR_MAX_PEERS
+    #define ADR_MAX_PEERS 4
+#endif
+
+// Received frames remembered per peer (the best SNR among them counts)
+#ifndef ADR_HISTORY_SIZE
+    #define ADR_HISTORY_SIZE 16
+#endif
+
+// Samples (and window transmissions) needed before a step is considered
+#ifndef ADR_MIN_SAMPLES
+    #define ADR_MIN_SAMPLES 8
+#endif
+
+// SNR kept in reserve above the demodulation floor for fading (dB)
+#ifndef ADR_MARGIN_DB
+    #define ADR_MARGIN_DB 10
+#endif
+
+// Delivery ratio the link must keep, % of window transmissions ACKed
+#ifndef ADR_TARGET_PDR
+    #define ADR_TARGET_PDR 90
+#endif
+
+// TX power range and step (dBm)
+#ifndef ADR_MIN_TX_POWER
+    #define ADR_MIN_TX_POWER 2
+#endif
+#ifndef ADR_MAX_TX_POWER
+    #define ADR_MAX_TX_POWER LORA_TX_POWER
+#endif
+#ifndef ADR_POWER_STEP_DB
+    #define ADR_POWER_STEP_DB 3
+#endif
+
+static_assert(ADR_HISTORY_SIZE >= ADR_MIN_SAMPLES, "ADR_HISTORY_SIZE must hold ADR_MIN_SAMPLES");
+
+// Signal history of one peer
+struct PeerLink {
+    uint8_t address;                 // MSG_ADDR_NONE if the slot is free
+    uint8_t count;                   // Samples held (up to ADR_HISTORY_SIZE)
+    uint8_t next;                    // Slot the next sample goes to
+    int8_t snr[ADR_HISTORY_SIZE];    // 0.25 dB steps, as the SX1278 reports it
+    int16_t rssi[ADR_HISTORY_SIZE];  // dBm
+};
+
+// Adaptive data rate engine.
+//
+// Collects RSSI/SNR per peer and the delivery ratio of ARQ frames, and
+// proposes one step at a time towards the fastest setting that keeps
+// ADR_MARGIN_DB of SNR headroom and ADR_TARGET_PDR delivery: a faster
+// spreading factor first, then less TX power; when the margin or the
+// delivery ratio falls short, more power first, then a slower spreading
+// factor. Negotiating the step with the peer stays with the caller.
+class LinkAdr {
+public:
+    LinkAdr();
+
+    // Record one frame received from a peer
+    void addSample(uint8_t peer, int16_t rssi, float snr);
+
+    // Window frames sent (first copies and retransmissions) and frames ACKed
+    void recordTransmission();
+    void recordDelivered(uint8_t frames);
+
+    // Next step for the link to this peer from the current settings.
+    // False if there is too little history or no step to take.
+    bool evaluate(uint8_t peer, const RadioSettings& current, RadioSettings& next);
+
+    // Forget history and delivery counts (after a settings change)
+    void reset();
+
+    // SNR margin over the demodulation floor at this spreading factor,
+    // less ADR_MARGIN_DB (0.25 dB steps). False without samples.
+    bool getMargin(uint8_t peer, uint8_t spreadingFactor, int16_t& margin);
+
+    // Delivery ratio (%), 100 before any transmission
+    uint8_t getPdr();
+
+    // Print per-peer link quality
+    void printStats(uint8_t spreadingFactor);
+
+    // Lowest SNR the SX1278 demodulates at this spreading factor (0.25 dB steps)
+    static int16_t getRequiredSnr(uint8_t spreadingFactor);
+
+private:
+    PeerLink peers[ADR_MAX_PEERS];
+    uint32_t transmissions;
+    uint32_t delivered;
+
+    PeerLink* find(uint8_t address);
+};
+
+#endif // LINK_ADR_H
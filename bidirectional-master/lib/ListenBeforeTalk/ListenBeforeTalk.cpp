@@ -0,0 +1,95 @@
+#include "ListenBeforeTalk.h"
+
+ListenBeforeTalk::ListenBeforeTalk()
+    : enabled(LBT_ENABLED), waiting(false), attempt(0), firstBusy(0), backoffStart(0), backoffLength(0),
+      checks(0), busyChecks(0), backoffs(0), backoffMs(0), gaveUp(0) {
+}
+
+void ListenBeforeTalk::setEnabled(bool enable) {
+    enabled = enable;
+    waiting = false;
+    backoffLength = 0;
+}
+
+bool ListenBeforeTalk::isEnabled() {
+    return enabled;
+}
+
+unsigned long ListenBeforeTalk::getBackoff() {
+    unsigned long elapsed = millis() - backoffStart;
+    if (elapsed >= backoffLength) {
+        backoffLength = 0;
+        return 0;
+    }
+    return backoffLength - elapsed;
+}
+
+unsigned long ListenBeforeTalk::next(bool busy, unsigned long slotMs) {
+    unsigned long now = millis();
+    checks++;
+
+    if (!busy) {
+        waiting = false;
+        return 0;
+    }
+
+    busyChecks++;
+
+    if (!waiting) {
+        waiting = true;
+        attempt = 0;
+        firstBusy = now;
+    } else if (now - firstBusy >= LBT_MAX_WAIT_MS) {
+        waiting = false;
+        gaveUp++;
+        return LBT_GIVE_UP;
+    }
+
+    if (attempt < LBT_MAX_BACKOFF_EXP) {
+        attempt++;
+    }
+
+    // Binary exponential backoff: 1..2^attempt slots
+    backoffStart = now;
+    backoffLength = (slotMs > 0 ? slotMs : 1) * (unsigned long)random(1, (1L << attempt) + 1);
+    backoffs++;
+    backoffMs += backoffLength;
+    return backoffLength;
+}
+
+uint32_t ListenBeforeTalk::getChecks() {
+    return checks;
+}
+
+uint32_t ListenBeforeTalk::getBusy() {
+    return busyChecks;
+}
+
+uint32_t ListenBeforeTalk::getBackoffs() {
+    return backoffs;
+}
+
+uint32_t ListenBeforeTalk::getBackoffMs() {
+    return backoffMs;
+}
+
+uint32_t ListenBeforeTalk::getGaveUp() {
+    return gaveUp;
+}
+
+void ListenBeforeTalk::printStats() {
+    Serial.print(F("LBT: "));
+    if (!enabled) {
+        Serial.println(F("off"));
+        return;
+    }
+    Serial.print(checks);
+    Serial.print(F(" CAD checks, busy "));
+    Serial.print(busyChecks);
+    Serial.print(F(", backoffs "));
+    Serial.print(backoffs);
+    Serial.print(F(" ("));
+    Serial.print(backoffMs);
+    Serial.print(F(" ms), gave up "));
+    Serial.println(gaveUp);
+}
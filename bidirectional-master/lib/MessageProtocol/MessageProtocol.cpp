@@ -1,6 +1,128 @@
 #include "MessageProtocol.h"
 
-MessageProtocol::MessageProtocol() : lastMessageId(0) {
+// ===== CRC Tables =====
+
+// CRC-16-CCITT, polynomial 0x1021 (MSB first)
+static const uint16_t CRC16_TABLE[256] PROGMEM = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+// CRC-32, reflected polynomial 0xEDB88320
+static const uint32_t CRC32_TABLE[256] PROGMEM = {
+    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
+    0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+    0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
+    0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9,
+    0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
+    0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
+    0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+    0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
+    0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
+    0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+    0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
+    0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
+    0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
+    0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
+    0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+    0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
+    0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
+    0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+    0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
+    0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
+    0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
+    0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
+    0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+    0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
+    0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
+    0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+    0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
+    0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
+    0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+};
+
+// ===== Sensor Dictionary =====
+
+static const SensorInfo SENSOR_DICTIONARY[] = {
+    { SENSOR_TEMPERATURE, "Temperature", "°C", 2 },
+    { SENSOR_HUMIDITY, "Humidity", "%", 2 },
+    { SENSOR_BATTERY, "Battery", "V", 2 },
+    { SENSOR_PRESSURE, "Pressure", "hPa", 2 }
+};
+
+static const int32_t DECIMAL_SCALE[] = { 1, 10, 100, 1000 };
+
+#if defined(ESP32)
+// Slicing-by-4 tables, derived from the base tables on first use.
+// SLICE[k][b] is the CRC contribution of byte b followed by k zero bytes.
+static uint16_t crc16Slice[4][256];
+static uint32_t crc32Slice[4][256];
+static bool sliceTablesReady = false;
+
+static void buildSliceTables() {
+    for (int b = 0; b < 256; b++) {
+        crc16Slice[0][b] = CRC16_TABLE[b];
+        crc32Slice[0][b] = CRC32_TABLE[b];
+    }
+    for (int k = 1; k < 4; k++) {
+        for (int b = 0; b < 256; b++) {
+            uint16_t c16 = crc16Slice[k - 1][b];
+            crc16Slice[k][b] = (uint16_t)(c16 << 8) ^ crc16Slice[0][c16 >> 8];
+            uint32_t c32 = crc32Slice[k - 1][b];
+            crc32Slice[k][b] = (c32 >> 8) ^ crc32Slice[0][c32 & 0xFF];
+        }
+    }
+    sliceTablesReady = true;
+}
+#endif
+
+MessageProtocol::MessageProtocol()
+    : lastMessageId(0), integrityMode(MSG_DEFAULT_INTEGRITY), localAddress(MSG_ADDR_NONE), destAddress(MSG_ADDR_BROADCAST),
+      ackPending(false), ackMessageId(0), ackStatus(0), ackDestination(MSG_ADDR_BROADCAST), synPending(false) {
     // Seed random number generator with microsecond timestamp
     randomSeed(micros());
 }
@@ -15,6 +137,70 @@ uint16_t MessageProtocol::generateMessageId() {
     return lastMessageId;
 }
 
+void MessageProtocol::skipMessageIds(uint16_t count) {
+    lastMessageId += count;
+}
+
+// ===== Integrity Mode =====
+
+void MessageProtocol::setIntegrityMode(IntegrityMode mode) {
+    integrityMode = mode;
+}
+
+IntegrityMode MessageProtocol::getIntegrityMode() {
+    return integrityMode;
+}
+
+size_t MessageProtocol::getTrailerSize(uint8_t mode) {
+    switch (mode) {
+        case INTEGRITY_XOR: return MSG_CHECKSUM_SIZE;
+        case INTEGRITY_CRC16: return MSG_CRC16_SIZE;
+        case INTEGRITY_CRC32: return MSG_CRC32_SIZE;
+        default: return 0;
+    }
+}
+
+// ===== Addressing =====
+
+void MessageProtocol::setLocalAddress(uint8_t address) {
+    localAddress = address;
+}
+
+uint8_t MessageProtocol::getLocalAddress() {
+    return localAddress;
+}
+
+void MessageProtocol::setDestination(uint8_t address) {
+    destAddress = address;
+}
+
+uint8_t MessageProtocol::getDestination() {
+    return destAddress;
+}
+
+bool MessageProtocol::acceptsHeader(const uint8_t* header, size_t length, uint8_t address) {
+    // Legacy and unaddressed frames are for everyone
+    if (length < MSG_HEADER_PEEK_SIZE || header[0] != MSG_START_BYTE_V2 ||
+        (header[1] & MSG_FLAG_ADDRESSED) == 0) {
+        return true;
+    }
+
+    uint8_t destination = header[2];
+    return destination == MSG_ADDR_BROADCAST || destination == address;
+}
+
+size_t MessageProtocol::getHeaderSize() {
+    if (localAddress != MSG_ADDR_NONE) {
+        return MSG_HEADER_V2_SIZE + MSG_ADDR_FIELDS_SIZE;
+    }
+    return (integrityMode == INTEGRITY_XOR) ? MSG_HEADER_SIZE : MSG_HEADER_V2_SIZE;
+}
+
+size_t MessageProtocol::getMaxPayload() {
+    size_t maxPayload = MSG_MAX_FRAME_SIZE - getHeaderSize() - getTrailerSize(integrityMode);
+    return (maxPayload < MSG_MAX_PAYLOAD) ? maxPayload : MSG_MAX_PAYLOAD;
+}
+
 // ===== Checksum Calculation =====
 
 uint8_t MessageProtocol::calculateChecksum(const uint8_t* data, size_t length) {
@@ -25,29 +211,164 @@ uint8_t MessageProtocol::calculateChecksum(const uint8_t* data, size_t length) {
     return checksum;
 }
 
-bool MessageProtocol::verifyChecksum(const uint8_t* data, size_t length) {
+uint16_t MessageProtocol::calculateCrc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    size_t i = 0;
+
+    #if defined(ESP32)
+        if (!sliceTablesReady) {
+            buildSliceTables();
+        }
+        // Four bytes per step: the CRC folds into the first two
+        for (; i + 4 <= length; i += 4) {
+            crc = crc16Slice[3][data[i] ^ (crc >> 8)] ^
+                  crc16Slice[2][data[i + 1] ^ (crc & 0xFF)] ^
+                  crc16Slice[1][data[i + 2]] ^
+                  crc16Slice[0][data[i + 3]];
+        }
+    #endif
+
+    for (; i < length; i++) {
+        crc = (uint16_t)(crc << 8) ^ pgm_read_word(&CRC16_TABLE[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+uint32_t MessageProtocol::calculateCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    size_t i = 0;
+
+    #if defined(ESP32)
+        if (!sliceTablesReady) {
+            buildSliceTables();
+        }
+        // Four bytes per step (little-endian word folded into the CRC)
+        for (; i + 4 <= length; i += 4) {
+            crc ^= (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) |
+                   ((uint32_t)data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+            crc = crc32Slice[3][crc & 0xFF] ^
+                  crc32Slice[2][(crc >> 8) & 0xFF] ^
+                  crc32Slice[1][(crc >> 16) & 0xFF] ^
+                  crc32Slice[0][crc >> 24];
+        }
+    #endif
+
+    for (; i < length; i++) {
+        crc = (crc >> 8) ^ pgm_read_dword(&CRC32_TABLE[(crc ^ data[i]) & 0xFF]);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+bool MessageProtocol::parseFraming(const uint8_t* buffer, size_t length, size_t& headerSize, uint8_t& flags) {
     if (length < MSG_HEADER_SIZE + MSG_CHECKSUM_SIZE) {
         return false;
     }
 
-    uint8_t receivedChecksum = data[length - 1];
-    uint8_t calculatedChecksum = calculateChecksum(data, length - 1);
+    if (buffer[0] == MSG_START_BYTE) {
+        // Legacy header: no FLAGS byte, XOR checksum
+        headerSize = MSG_HEADER_SIZE;
+        flags = INTEGRITY_XOR;
+    } else if (buffer[0] == MSG_START_BYTE_V2) {
+        flags = buffer[1];
+        headerSize = MSG_HEADER_V2_SIZE;
+        if (flags & MSG_FLAG_ADDRESSED) {
+            headerSize += MSG_ADDR_FIELDS_SIZE;
+        }
+        if (flags & MSG_FLAG_ACK) {
+            headerSize += MSG_ACK_FIELDS_SIZE;
+        }
+    } else {
+        return false;
+    }
+
+    size_t trailerSize = getTrailerSize(flags & MSG_FLAG_INTEGRITY_MASK);
+    if (trailerSize == 0 || length < headerSize + trailerSize) {
+        return false;
+    }
+
+    return true;
+}
+
+bool MessageProtocol::verifyChecksum(const uint8_t* data, size_t length) {
+    size_t headerSize;
+    uint8_t flags;
+    if (!parseFraming(data, length, headerSize, flags)) {
+        return false;
+    }
+
+    uint8_t mode = flags & MSG_FLAG_INTEGRITY_MASK;
+    size_t covered = length - getTrailerSize(mode);
+    const uint8_t* trailer = &data[covered];
 
-    return (receivedChecksum == calculatedChecksum);
+    switch (mode) {
+        case INTEGRITY_XOR:
+            return trailer[0] == calculateChecksum(data, covered);
+        case INTEGRITY_CRC16:
+            return (((uint16_t)trailer[0] << 8) | trailer[1]) == calculateCrc16(data, covered);
+        case INTEGRITY_CRC32: {
+            uint32_t received = ((uint32_t)trailer[0] << 24) | ((uint32_t)trailer[1] << 16) |
+                                ((uint32_t)trailer[2] << 8) | trailer[3];
+            return received == calculateCrc32(data, covered);
+        }
+        default:
+            return false;
+    }
 }
 
 // ===== Internal Encoding Helper =====
 
-size_t MessageProtocol::encodePacket(MessageType type, const uint8_t* payload, size_t payloadLength, uint8_t* buffer) {
-    if (payloadLength > MSG_MAX_PAYLOAD) {
+size_t MessageProtocol::encodePacket(MessageType type, const uint8_t* payload, size_t payloadLength, uint8_t* buffer,
+                                     uint16_t* messageId) {
+    if (payloadLength > getMaxPayload()) {
         return 0;  // Payload too large
     }
 
-    uint16_t msgId = generateMessageId();
+    // ACKs are never acknowledged themselves, so they stay out of the
+    // sequence; so do streamed readings, polls and beacons (a lost one
+    // is not resent by ARQ)
+    bool isAck = (type == MSG_ACK || type == MSG_SACK);
+    bool sequenced = !isAck && type != MSG_SENSOR_STREAM && type != MSG_POLL && type != MSG_BEACON;
+    uint16_t msgId = sequenced ? generateMessageId() : 0;
+    if (messageId != nullptr) {
+        *messageId = msgId;
+    }
     size_t index = 0;
 
-    // START byte
-    buffer[index++] = MSG_START_BYTE;
+    // A held ACK rides along if this data frame goes to its peer and still fits
+    size_t ackHeaderSize = MSG_HEADER_V2_SIZE + MSG_ACK_FIELDS_SIZE +
+                           ((localAddress != MSG_ADDR_NONE) ? MSG_ADDR_FIELDS_SIZE : 0);
+    bool attachAck = ackPending && !isAck && type != MSG_NACK && destAddress == ackDestination &&
+                     ackHeaderSize + payloadLength + getTrailerSize(integrityMode) <= MSG_MAX_FRAME_SIZE;
+
+    // SYN needs the FLAGS byte: a legacy frame gets it only if it still fits
+    bool syn = synPending && sequenced &&
+               MSG_HEADER_V2_SIZE + payloadLength + getTrailerSize(integrityMode) <= MSG_MAX_FRAME_SIZE;
+
+    if (getHeaderSize() == MSG_HEADER_SIZE && !attachAck && !syn) {
+        // Legacy frame, readable by older firmware
+        buffer[index++] = MSG_START_BYTE;
+    } else {
+        // START byte and FLAGS (tell the receiver which check and fields follow)
+        buffer[index++] = MSG_START_BYTE_V2;
+        buffer[index++] = (uint8_t)integrityMode |
+                          ((localAddress != MSG_ADDR_NONE) ? MSG_FLAG_ADDRESSED : 0) |
+                          (attachAck ? MSG_FLAG_ACK : 0) |
+                          (syn ? MSG_FLAG_SYN : 0);
+
+        // Addressed: DST first so receivers can filter on a short header read
+        if (localAddress != MSG_ADDR_NONE) {
+            buffer[index++] = destAddress;
+            buffer[index++] = localAddress;
+        }
+
+        // Piggybacked ACK (same fields as a MSG_ACK payload)
+        if (attachAck) {
+            buffer[index++] = (ackMessageId >> 8) & 0xFF;
+            buffer[index++] = ackMessageId & 0xFF;
+            buffer[index++] = ackStatus;
+            ackPending = false;
+        }
+    }
 
     // Message ID (2 bytes, big-endian)
     buffer[index++] = (msgId >> 8) & 0xFF;
@@ -59,40 +380,184 @@ size_t MessageProtocol::encodePacket(MessageType type, const uint8_t* payload, s
     // Length
     buffer[index++] = (uint8_t)payloadLength;
 
-    // Payload
-    for (size_t i = 0; i < payloadLength; i++) {
-        buffer[index++] = payload[i];
-    }
+    // Payload (moved down if it was built in place behind the header room)
+    memmove(&buffer[index], payload, payloadLength);
+    index += payloadLength;
 
-    // Checksum
-    uint8_t checksum = calculateChecksum(buffer, index);
-    buffer[index++] = checksum;
+    // Integrity trailer (big-endian)
+    switch (integrityMode) {
+        case INTEGRITY_CRC16: {
+            uint16_t crc = calculateCrc16(buffer, index);
+            buffer[index++] = (crc >> 8) & 0xFF;
+            buffer[index++] = crc & 0xFF;
+            break;
+        }
+        case INTEGRITY_CRC32: {
+            uint32_t crc = calculateCrc32(buffer, index);
+            buffer[index++] = (crc >> 24) & 0xFF;
+            buffer[index++] = (crc >> 16) & 0xFF;
+            buffer[index++] = (crc >> 8) & 0xFF;
+            buffer[index++] = crc & 0xFF;
+            break;
+        }
+        default: {
+            uint8_t checksum = calculateChecksum(buffer, index);
+            buffer[index++] = checksum;
+            break;
+        }
+    }
 
     return index;
 }
 
 // ===== Encoding Methods =====
 
-size_t MessageProtocol::encodeText(const char* text, uint8_t* buffer) {
+size_t MessageProtocol::encodeText(const char* text, uint8_t* buffer, uint16_t* messageId) {
     size_t textLen = strlen(text);
-    if (textLen > MSG_MAX_PAYLOAD) {
-        textLen = MSG_MAX_PAYLOAD;
+    if (textLen > getMaxPayload()) {
+        textLen = getMaxPayload();
+    }
+
+    return encodePacket(MSG_TEXT, (const uint8_t*)text, textLen, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeSensorRequest(uint8_t sensorId, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t payload[1];
+    payload[0] = sensorId;
+
+    return encodePacket(MSG_SENSOR_REQUEST, payload, 1, buffer, messageId);
+}
+
+size_t MessageProtocol::writeSensorResponse(uint8_t sensorId, float value, const char* unit, size_t unitMax, uint8_t* payload) {
+    size_t index = 0;
+
+    // Sensor ID
+    payload[index++] = sensorId;
+
+    // Value (4 bytes float)
+    memcpy(&payload[index], &value, sizeof(float));
+    index += sizeof(float);
+
+    // Unit string
+    size_t unitLen = strlen(unit);
+    if (unitLen > unitMax) {
+        unitLen = unitMax;
     }
+    memcpy(&payload[index], unit, unitLen);
+    index += unitLen;
+    payload[index++] = '\0';  // Null terminator
+
+    return index;
+}
+
+size_t MessageProtocol::encodeSensorResponse(uint8_t sensorId, float value, const char* unit, uint8_t* buffer, uint16_t* messageId) {
+    // Built in place behind the room left for the header
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+
+    // Leave room for sensor ID + float + NUL
+    size_t length = writeSensorResponse(sensorId, value, unit, MSG_SENSOR_RESPONSE_MAX_PAYLOAD - 6, payload);
+
+    return encodePacket(MSG_SENSOR_RESPONSE, payload, length, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeSensorStream(uint8_t sensorId, float value, const char* unit, uint8_t* buffer) {
+    uint8_t payload[1 + sizeof(float) + MSG_STREAM_UNIT_MAX + 1];
+    size_t length = writeSensorResponse(sensorId, value, unit, MSG_STREAM_UNIT_MAX, payload);
 
-    return encodePacket(MSG_TEXT, (const uint8_t*)text, textLen, buffer);
+    return encodePacket(MSG_SENSOR_STREAM, payload, length, buffer);
 }
 
-size_t MessageProtocol::encodeSensorRequest(uint8_t sensorId, uint8_t* buffer) {
+size_t MessageProtocol::encodePoll(uint8_t sensorId, uint8_t* buffer) {
     uint8_t payload[1];
     payload[0] = sensorId;
 
-    return encodePacket(MSG_SENSOR_REQUEST, payload, 1, buffer);
+    return encodePacket(MSG_POLL, payload, 1, buffer);
+}
+
+size_t MessageProtocol::encodeFragment(const FragmentInfo& fragment, const uint8_t* data, size_t length, uint8_t* buffer, uint16_t* messageId) {
+    if (length > MSG_FRAGMENT_DATA_SIZE || fragment.index >= fragment.count) {
+        return 0;
+    }
+
+    // Built in place behind the room left for the header
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+    payload[0] = fragment.transferId;
+    payload[1] = fragment.index;
+    payload[2] = fragment.count;
+    payload[3] = fragment.type;
+    memcpy(&payload[MSG_FRAGMENT_HEADER_SIZE], data, length);
+
+    return encodePacket(MSG_FRAGMENT, payload, MSG_FRAGMENT_HEADER_SIZE + length, buffer, messageId);
+}
+
+uint8_t MessageProtocol::getFragmentCount(size_t totalLength) {
+    if (totalLength == 0 || totalLength > MSG_MAX_TRANSFER_SIZE) {
+        return 0;
+    }
+    return (uint8_t)((totalLength + MSG_FRAGMENT_DATA_SIZE - 1) / MSG_FRAGMENT_DATA_SIZE);
+}
+
+size_t MessageProtocol::encodeLinkAdr(const LinkAdrInfo& adr, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t payload[MSG_LINK_ADR_PAYLOAD_SIZE];
+
+    payload[0] = adr.op;
+    payload[1] = adr.spreadingFactor;
+    payload[2] = (adr.bandwidth >> 24) & 0xFF;
+    payload[3] = (adr.bandwidth >> 16) & 0xFF;
+    payload[4] = (adr.bandwidth >> 8) & 0xFF;
+    payload[5] = adr.bandwidth & 0xFF;
+    payload[6] = (uint8_t)adr.txPower;
+
+    return encodePacket(MSG_LINK_ADR, payload, MSG_LINK_ADR_PAYLOAD_SIZE, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeBeacon(const BeaconInfo& beacon, uint8_t* buffer) {
+    uint8_t payload[MSG_BEACON_PAYLOAD_SIZE];
+    size_t index = 0;
+
+    payload[index++] = (beacon.periodMs >> 8) & 0xFF;
+    payload[index++] = beacon.periodMs & 0xFF;
+    payload[index++] = (beacon.offsetMs >> 8) & 0xFF;
+    payload[index++] = beacon.offsetMs & 0xFF;
+    payload[index++] = (beacon.hop >> 8) & 0xFF;
+    payload[index++] = beacon.hop & 0xFF;
+    payload[index++] = (beacon.blacklist >> 8) & 0xFF;
+    payload[index++] = beacon.blacklist & 0xFF;
+
+    return encodePacket(MSG_BEACON, payload, index, buffer);
+}
+
+size_t MessageProtocol::encodeSubscribe(const SubscribeInfo& subscribe, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t payload[MSG_SUBSCRIBE_PAYLOAD_SIZE];
+    size_t index = 0;
+
+    payload[index++] = subscribe.sensorMask;
+    payload[index++] = (subscribe.intervalS >> 8) & 0xFF;
+    payload[index++] = subscribe.intervalS & 0xFF;
+    memcpy(&payload[index], &subscribe.deadband, sizeof(float));
+    index += sizeof(float);
+    payload[index++] = (subscribe.leaseS >> 8) & 0xFF;
+    payload[index++] = subscribe.leaseS & 0xFF;
+
+    return encodePacket(MSG_SUBSCRIBE, payload, index, buffer, messageId);
 }
 
-size_t MessageProtocol::encodeSensorResponse(uint8_t sensorId, float value, const char* unit, uint8_t* buffer) {
-    uint8_t payload[64];
+size_t MessageProtocol::encodeSensorResponseWithDevice(const char* deviceName, uint8_t sensorId, float value, const char* unit, uint8_t* buffer, uint16_t* messageId) {
+    // Built in place behind the room left for the header
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
     size_t index = 0;
 
+    // Device name length (1 byte)
+    size_t deviceNameLen = strlen(deviceName);
+    if (deviceNameLen > 31) {
+        deviceNameLen = 31;
+    }
+    payload[index++] = (uint8_t)deviceNameLen;
+
+    // Device name (variable length, no null terminator - length is known)
+    memcpy(&payload[index], deviceName, deviceNameLen);
+    index += deviceNameLen;
+
     // Sensor ID
     payload[index++] = sensorId;
 
@@ -102,18 +567,102 @@ size_t MessageProtocol::encodeSensorResponse(uint8_t sensorId, float value, cons
 
     // Unit string
     size_t unitLen = strlen(unit);
-    if (unitLen > 58) {  // Leave room for sensor ID + float
-        unitLen = 58;
+    if (unitLen > 50) {  // Leave room for device name + sensor ID + float
+        unitLen = 50;
     }
     memcpy(&payload[index], unit, unitLen);
     index += unitLen;
     payload[index++] = '\0';  // Null terminator
 
-    return encodePacket(MSG_SENSOR_RESPONSE, payload, index, buffer);
+    return encodePacket(MSG_SENSOR_RESPONSE, payload, index, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeSensorCompact(const char* deviceName, uint8_t sensorId, float value, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+    SensorReading reading = { sensorId, value };
+
+    // Device name length (1 byte) and name, as in encodeSensorResponseWithDevice
+    size_t index = writeDeviceName(deviceName, payload);
+
+    // Sensor/unit code and fixed-point value (3 bytes for typical readings)
+    return encodeReadings(MSG_SENSOR_COMPACT, payload, index, &reading, 1, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeSensorCompact(uint8_t deviceAddr, uint8_t sensorId, float value, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+    SensorReading reading = { sensorId, value };
+
+    size_t index = writeDeviceAddr(deviceAddr, payload);
+    return encodeReadings(MSG_SENSOR_COMPACT, payload, index, &reading, 1, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeSensorBatch(const char* deviceName, const SensorReading* readings, uint8_t count, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+
+    // Device name once for the whole snapshot
+    size_t index = writeDeviceName(deviceName, payload);
+    return encodeReadings(MSG_SENSOR_BATCH, payload, index, readings, count, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeSensorBatch(uint8_t deviceAddr, const SensorReading* readings, uint8_t count, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+
+    size_t index = writeDeviceAddr(deviceAddr, payload);
+    return encodeReadings(MSG_SENSOR_BATCH, payload, index, readings, count, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeReadings(MessageType type, uint8_t* payload, size_t index,
+                                       const SensorReading* readings, uint8_t count, uint8_t* buffer,
+                                       uint16_t* messageId) {
+    if (count == 0 || count > MSG_MAX_BATCH_READINGS) {
+        return 0;
+    }
+
+    // Reading count
+    if (type == MSG_SENSOR_BATCH) {
+        payload[index++] = count;
+    }
+
+    // Readings back to back
+    for (uint8_t i = 0; i < count; i++) {
+        size_t readingLen = writeReading(readings[i].sensorId, readings[i].value, &payload[index]);
+        if (readingLen == 0) {
+            return 0;  // Code must be in the dictionary
+        }
+        index += readingLen;
+    }
+
+    return encodePacket(type, payload, index, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeJoinRequest(const char* deviceName, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+    size_t index = writeDeviceName(deviceName, payload);
+
+    return encodePacket(MSG_JOIN_REQUEST, payload, index, buffer, messageId);
 }
 
-size_t MessageProtocol::encodeCommand(uint8_t cmdId, const uint8_t* params, size_t paramLen, uint8_t* buffer) {
-    uint8_t payload[MSG_MAX_PAYLOAD];
+size_t MessageProtocol::encodeJoinAccept(uint8_t address, const char* deviceName, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
+    size_t index = 0;
+
+    // Assigned address, then the name it belongs to (nodes match on the name)
+    payload[index++] = address;
+    index += writeDeviceName(deviceName, &payload[index]);
+
+    return encodePacket(MSG_JOIN_ACCEPT, payload, index, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeJoinRejoin(uint8_t address, uint8_t* buffer, uint16_t* messageId) {
+    uint8_t payload[1];
+    payload[0] = address;
+
+    return encodePacket(MSG_JOIN_REJOIN, payload, 1, buffer, messageId);
+}
+
+size_t MessageProtocol::encodeCommand(uint8_t cmdId, const uint8_t* params, size_t paramLen, uint8_t* buffer, uint16_t* messageId) {
+    // Built in place behind the room left for the header
+    uint8_t* payload = &buffer[MSG_MAX_HEADER_SIZE];
     size_t index = 0;
 
     // Command ID
@@ -121,7 +670,7 @@ size_t MessageProtocol::encodeCommand(uint8_t cmdId, const uint8_t* params, size
 
     // Parameters
     if (params != nullptr && paramLen > 0) {
-        size_t maxParams = MSG_MAX_PAYLOAD - 1;
+        size_t maxParams = getMaxPayload() - 1;
         if (paramLen > maxParams) {
             paramLen = maxParams;
         }
@@ -129,11 +678,11 @@ size_t MessageProtocol::encodeCommand(uint8_t cmdId, const uint8_t* params, size
         index += paramLen;
     }
 
-    return encodePacket(MSG_COMMAND, payload, index, buffer);
+    return encodePacket(MSG_COMMAND, payload, index, buffer, messageId);
 }
 
 size_t MessageProtocol::encodeAck(uint16_t msgId, uint8_t status, uint8_t* buffer) {
-    uint8_t payload[3];
+    uint8_t payload[MSG_ACK_PAYLOAD_SIZE];
     size_t index = 0;
 
     // Original message ID (2 bytes, big-endian)
@@ -146,57 +695,106 @@ size_t MessageProtocol::encodeAck(uint16_t msgId, uint8_t status, uint8_t* buffe
     return encodePacket(MSG_ACK, payload, index, buffer);
 }
 
+size_t MessageProtocol::encodeSack(uint16_t msgId, uint8_t status, uint32_t bitmap, uint8_t* buffer) {
+    uint8_t payload[MSG_SACK_PAYLOAD_SIZE];
+    size_t index = 0;
+
+    // Same first three bytes as MSG_ACK
+    payload[index++] = (msgId >> 8) & 0xFF;
+    payload[index++] = msgId & 0xFF;
+    payload[index++] = status;
+
+    // Bitmap (4 bytes, big-endian)
+    payload[index++] = (bitmap >> 24) & 0xFF;
+    payload[index++] = (bitmap >> 16) & 0xFF;
+    payload[index++] = (bitmap >> 8) & 0xFF;
+    payload[index++] = bitmap & 0xFF;
+
+    return encodePacket(MSG_SACK, payload, index, buffer);
+}
+
+void MessageProtocol::setPiggybackAck(uint16_t msgId, uint8_t status) {
+    ackPending = true;
+    ackMessageId = msgId;
+    ackStatus = status;
+    ackDestination = destAddress;
+}
+
+void MessageProtocol::clearPiggybackAck() {
+    ackPending = false;
+}
+
+bool MessageProtocol::hasPiggybackAck() {
+    return ackPending;
+}
+
+void MessageProtocol::setSyn(bool syn) {
+    synPending = syn;
+}
+
+bool MessageProtocol::hasSyn() {
+    return synPending;
+}
+
 // ===== Decoding Methods =====
 
 bool MessageProtocol::decode(const uint8_t* buffer, size_t length, Message& msg) {
-    // Check minimum packet size
-    if (length < MSG_HEADER_SIZE + MSG_CHECKSUM_SIZE) {
+    MessageView view;
+    if (!decodeView(buffer, length, view)) {
         return false;
     }
 
-    // Verify start byte
-    if (buffer[0] != MSG_START_BYTE) {
-        return false;
-    }
+    msg.messageId = view.messageId();
+    msg.type = view.type();
+    msg.payloadLength = view.payloadLength();
 
-    // Verify checksum
-    if (!verifyChecksum(buffer, length)) {
-        return false;
-    }
+    // Extract payload
+    memcpy(msg.payload, view.payload(), msg.payloadLength);
 
-    size_t index = 0;
+    // Initialize RSSI and SNR (will be updated by caller)
+    msg.rssi = 0;
+    msg.snr = 0.0;
 
-    // Skip START byte
-    index++;
+    return true;
+}
 
-    // Extract message ID (2 bytes, big-endian)
-    msg.messageId = (buffer[index] << 8) | buffer[index + 1];
-    index += 2;
+bool MessageProtocol::decodeView(const uint8_t* buffer, size_t length, MessageView& view) {
+    size_t headerSize;
+    uint8_t flags;
 
-    // Extract type
-    msg.type = (MessageType)buffer[index++];
+    view.frame = nullptr;
 
-    // Extract length
-    msg.payloadLength = buffer[index++];
+    // Verify start byte, FLAGS and minimum packet size
+    if (!parseFraming(buffer, length, headerSize, flags)) {
+        return false;
+    }
 
     // Check payload length validity
-    if (msg.payloadLength > MSG_MAX_PAYLOAD) {
+    uint8_t payloadLength = buffer[headerSize - 1];
+    if (payloadLength > MSG_MAX_PAYLOAD) {
         return false;
     }
 
     // Check total length
-    if (length != (size_t)(MSG_HEADER_SIZE + msg.payloadLength + MSG_CHECKSUM_SIZE)) {
+    size_t trailerSize = getTrailerSize(flags & MSG_FLAG_INTEGRITY_MASK);
+    if (length != headerSize + payloadLength + trailerSize) {
         return false;
     }
 
-    // Extract payload
-    for (uint8_t i = 0; i < msg.payloadLength; i++) {
-        msg.payload[i] = buffer[index++];
+    // Verify checksum / CRC
+    if (!verifyChecksum(buffer, length)) {
+        return false;
     }
 
-    // Initialize RSSI and SNR (will be updated by caller)
-    msg.rssi = 0;
-    msg.snr = 0.0;
+    // MSG_ID, TYPE and LENGTH are the last four header bytes
+    view.frame = buffer;
+    view.flags = (buffer[0] == MSG_START_BYTE_V2) ? flags : 0;
+    view.addrOffset = (flags & MSG_FLAG_ADDRESSED) ? 2 : 0;
+    view.ackOffset = (flags & MSG_FLAG_ACK) ? (view.addrOffset ? 2 + MSG_ADDR_FIELDS_SIZE : 2) : 0;
+    view.idOffset = headerSize - 4;
+    view.payloadOffset = headerSize;
+    view.rssi = 0;
+    view.snr = 0.0;
 
     return true;
 }
@@ -211,18 +809,34 @@ const char* MessageProtocol::getMessageTypeName(MessageType type) {
         case MSG_COMMAND: return "COMMAND";
         case MSG_ACK: return "ACK";
         case MSG_NACK: return "NACK";
+        case MSG_SENSOR_COMPACT: return "SENSOR_COMPACT";
+        case MSG_SENSOR_BATCH: return "SENSOR_BATCH";
+        case MSG_JOIN_REQUEST: return "JOIN_REQ";
+        case MSG_JOIN_ACCEPT: return "JOIN_ACCEPT";
+        case MSG_JOIN_REJOIN: return "JOIN_REJOIN";
+        case MSG_SACK: return "SACK";
+        case MSG_SUBSCRIBE: return "SUBSCRIBE";
+        case MSG_SENSOR_STREAM: return "SENSOR_STREAM";
+        case MSG_POLL: return "POLL";
+        case MSG_FRAGMENT: return "FRAGMENT";
+        case MSG_LINK_ADR: return "LINK_ADR";
+        case MSG_BEACON: return "BEACON";
         default: return "UNKNOWN";
     }
 }
 
 const char* MessageProtocol::getSensorName(uint8_t sensorId) {
-    switch (sensorId) {
-        case SENSOR_TEMPERATURE: return "Temperature";
-        case SENSOR_HUMIDITY: return "Humidity";
-        case SENSOR_BATTERY: return "Battery";
-        case SENSOR_PRESSURE: return "Pressure";
-        default: return "Unknown";
+    const SensorInfo* info = getSensorInfo(sensorId);
+    return (info != nullptr) ? info->name : "Unknown";
+}
+
+const SensorInfo* MessageProtocol::getSensorInfo(uint8_t sensorId) {
+    for (size_t i = 0; i < sizeof(SENSOR_DICTIONARY) / sizeof(SENSOR_DICTIONARY[0]); i++) {
+        if (SENSOR_DICTIONARY[i].sensorId == sensorId) {
+            return &SENSOR_DICTIONARY[i];
+        }
     }
+    return nullptr;
 }
 
 const char* MessageProtocol::getCommandName(uint8_t cmdId) {
@@ -241,6 +855,10 @@ bool MessageProtocol::parseSensorResponse(const uint8_t* payload, uint8_t payloa
 
     size_t index = 0;
 
+    // Clear device name (legacy format has no device name)
+    data.deviceName[0] = '\0';
+    data.deviceAddr = MSG_ADDR_NONE;
+
     // Extract sensor ID
     data.sensorId = payload[index++];
 
@@ -257,3 +875,341 @@ bool MessageProtocol::parseSensorResponse(const uint8_t* payload, uint8_t payloa
 
     return true;
 }
+
+bool MessageProtocol::parseSensorResponseWithDevice(const uint8_t* payload, uint8_t payloadLength, SensorData& data) {
+    if (payloadLength < 8) {  // Minimum: device_len(1) + device(1) + sensor_id(1) + float(4) + null(1)
+        return false;
+    }
+
+    size_t index = 0;
+
+    // Extract device name length
+    uint8_t deviceNameLen = payload[index++];
+    if (deviceNameLen > 31 || deviceNameLen + 7 > payloadLength) {
+        // Invalid length or payload too short
+        return false;
+    }
+
+    // Extract device name
+    memcpy(data.deviceName, &payload[index], deviceNameLen);
+    data.deviceName[deviceNameLen] = '\0';
+    data.deviceAddr = MSG_ADDR_NONE;
+    index += deviceNameLen;
+
+    // Extract sensor ID
+    data.sensorId = payload[index++];
+
+    // Extract value (4 bytes float)
+    memcpy(&data.value, &payload[index], sizeof(float));
+    index += sizeof(float);
+
+    // Extract unit string
+    size_t unitLen = 0;
+    while (index < payloadLength && payload[index] != '\0' && unitLen < 15) {
+        data.unit[unitLen++] = payload[index++];
+    }
+    data.unit[unitLen] = '\0';
+
+    return true;
+}
+
+bool MessageProtocol::parseSensorCompact(const uint8_t* payload, uint8_t payloadLength, SensorData& data) {
+    size_t index = readDeviceField(payload, payloadLength, data.deviceName, data.deviceAddr);
+    if (index == 0) {
+        return false;
+    }
+
+    size_t readingLen = readReading(&payload[index], payloadLength - index, data.sensorId, data.value);
+    if (readingLen == 0) {
+        return false;
+    }
+
+    // Unit comes from the dictionary
+    const SensorInfo* info = getSensorInfo(data.sensorId);
+    strncpy(data.unit, info->unit, sizeof(data.unit) - 1);
+    data.unit[sizeof(data.unit) - 1] = '\0';
+
+    return true;
+}
+
+bool MessageProtocol::parseSensorBatch(const uint8_t* payload, uint8_t payloadLength, SensorBatch& batch) {
+    size_t index = readDeviceField(payload, payloadLength, batch.deviceName, batch.deviceAddr);
+    if (index == 0 || index >= payloadLength) {
+        return false;
+    }
+
+    uint8_t count = payload[index++];
+    if (count == 0 || count > MSG_MAX_BATCH_READINGS) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        size_t readingLen = readReading(&payload[index], payloadLength - index,
+                                        batch.readings[i].sensorId, batch.readings[i].value);
+        if (readingLen == 0) {
+            return false;
+        }
+        index += readingLen;
+    }
+
+    batch.count = count;
+    return true;
+}
+
+size_t MessageProtocol::writeDeviceName(const char* deviceName, uint8_t* buffer) {
+    size_t deviceNameLen = strlen(deviceName);
+    if (deviceNameLen > 31) {
+        deviceNameLen = 31;
+    }
+
+    // Length byte, then name without null terminator
+    buffer[0] = (uint8_t)deviceNameLen;
+    memcpy(&buffer[1], deviceName, deviceNameLen);
+
+    return 1 + deviceNameLen;
+}
+
+size_t MessageProtocol::readDeviceName(const uint8_t* buffer, size_t available, char* deviceName) {
+    if (available < 1) {
+        return 0;
+    }
+
+    uint8_t deviceNameLen = buffer[0];
+    if (deviceNameLen > 31 || (size_t)deviceNameLen + 1 > available) {
+        return 0;
+    }
+
+    memcpy(deviceName, &buffer[1], deviceNameLen);
+    deviceName[deviceNameLen] = '\0';
+
+    return 1 + deviceNameLen;
+}
+
+size_t MessageProtocol::writeDeviceAddr(uint8_t deviceAddr, uint8_t* buffer) {
+    buffer[0] = MSG_DEVICE_ADDR_TAG;
+    buffer[1] = deviceAddr;
+
+    return 2;
+}
+
+size_t MessageProtocol::readDeviceField(const uint8_t* buffer, size_t available, char* deviceName, uint8_t& deviceAddr) {
+    if (available >= 2 && buffer[0] == MSG_DEVICE_ADDR_TAG) {
+        // Joined node: the receiver resolves the name from its registry
+        deviceName[0] = '\0';
+        deviceAddr = buffer[1];
+        return 2;
+    }
+
+    deviceAddr = MSG_ADDR_NONE;
+    return readDeviceName(buffer, available, deviceName);
+}
+
+size_t MessageProtocol::writeReading(uint8_t sensorId, float value, uint8_t* buffer) {
+    const SensorInfo* info = getSensorInfo(sensorId);
+    if (info == nullptr) {
+        return 0;
+    }
+
+    // Sensor/unit code
+    buffer[0] = sensorId;
+
+    // Fixed-point value, rounded to the sensor's resolution. Out of range
+    // saturates (the cast alone is undefined), NaN sends the sentinel.
+    float scaled = value * DECIMAL_SCALE[info->decimals];
+    int32_t fixedPoint;
+    if (isnan(scaled)) {
+        fixedPoint = MSG_READING_NONE;
+    } else if (scaled >= 2147483648.0f) {
+        fixedPoint = INT32_MAX;
+    } else if (scaled <= -2147483648.0f) {
+        fixedPoint = -INT32_MAX;
+    } else {
+        fixedPoint = (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+    }
+
+    return 1 + writeVarint(fixedPoint, &buffer[1]);
+}
+
+size_t MessageProtocol::readReading(const uint8_t* buffer, size_t available, uint8_t& sensorId, float& value) {
+    if (available < 2) {
+        return 0;
+    }
+
+    // Resolve sensor/unit code
+    const SensorInfo* info = getSensorInfo(buffer[0]);
+    if (info == nullptr) {
+        return 0;
+    }
+
+    // Fixed-point value
+    int32_t fixedPoint;
+    size_t varintLen = readVarint(&buffer[1], available - 1, fixedPoint);
+    if (varintLen == 0) {
+        return 0;
+    }
+
+    sensorId = buffer[0];
+    value = (fixedPoint == MSG_READING_NONE) ? NAN : (float)fixedPoint / DECIMAL_SCALE[info->decimals];
+
+    return 1 + varintLen;
+}
+
+size_t MessageProtocol::writeVarint(int32_t value, uint8_t* buffer) {
+    // Zigzag: small magnitudes of either sign become small unsigned values
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t index = 0;
+
+    while (zigzag >= 0x80) {
+        buffer[index++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    buffer[index++] = (uint8_t)zigzag;
+
+    return index;
+}
+
+size_t MessageProtocol::readVarint(const uint8_t* buffer, size_t available, int32_t& value) {
+    uint32_t zigzag = 0;
+    uint8_t shift = 0;
+
+    for (size_t i = 0; i < available && i < 5; i++) {
+        zigzag |= (uint32_t)(buffer[i] & 0x7F) << shift;
+        if ((buffer[i] & 0x80) == 0) {
+            value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            return i + 1;
+        }
+        shift += 7;
+    }
+
+    return 0;  // Truncated or too long
+}
+
+bool MessageProtocol::parseSensorResponse(const MessageView& view, SensorData& data) {
+    return parseSensorResponse(view.payload(), view.payloadLength(), data);
+}
+
+bool MessageProtocol::parseSensorResponseWithDevice(const MessageView& view, SensorData& data) {
+    return parseSensorResponseWithDevice(view.payload(), view.payloadLength(), data);
+}
+
+bool MessageProtocol::parseSensorCompact(const MessageView& view, SensorData& data) {
+    return parseSensorCompact(view.payload(), view.payloadLength(), data);
+}
+
+bool MessageProtocol::parseSensorBatch(const MessageView& view, SensorBatch& batch) {
+    return parseSensorBatch(view.payload(), view.payloadLength(), batch);
+}
+
+bool MessageProtocol::parseJoin(const MessageView& view, JoinInfo& join) {
+    const uint8_t* payload = view.payload();
+    uint8_t payloadLength = view.payloadLength();
+    size_t index = 0;
+
+    join.address = MSG_ADDR_NONE;
+    join.deviceName[0] = '\0';
+
+    switch (view.type()) {
+        case MSG_JOIN_REQUEST:
+            break;
+        case MSG_JOIN_ACCEPT:
+        case MSG_JOIN_REJOIN:
+            if (payloadLength < 1) {
+                return false;
+            }
+            join.address = payload[index++];
+            break;
+        default:
+            return false;
+    }
+
+    // Rejoin carries only the address
+    if (view.type() == MSG_JOIN_REJOIN) {
+        return true;
+    }
+
+    return readDeviceName(&payload[index], payloadLength - index, join.deviceName) != 0;
+}
+
+bool MessageProtocol::parseAck(const MessageView& view, AckInfo& ack) {
+    const uint8_t* payload = view.payload();
+    uint8_t payloadLength = view.payloadLength();
+
+    if (view.type() == MSG_ACK) {
+        if (payloadLength < MSG_ACK_PAYLOAD_SIZE) {
+            return false;
+        }
+        ack.bitmap = 0;
+    } else if (view.type() == MSG_SACK) {
+        if (payloadLength < MSG_SACK_PAYLOAD_SIZE) {
+            return false;
+        }
+        ack.bitmap = ((uint32_t)payload[3] << 24) | ((uint32_t)payload[4] << 16) |
+                     ((uint32_t)payload[5] << 8) | payload[6];
+    } else {
+        return false;
+    }
+
+    ack.messageId = ((uint16_t)payload[0] << 8) | payload[1];
+    ack.status = payload[2];
+    return true;
+}
+
+bool MessageProtocol::parseSubscribe(const MessageView& view, SubscribeInfo& subscribe) {
+    const uint8_t* payload = view.payload();
+
+    if (view.type() != MSG_SUBSCRIBE || view.payloadLength() < MSG_SUBSCRIBE_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    subscribe.sensorMask = payload[0];
+    subscribe.intervalS = ((uint16_t)payload[1] << 8) | payload[2];
+    memcpy(&subscribe.deadband, &payload[3], sizeof(float));
+    subscribe.leaseS = ((uint16_t)payload[7] << 8) | payload[8];
+    return true;
+}
+
+bool MessageProtocol::parseFragment(const MessageView& view, FragmentInfo& fragment, const uint8_t*& data, size_t& length) {
+    const uint8_t* payload = view.payload();
+
+    if (view.type() != MSG_FRAGMENT || view.payloadLength() < MSG_FRAGMENT_HEADER_SIZE) {
+        return false;
+    }
+
+    fragment.transferId = payload[0];
+    fragment.index = payload[1];
+    fragment.count = payload[2];
+    fragment.type = payload[3];
+    data = &payload[MSG_FRAGMENT_HEADER_SIZE];
+    length = view.payloadLength() - MSG_FRAGMENT_HEADER_SIZE;
+
+    return fragment.index < fragment.count && length <= MSG_FRAGMENT_DATA_SIZE;
+}
+
+bool MessageProtocol::parseLinkAdr(const MessageView& view, LinkAdrInfo& adr) {
+    const uint8_t* payload = view.payload();
+
+    if (view.type() != MSG_LINK_ADR || view.payloadLength() < MSG_LINK_ADR_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    adr.op = payload[0];
+    adr.spreadingFactor = payload[1];
+    adr.bandwidth = ((uint32_t)payload[2] << 24) | ((uint32_t)payload[3] << 16) |
+                    ((uint32_t)payload[4] << 8) | payload[5];
+    adr.txPower = (int8_t)payload[6];
+    return true;
+}
+
+bool MessageProtocol::parseBeacon(const MessageView& view, BeaconInfo& beacon) {
+    const uint8_t* payload = view.payload();
+
+    if (view.type() != MSG_BEACON || view.payloadLength() < MSG_BEACON_PAYLOAD_SIZE) {
+        return false;
+    }
+
+    beacon.periodMs = ((uint16_t)payload[0] << 8) | payload[1];
+    beacon.offsetMs = ((uint16_t)payload[2] << 8) | payload[3];
+    beacon.hop = ((uint16_t)payload[4] << 8) | payload[5];
+    beacon.blacklist = ((uint16_t)payload[6] << 8) | payload[7];
+    return beacon.periodMs > 0 && beacon.offsetMs < beacon.periodMs;
+}
@@ -4,11 +4,61 @@
 #include <Arduino.h>
 
 // Protocol Constants
-#define MSG_START_BYTE 0xAA
+#define MSG_START_BYTE 0xAA     // Legacy header, XOR checksum
+#define MSG_START_BYTE_V2 0xAB  // Header with FLAGS byte
 #define MSG_MAX_PAYLOAD 250
-#define MSG_HEADER_SIZE 5  // START + MSG_ID(2) + TYPE + LENGTH
+#define MSG_HEADER_SIZE 5     // START + MSG_ID(2) + TYPE + LENGTH
+#define MSG_HEADER_V2_SIZE 6  // START + FLAGS + MSG_ID(2) + TYPE + LENGTH
+#define MSG_ADDR_FIELDS_SIZE 2  // DST + SRC after FLAGS (MSG_FLAG_ADDRESSED)
+#define MSG_ACK_FIELDS_SIZE 3   // Acked MSG_ID(2) + status after the address fields (MSG_FLAG_ACK)
+#define MSG_HEADER_PEEK_SIZE 4  // START + FLAGS + DST + SRC: enough to filter by destination
+#define MSG_MAX_HEADER_SIZE (MSG_HEADER_V2_SIZE + MSG_ADDR_FIELDS_SIZE + MSG_ACK_FIELDS_SIZE)
 #define MSG_CHECKSUM_SIZE 1
-#define MSG_MAX_PACKET_SIZE (MSG_HEADER_SIZE + MSG_MAX_PAYLOAD + MSG_CHECKSUM_SIZE)
+#define MSG_CRC16_SIZE 2
+#define MSG_CRC32_SIZE 4
+#define MSG_MAX_TRAILER_SIZE MSG_CRC32_SIZE
+#define MSG_MAX_FRAME_SIZE 255  // SX1278 FIFO limit
+#define MSG_MAX_PACKET_SIZE (MSG_HEADER_V2_SIZE + MSG_ADDR_FIELDS_SIZE + MSG_MAX_PAYLOAD + MSG_MAX_TRAILER_SIZE)
+#define MSG_ACK_PAYLOAD_SIZE 3  // Acked MSG_ID(2) + status
+#define MSG_SACK_PAYLOAD_SIZE 7 // Cumulative MSG_ID(2) + status + bitmap(4)
+#define MSG_MAX_ACK_SIZE (MSG_HEADER_V2_SIZE + MSG_ADDR_FIELDS_SIZE + MSG_SACK_PAYLOAD_SIZE + MSG_MAX_TRAILER_SIZE)
+#define MSG_SENSOR_RESPONSE_MAX_PAYLOAD 64  // Sensor ID + float + unit + NUL
+#define MSG_SUBSCRIBE_PAYLOAD_SIZE 9  // Sensor mask + interval(2) + deadband(4) + lease(2)
+#define MSG_STREAM_UNIT_MAX 4         // Unit bytes kept in a streamed reading
+#define MSG_FRAGMENT_HEADER_SIZE 4     // Transfer ID + index + count + inner type
+#define MSG_FRAGMENT_DATA_SIZE 200    // Data per fragment (last one may be shorter); fits every header mode
+#define MSG_MAX_TRANSFER_SIZE (255UL * MSG_FRAGMENT_DATA_SIZE)
+#define MSG_LINK_ADR_PAYLOAD_SIZE 7   // Op + SF + bandwidth(4) + TX power
+#define MSG_BEACON_PAYLOAD_SIZE 8     // Period(2) + offset(2) + hop(2) + blacklist(2)
+#define MSG_MAX_STREAM_SIZE (MSG_HEADER_V2_SIZE + MSG_ADDR_FIELDS_SIZE + MSG_ACK_FIELDS_SIZE + \
+                             1 + sizeof(float) + MSG_STREAM_UNIT_MAX + 1 + MSG_MAX_TRAILER_SIZE)
+
+// Short node addresses (assigned by the receiver through MSG_JOIN_*)
+#define MSG_ADDR_NONE 0x00        // Not joined: frames carry the device name inline
+#define MSG_ADDR_GATEWAY 0x01     // Receiver
+#define MSG_ADDR_FIRST_NODE 0x02  // Range handed out to joining nodes
+#define MSG_ADDR_LAST_NODE 0xFE
+#define MSG_ADDR_BROADCAST 0xFF   // Destination: every node
+
+// Device field tag: short address follows instead of length + name
+#define MSG_DEVICE_ADDR_TAG 0x80
+
+// FLAGS byte (v2 header)
+#define MSG_FLAG_INTEGRITY_MASK 0x03  // Bits 0-1: IntegrityMode of the trailer
+#define MSG_FLAG_ADDRESSED 0x04       // Bit 2: DST and SRC bytes follow FLAGS
+#define MSG_FLAG_ACK 0x08             // Bit 3: piggybacked ACK fields follow (after DST/SRC if present)
+#define MSG_FLAG_SYN 0x10             // Bit 4: opens the sender's ID sequence (sent after boot until ACKed)
+
+// Integrity check appended to each frame
+enum IntegrityMode {
+    INTEGRITY_XOR = 0x00,    // 1-byte XOR (legacy)
+    INTEGRITY_CRC16 = 0x01,  // CRC-16-CCITT (poly 0x1021, init 0xFFFF)
+    INTEGRITY_CRC32 = 0x02   // CRC-32 (IEEE 802.3)
+};
+
+#ifndef MSG_DEFAULT_INTEGRITY
+    #define MSG_DEFAULT_INTEGRITY INTEGRITY_CRC16
+#endif
 
 // Message Types
 enum MessageType {
@@ -17,7 +67,19 @@ enum MessageType {
     MSG_SENSOR_RESPONSE = 0x03,// Sensor data response
     MSG_COMMAND = 0x04,        // Control command
     MSG_ACK = 0x05,            // Acknowledgment
-    MSG_NACK = 0x06            // Negative acknowledgment
+    MSG_NACK = 0x06,           // Negative acknowledgment
+    MSG_SENSOR_COMPACT = 0x07, // Sensor reading, dictionary code + fixed-point varint
+    MSG_SENSOR_BATCH = 0x08,   // Several compact readings behind one device name
+    MSG_JOIN_REQUEST = 0x09,   // Node asks for a short address (device name)
+    MSG_JOIN_ACCEPT = 0x0A,    // Short address assigned to a device name
+    MSG_JOIN_REJOIN = 0x0B,    // Receiver does not know this address, join again
+    MSG_SACK = 0x0C,           // Cumulative ACK plus bitmap of frames received above it
+    MSG_SUBSCRIBE = 0x0D,      // Stream sensors at a rate until the lease expires (lease 0 cancels)
+    MSG_SENSOR_STREAM = 0x0E,  // Pushed reading (MSG_SENSOR_RESPONSE payload), not sequenced
+    MSG_POLL = 0x0F,           // One-shot sensor read, answered by MSG_SENSOR_STREAM, not sequenced
+    MSG_FRAGMENT = 0x10,       // Piece of a payload larger than one frame
+    MSG_LINK_ADR = 0x11,       // Adaptive data rate: proposed or confirmed radio settings
+    MSG_BEACON = 0x12          // Slot clock: a send period starts with this frame, not sequenced
 };
 
 // Sensor IDs
@@ -28,6 +90,88 @@ enum SensorId {
     SENSOR_PRESSURE = 0x04
 };
 
+// Sensor dictionary entry: one code identifies sensor, unit and scale.
+// Shared by the compact encoding and DummySensors.
+struct SensorInfo {
+    uint8_t sensorId;
+    const char* name;
+    const char* unit;
+    uint8_t decimals;  // Fixed-point scale on air: value * 10^decimals
+};
+
+// Fixed-point value on air for a missing reading (NaN); others saturate
+// at +/-INT32_MAX
+#define MSG_READING_NONE INT32_MIN
+
+// Most readings carried by one MSG_SENSOR_BATCH frame
+#define MSG_MAX_BATCH_READINGS 8
+
+// One reading inside a batch
+struct SensorReading {
+    uint8_t sensorId;
+    float value;
+};
+
+// Decoded MSG_SENSOR_BATCH payload
+struct SensorBatch {
+    char deviceName[32];
+    uint8_t deviceAddr;  // Short address, MSG_ADDR_NONE if the name was sent inline
+    uint8_t count;
+    SensorReading readings[MSG_MAX_BATCH_READINGS];
+};
+
+// Decoded MSG_JOIN_* payload (fields not carried by the type are cleared)
+struct JoinInfo {
+    uint8_t address;
+    char deviceName[32];
+};
+
+// Decoded MSG_ACK / MSG_SACK payload
+struct AckInfo {
+    uint16_t messageId;  // Cumulative: every ID up to and including this one
+    uint8_t status;
+    uint32_t bitmap;     // Bit i: messageId + 1 + i also received (0 for MSG_ACK)
+};
+
+// Decoded MSG_SUBSCRIBE payload
+struct SubscribeInfo {
+    uint8_t sensorMask;  // Bit (sensorId - 1) set for each streamed sensor
+    uint16_t intervalS;  // Seconds between readings
+    float deadband;      // Skip a reading that moved less than this since the last one sent
+    uint16_t leaseS;     // Seconds without traffic from the subscriber before streaming stops
+};
+
+// MSG_FRAGMENT header: fragment index of count, inner message type.
+// Fragment i carries bytes i * MSG_FRAGMENT_DATA_SIZE onward.
+struct FragmentInfo {
+    uint8_t transferId;  // Same for every fragment of one payload
+    uint8_t index;
+    uint8_t count;
+    uint8_t type;        // MessageType of the reassembled payload
+};
+
+// Decoded MSG_BEACON payload: the receiver's period (hop) clock
+struct BeaconInfo {
+    uint16_t periodMs;   // Send period, one hop long
+    uint16_t offsetMs;   // How far into the current period the beacon went on air
+    uint16_t hop;        // Number of the current period
+    uint16_t blacklist;  // Uplink channels skipped (bit per channel)
+};
+
+// MSG_LINK_ADR operations
+enum LinkAdrOp {
+    ADR_OP_REQUEST = 0x01,  // Switch to these settings once this frame is ACKed
+    ADR_OP_CONFIRM = 0x02   // Sent under the new settings: they work
+};
+
+// Decoded MSG_LINK_ADR payload (settings used by both ends of the link)
+struct LinkAdrInfo {
+    uint8_t op;
+    uint8_t spreadingFactor;
+    uint32_t bandwidth;  // Hz
+    int8_t txPower;      // dBm
+};
+
 // Command IDs
 enum CommandId {
     CMD_LED_ON = 0x01,
@@ -53,11 +197,54 @@ struct Message {
     float snr;
 };
 
+// Read-only view of a validated frame (no payload copy).
+// Accessors point into the buffer passed to decodeView(), which must
+// stay untouched while the view is in use.
+class MessageView {
+public:
+    MessageView() : rssi(0), snr(0.0), frame(nullptr), flags(0), addrOffset(0), ackOffset(0), idOffset(0), payloadOffset(0) {}
+
+    bool isValid() const { return frame != nullptr; }
+
+    uint16_t messageId() const { return ((uint16_t)frame[idOffset] << 8) | frame[idOffset + 1]; }
+    MessageType type() const { return (MessageType)frame[idOffset + 2]; }
+    uint8_t payloadLength() const { return frame[idOffset + 3]; }
+    const uint8_t* payload() const { return &frame[payloadOffset]; }
+
+    // Addresses (unaddressed frames read as broadcast from MSG_ADDR_NONE)
+    uint8_t destination() const { return addrOffset ? frame[addrOffset] : MSG_ADDR_BROADCAST; }
+    uint8_t source() const { return addrOffset ? frame[addrOffset + 1] : MSG_ADDR_NONE; }
+
+    // Piggybacked ACK carried by a data frame (MSG_FLAG_ACK)
+    bool hasAck() const { return ackOffset != 0; }
+    uint16_t ackedId() const { return ((uint16_t)frame[ackOffset] << 8) | frame[ackOffset + 1]; }
+    uint8_t ackStatus() const { return frame[ackOffset + 2]; }
+
+    // Sender (re)started its ID sequence with this frame (MSG_FLAG_SYN)
+    bool isSyn() const { return (flags & MSG_FLAG_SYN) != 0; }
+
+    // Link quality (filled in by caller, like Message)
+    int rssi;
+    float snr;
+
+private:
+    friend class MessageProtocol;
+
+    const uint8_t* frame;
+    uint8_t flags;          // FLAGS byte, 0 for legacy frames
+    uint8_t addrOffset;     // Offset of DST (SRC follows), 0 if unaddressed
+    uint8_t ackOffset;      // Offset of the piggybacked ACK fields, 0 if none
+    uint8_t idOffset;       // Offset of MSG_ID (TYPE and LENGTH follow)
+    uint8_t payloadOffset;  // Offset of first payload byte
+};
+
 // Sensor Response Data
 struct SensorData {
     uint8_t sensorId;
     float value;
     char unit[16];
+    char deviceName[32];  // Device identifier (e.g., "trident1", "trident2")
+    uint8_t deviceAddr;   // Short address, MSG_ADDR_NONE if the name was sent inline
 };
 
 class MessageProtocol {
@@ -65,36 +252,141 @@ public:
     MessageProtocol();
 
     // ===== Encoding Methods =====
+    // All return the frame length, 0 on error. Frames that take part in
+    // the ID sequence also store their MSG_ID in *messageId if given
+    // (the ID the peer's ACK names). Larger payloads are built in the
+    // frame buffer itself, MSG_MAX_HEADER_SIZE bytes in, rather than in
+    // a copy on the stack: buffer must hold MSG_MAX_HEADER_SIZE + payload
+    // bytes as well as the frame (MSG_MAX_PACKET_SIZE always does).
 
-    // Encode text message
-    size_t encodeText(const char* text, uint8_t* buffer);
+    // Encode text message (cut to one frame; longer text goes in MSG_FRAGMENTs)
+    size_t encodeText(const char* text, uint8_t* buffer, uint16_t* messageId = nullptr);
 
     // Encode sensor request
-    size_t encodeSensorRequest(uint8_t sensorId, uint8_t* buffer);
+    size_t encodeSensorRequest(uint8_t sensorId, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode sensor response (legacy - no device name)
+    size_t encodeSensorResponse(uint8_t sensorId, float value, const char* unit, uint8_t* buffer, uint16_t* messageId = nullptr);
 
-    // Encode sensor response
-    size_t encodeSensorResponse(uint8_t sensorId, float value, const char* unit, uint8_t* buffer);
+    // Encode sensor response with device name
+    size_t encodeSensorResponseWithDevice(const char* deviceName, uint8_t sensorId, float value, const char* unit, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode compact sensor reading: device name, dictionary code and a
+    // zigzag varint of the fixed-point value (unit implied by the code)
+    size_t encodeSensorCompact(const char* deviceName, uint8_t sensorId, float value, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode compact sensor reading from a joined node (short address, no name)
+    size_t encodeSensorCompact(uint8_t deviceAddr, uint8_t sensorId, float value, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode a snapshot of several readings behind one device name
+    size_t encodeSensorBatch(const char* deviceName, const SensorReading* readings, uint8_t count, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode a snapshot from a joined node (short address, no name)
+    size_t encodeSensorBatch(uint8_t deviceAddr, const SensorReading* readings, uint8_t count, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode join handshake: request (node), accept and rejoin (receiver)
+    size_t encodeJoinRequest(const char* deviceName, uint8_t* buffer, uint16_t* messageId = nullptr);
+    size_t encodeJoinAccept(uint8_t address, const char* deviceName, uint8_t* buffer, uint16_t* messageId = nullptr);
+    size_t encodeJoinRejoin(uint8_t address, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode subscription request (leaseS 0 cancels the stream)
+    size_t encodeSubscribe(const SubscribeInfo& subscribe, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode a streamed reading: MSG_SENSOR_RESPONSE payload with the unit
+    // cut to MSG_STREAM_UNIT_MAX bytes, at most MSG_MAX_STREAM_SIZE bytes.
+    // Not sequenced and never ACKed: a lost reading is superseded by the next.
+    size_t encodeSensorStream(uint8_t sensorId, float value, const char* unit, uint8_t* buffer);
+
+    // Encode poll: the reply is the acknowledgement, so neither is
+    // sequenced or ACKed (the poller retries on timeout)
+    size_t encodePoll(uint8_t sensorId, uint8_t* buffer);
+
+    // Encode one fragment of a larger payload (length at most
+    // MSG_FRAGMENT_DATA_SIZE). Each fragment is an ordinary sequenced
+    // frame, so ARQ resends only the missing ones.
+    size_t encodeFragment(const FragmentInfo& fragment, const uint8_t* data, size_t length, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Fragments needed for a payload, 0 if above MSG_MAX_TRANSFER_SIZE
+    static uint8_t getFragmentCount(size_t totalLength);
+
+    // Encode adaptive data rate request or confirmation
+    size_t encodeLinkAdr(const LinkAdrInfo& adr, uint8_t* buffer, uint16_t* messageId = nullptr);
+
+    // Encode slot beacon: slotted and hopping senders align their
+    // periods to the receiver's clock it carries
+    size_t encodeBeacon(const BeaconInfo& beacon, uint8_t* buffer);
 
     // Encode command
-    size_t encodeCommand(uint8_t cmdId, const uint8_t* params, size_t paramLen, uint8_t* buffer);
+    size_t encodeCommand(uint8_t cmdId, const uint8_t* params, size_t paramLen, uint8_t* buffer, uint16_t* messageId = nullptr);
 
-    // Encode ACK/NACK
+    // Encode ACK/NACK. ACKs are not sequenced: they carry MSG_ID 0 and
+    // do not consume an ID, so data frames from one sender stay consecutive.
     size_t encodeAck(uint16_t msgId, uint8_t status, uint8_t* buffer);
 
+    // Encode selective ACK: cumulative msgId plus a bitmap of the frames
+    // received out of order after it (bit i: msgId + 1 + i). Not sequenced.
+    size_t encodeSack(uint16_t msgId, uint8_t status, uint32_t bitmap, uint8_t* buffer);
+
+    // Piggyback an ACK on the next data frame encoded for the current
+    // destination (header fields, no extra frame). Cleared once it rides
+    // along, by clearPiggybackAck(), or replaced by a newer call.
+    void setPiggybackAck(uint16_t msgId, uint8_t status);
+    void clearPiggybackAck();
+    bool hasPiggybackAck();
+
     // ===== Decoding Methods =====
 
-    // Decode received packet into Message structure
+    // Decode received packet into Message structure (copies the payload)
     bool decode(const uint8_t* buffer, size_t length, Message& msg);
 
+    // Validate a received packet in place and point a view at it
+    bool decodeView(const uint8_t* buffer, size_t length, MessageView& view);
+
     // ===== Utility Methods =====
 
     // Generate unique message ID
     uint16_t generateMessageId();
 
+    // Jump the ID sequence ahead (tells the peer to restart its receive window)
+    void skipMessageIds(uint16_t count);
+
+    // Mark sequenced frames with MSG_FLAG_SYN, so the peer restarts its
+    // receive window on them instead of taking low IDs after a reboot for
+    // old ones. Set at boot, cleared once the peer has ACKed a frame.
+    void setSyn(bool syn);
+    bool hasSyn();
+
+    // Select integrity check for encoded frames (decode accepts all modes)
+    void setIntegrityMode(IntegrityMode mode);
+    IntegrityMode getIntegrityMode();
+
+    // Own address: once set, frames carry DST and SRC in the header
+    // (MSG_ADDR_NONE, the default, encodes unaddressed frames as before)
+    void setLocalAddress(uint8_t address);
+    uint8_t getLocalAddress();
+
+    // Destination of subsequently encoded frames (default MSG_ADDR_BROADCAST)
+    void setDestination(uint8_t address);
+    uint8_t getDestination();
+
+    // Header-only destination check for the RX path, before the payload is
+    // read or checksummed. True if the frame is unaddressed, broadcast or
+    // for address. Needs the first MSG_HEADER_PEEK_SIZE bytes.
+    static bool acceptsHeader(const uint8_t* header, size_t length, uint8_t address);
+
+    // Largest payload that fits one frame with the current integrity mode
+    size_t getMaxPayload();
+
     // Calculate XOR checksum
     uint8_t calculateChecksum(const uint8_t* data, size_t length);
 
-    // Verify checksum
+    // Calculate CRC-16-CCITT (table-driven, slicing-by-4 on ESP32)
+    uint16_t calculateCrc16(const uint8_t* data, size_t length);
+
+    // Calculate CRC-32 (table-driven, slicing-by-4 on ESP32)
+    uint32_t calculateCrc32(const uint8_t* data, size_t length);
+
+    // Verify the integrity trailer of a complete frame (any mode)
     bool verifyChecksum(const uint8_t* data, size_t length);
 
     // Get message type name (for debugging)
@@ -103,17 +395,99 @@ public:
     // Get sensor name
     const char* getSensorName(uint8_t sensorId);
 
+    // Look up a sensor in the shared dictionary (nullptr if unknown)
+    static const SensorInfo* getSensorInfo(uint8_t sensorId);
+
     // Get command name
     const char* getCommandName(uint8_t cmdId);
 
-    // Parse sensor response payload
+    // Parse sensor response payload (legacy - no device name)
     bool parseSensorResponse(const uint8_t* payload, uint8_t payloadLength, SensorData& data);
 
+    // Parse sensor response with device name
+    bool parseSensorResponseWithDevice(const uint8_t* payload, uint8_t payloadLength, SensorData& data);
+
+    // Parse compact sensor reading
+    bool parseSensorCompact(const uint8_t* payload, uint8_t payloadLength, SensorData& data);
+
+    // Parse sensor batch (snapshot)
+    bool parseSensorBatch(const uint8_t* payload, uint8_t payloadLength, SensorBatch& batch);
+
+    // Parse sensor response straight from a decoded view
+    bool parseSensorResponse(const MessageView& view, SensorData& data);
+    bool parseSensorResponseWithDevice(const MessageView& view, SensorData& data);
+    bool parseSensorCompact(const MessageView& view, SensorData& data);
+    bool parseSensorBatch(const MessageView& view, SensorBatch& batch);
+
+    // Parse any MSG_JOIN_* message
+    bool parseJoin(const MessageView& view, JoinInfo& join);
+
+    // Parse MSG_ACK or MSG_SACK
+    bool parseAck(const MessageView& view, AckInfo& ack);
+
+    // Parse MSG_SUBSCRIBE
+    bool parseSubscribe(const MessageView& view, SubscribeInfo& subscribe);
+
+    // Parse MSG_FRAGMENT; data points into the view
+    bool parseFragment(const MessageView& view, FragmentInfo& fragment, const uint8_t*& data, size_t& length);
+
+    // Parse MSG_LINK_ADR
+    bool parseLinkAdr(const MessageView& view, LinkAdrInfo& adr);
+
+    // Parse MSG_BEACON
+    bool parseBeacon(const MessageView& view, BeaconInfo& beacon);
+
 private:
     uint16_t lastMessageId;
+    IntegrityMode integrityMode;
+    uint8_t localAddress;
+    uint8_t destAddress;
+
+    // ACK waiting to ride on an outgoing data frame
+    bool ackPending;
+    uint16_t ackMessageId;
+    uint8_t ackStatus;
+    uint8_t ackDestination;
+
+    // Sequenced frames carry MSG_FLAG_SYN
+    bool synPending;
+
+    // Header size for the current integrity mode and addressing
+    size_t getHeaderSize();
+
+    // Trailer size for an integrity mode, 0 if unknown
+    size_t getTrailerSize(uint8_t mode);
+
+    // Device name field (length byte + name), shared by the sensor formats
+    size_t writeDeviceName(const char* deviceName, uint8_t* buffer);
+
+    // Sensor ID, float value and NUL-terminated unit (at most unitMax bytes)
+    size_t writeSensorResponse(uint8_t sensorId, float value, const char* unit, size_t unitMax, uint8_t* payload);
+    size_t readDeviceName(const uint8_t* buffer, size_t available, char* deviceName);
+
+    // Device field of compact/batch readings: inline name or tagged short address
+    size_t writeDeviceAddr(uint8_t deviceAddr, uint8_t* buffer);
+    size_t readDeviceField(const uint8_t* buffer, size_t available, char* deviceName, uint8_t& deviceAddr);
+
+    // Append readings (batches carry a count byte first) and frame the payload
+    size_t encodeReadings(MessageType type, uint8_t* payload, size_t index,
+                          const SensorReading* readings, uint8_t count, uint8_t* buffer, uint16_t* messageId);
+
+    // Compact reading (dictionary code + fixed-point varint), 0 on error
+    size_t writeReading(uint8_t sensorId, float value, uint8_t* buffer);
+    size_t readReading(const uint8_t* buffer, size_t available, uint8_t& sensorId, float& value);
+
+    // Signed varint helpers (zigzag + 7 bits per byte)
+    size_t writeVarint(int32_t value, uint8_t* buffer);
+    size_t readVarint(const uint8_t* buffer, size_t available, int32_t& value);
+
+    // Locate header fields: returns header size and FLAGS, false if malformed
+    bool parseFraming(const uint8_t* buffer, size_t length, size_t& headerSize, uint8_t& flags);
 
-    // Internal encoding helper
-    size_t encodePacket(MessageType type, const uint8_t* payload, size_t payloadLength, uint8_t* buffer);
+    // Internal encoding helper; stores the assigned MSG_ID (0 if unsequenced) in messageId.
+    // The payload may already sit in buffer, MSG_MAX_HEADER_SIZE bytes in.
+    size_t encodePacket(MessageType type, const uint8_t* payload, size_t payloadLength, uint8_t* buffer,
+                        uint16_t* messageId = nullptr);
 };
 
 #endif // MESSAGE_PROTOCOL_H
@@ -0,0 +1,267 @@
+#include "NodePoller.h"
+
+NodePoller::NodePoller() : mode(POLL_ROUND_ROBIN), cursor(0) {
+    for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+        nodes[i].address = MSG_ADDR_NONE;
+    }
+}
+
+PollNode* NodePoller::find(uint8_t address) {
+    for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+        if (nodes[i].address == address) {
+            return &nodes[i];
+        }
+    }
+    return nullptr;
+}
+
+bool NodePoller::addNode(uint8_t address, uint8_t sensorMask) {
+    if (address == MSG_ADDR_NONE || sensorMask == 0) {
+        return false;
+    }
+
+    PollNode* node = find(address);
+    if (node != nullptr) {
+        node->sensorMask = sensorMask;
+        node->remaining &= sensorMask;
+        return true;
+    }
+
+    node = find(MSG_ADDR_NONE);
+    if (node == nullptr) {
+        return false;
+    }
+
+    memset(node, 0, sizeof(PollNode));
+    node->address = address;
+    node->sensorMask = sensorMask;
+
+    // First cycle starts on the next call to next()
+    node->cycleStart = millis() - POLL_CYCLE_MS;
+    return true;
+}
+
+bool NodePoller::removeNode(uint8_t address) {
+    PollNode* node = (address != MSG_ADDR_NONE) ? find(address) : nullptr;
+    if (node == nullptr) {
+        return false;
+    }
+    node->address = MSG_ADDR_NONE;
+    return true;
+}
+
+void NodePoller::setMode(PollMode newMode) {
+    mode = newMode;
+}
+
+PollMode NodePoller::getMode() {
+    return mode;
+}
+
+PendingPoll* NodePoller::freePending(PollNode& node) {
+    for (uint8_t i = 0; i < POLL_PIPELINE_DEPTH; i++) {
+        if (node.pending[i].sensorId == 0) {
+            return &node.pending[i];
+        }
+    }
+    return nullptr;
+}
+
+uint8_t NodePoller::nextSensorFor(PollNode& node, unsigned long now) {
+    // Unresponsive: leave it alone until the backoff has passed
+    if (node.failures > 0 && (long)(now - node.backoffUntil) < 0) {
+        return 0;
+    }
+
+    if (freePending(node) == nullptr) {
+        return 0;
+    }
+
+    // Cycle done: start the next one once it is due
+    if (node.remaining == 0) {
+        if (now - node.cycleStart < POLL_CYCLE_MS) {
+            return 0;
+        }
+        node.remaining = node.sensorMask;
+        node.cycleStart = now;
+    }
+
+    // Lowest sensor ID still due in this cycle
+    for (uint8_t id = 1; id <= 8; id++) {
+        if (node.remaining & (1 << (id - 1))) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+bool NodePoller::next(uint8_t& address, uint8_t& sensorId) {
+    unsigned long now = millis();
+    PollNode* chosen = nullptr;
+    uint8_t chosenSensor = 0;
+
+    if (mode == POLL_ROUND_ROBIN) {
+        // First eligible node after the last one polled
+        for (uint8_t n = 0; n < POLL_MAX_NODES && chosen == nullptr; n++) {
+            uint8_t i = (cursor + n) % POLL_MAX_NODES;
+            if (nodes[i].address == MSG_ADDR_NONE) {
+                continue;
+            }
+            chosenSensor = nextSensorFor(nodes[i], now);
+            if (chosenSensor != 0) {
+                chosen = &nodes[i];
+                cursor = (i + 1) % POLL_MAX_NODES;
+            }
+        }
+    } else {
+        // Oldest reading first; nodes never heard from are the stalest
+        unsigned long stalest = 0;
+        for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+            if (nodes[i].address == MSG_ADDR_NONE) {
+                continue;
+            }
+            unsigned long age = (nodes[i].replies > 0) ? now - nodes[i].lastReply : 0xFFFFFFFFUL;
+            if (chosen != nullptr && age <= stalest) {
+                continue;
+            }
+            uint8_t id = nextSensorFor(nodes[i], now);
+            if (id != 0) {
+                chosen = &nodes[i];
+                chosenSensor = id;
+                stalest = age;
+            }
+        }
+    }
+
+    if (chosen == nullptr) {
+        return false;
+    }
+
+    PendingPoll* pending = freePending(*chosen);
+    pending->sensorId = chosenSensor;
+    pending->sentAt = now;
+    chosen->remaining &= ~(1 << (chosenSensor - 1));
+    chosen->polls++;
+
+    address = chosen->address;
+    sensorId = chosenSensor;
+    return true;
+}
+
+bool NodePoller::handleReply(uint8_t address, uint8_t sensorId) {
+    PollNode* node = (address != MSG_ADDR_NONE) ? find(address) : nullptr;
+    if (node == nullptr || sensorId == 0) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < POLL_PIPELINE_DEPTH; i++) {
+        PendingPoll& pending = node->pending[i];
+        if (pending.sensorId != sensorId) {
+            continue;
+        }
+
+        unsigned long now = millis();
+        unsigned long latency = now - pending.sentAt;
+        pending.sensorId = 0;
+
+        node->replies++;
+        node->latencySum += latency;
+        node->lastLatency = (latency < 0xFFFF) ? latency : 0xFFFF;
+        node->lastReply = now;
+        node->failures = 0;
+        return true;
+    }
+
+    return false;
+}
+
+void NodePoller::checkTimeouts() {
+    unsigned long now = millis();
+
+    for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+        PollNode& node = nodes[i];
+        if (node.address == MSG_ADDR_NONE) {
+            continue;
+        }
+
+        for (uint8_t p = 0; p < POLL_PIPELINE_DEPTH; p++) {
+            PendingPoll& pending = node.pending[p];
+            if (pending.sensorId == 0 || now - pending.sentAt < POLL_TIMEOUT_MS) {
+                continue;
+            }
+            pending.sensorId = 0;
+
+            // Exponential backoff: base, 2x, 4x ... capped
+            if (node.failures < 255) {
+                node.failures++;
+            }
+            unsigned long backoff = POLL_BACKOFF_BASE_MS;
+            for (uint8_t f = 1; f < node.failures && backoff < POLL_BACKOFF_MAX_MS; f++) {
+                backoff <<= 1;
+            }
+            if (backoff > POLL_BACKOFF_MAX_MS) {
+                backoff = POLL_BACKOFF_MAX_MS;
+            }
+            node.backoffUntil = now + backoff;
+        }
+    }
+}
+
+uint8_t NodePoller::getCount() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+        if (nodes[i].address != MSG_ADDR_NONE) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint8_t NodePoller::getInFlight() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+        if (nodes[i].address == MSG_ADDR_NONE) {
+            continue;
+        }
+        for (uint8_t p = 0; p < POLL_PIPELINE_DEPTH; p++) {
+            if (nodes[i].pending[p].sensorId != 0) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+void NodePoller::printStats() {
+    Serial.print(F("Polled nodes ("));
+    Serial.print(mode == POLL_ROUND_ROBIN ? F("round-robin") : F("stalest first"));
+    Serial.println(F("):"));
+
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < POLL_MAX_NODES; i++) {
+        const PollNode& node = nodes[i];
+        if (node.address == MSG_ADDR_NONE) {
+            continue;
+        }
+
+        Serial.print(F("  0x"));
+        Serial.print(node.address, HEX);
+        Serial.print(F(": "));
+        Serial.print(node.replies);
+        Serial.print(F("/"));
+        Serial.print(node.polls);
+        Serial.print(F(" replies ("));
+        Serial.print(node.polls > 0 ? (node.replies * 100UL) / node.polls : 0UL);
+        Serial.print(F("%), avg "));
+        Serial.print(node.replies > 0 ? node.latencySum / node.replies : 0UL);
+        Serial.print(F(" ms, last "));
+        Serial.print(node.lastLatency);
+        Serial.print(F(" ms"));
+        if (node.failures > 0 && (long)(now - node.backoffUntil) < 0) {
+            Serial.print(F(", backoff "));
+            Serial.print((node.backoffUntil - now) / 1000);
+            Serial.print(F(" s"));
+        }
+        Serial.println();
+    }
+}
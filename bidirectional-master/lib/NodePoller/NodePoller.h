@@ -0,0 +1,119 @@
+#ifndef NODE_POLLER_H
+#define NODE_POLLER_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Nodes in the polling table
+#ifndef POLL_MAX_NODES
+    #define POLL_MAX_NODES 8
+#endif
+
+// Polls a node may have unanswered at once
+#ifndef POLL_PIPELINE_DEPTH
+    #define POLL_PIPELINE_DEPTH 2
+#endif
+
+// A poll without a reply after this long counts as lost (ms)
+#ifndef POLL_TIMEOUT_MS
+    #define POLL_TIMEOUT_MS 1000
+#endif
+
+// Backoff after consecutive timeouts: doubled per failure up to the maximum (ms)
+#ifndef POLL_BACKOFF_BASE_MS
+    #define POLL_BACKOFF_BASE_MS 2000
+#endif
+#ifndef POLL_BACKOFF_MAX_MS
+    #define POLL_BACKOFF_MAX_MS 60000
+#endif
+
+// Each node's sensors are polled once per cycle (ms from cycle start)
+#ifndef POLL_CYCLE_MS
+    #define POLL_CYCLE_MS 5000
+#endif
+
+// How the next node is picked
+enum PollMode {
+    POLL_ROUND_ROBIN,  // Every eligible node in table order
+    POLL_STALEST       // Eligible node whose last reading is oldest
+};
+
+// One poll awaiting its reply
+struct PendingPoll {
+    uint8_t sensorId;      // 0 if the entry is free
+    unsigned long sentAt;
+};
+
+// One polled node
+struct PollNode {
+    uint8_t address;       // MSG_ADDR_NONE if the slot is free
+    uint8_t sensorMask;    // Bit (sensorId - 1) for each polled sensor
+    uint8_t remaining;     // Sensors still to poll in this cycle
+    uint8_t failures;      // Consecutive timeouts
+    unsigned long backoffUntil;
+    unsigned long cycleStart;
+    unsigned long lastReply;
+    PendingPoll pending[POLL_PIPELINE_DEPTH];
+    uint32_t polls;
+    uint32_t replies;
+    uint32_t latencySum;   // ms, over all replies
+    uint16_t lastLatency;  // ms
+};
+
+// Polling engine for many slave nodes.
+//
+// Keeps the node table and decides who is polled next; sending and
+// receiving stay with the caller. Each node may have up to
+// POLL_PIPELINE_DEPTH polls in flight (one per sensor), polls without a
+// reply time out, and a node that keeps timing out is skipped for an
+// exponentially growing backoff until it answers again.
+class NodePoller {
+public:
+    NodePoller();
+
+    // Add a node (or update its sensors). False if the table is full.
+    bool addNode(uint8_t address, uint8_t sensorMask);
+
+    // Remove a node, false if unknown
+    bool removeNode(uint8_t address);
+
+    // Selection policy
+    void setMode(PollMode mode);
+    PollMode getMode();
+
+    // Pick the next poll to send and record it as in flight.
+    // False if no node is eligible right now.
+    bool next(uint8_t& address, uint8_t& sensorId);
+
+    // Match a reading from a node to its poll. True if one was pending.
+    bool handleReply(uint8_t address, uint8_t sensorId);
+
+    // Expire unanswered polls, backing off their nodes
+    void checkTimeouts();
+
+    // Table occupancy
+    uint8_t getCount();
+
+    // Polls currently in flight, all nodes
+    uint8_t getInFlight();
+
+    // Print per-node latency and success rate
+    void printStats();
+
+private:
+    PollNode nodes[POLL_MAX_NODES];
+    PollMode mode;
+    uint8_t cursor;  // Round-robin position
+
+    PollNode* find(uint8_t address);
+
+    // Sensor to poll on this node now, 0 if none (pipeline full, backing
+    // off, or this cycle done)
+    uint8_t nextSensorFor(PollNode& node, unsigned long now);
+
+    // Free pipeline entry, nullptr if full
+    PendingPoll* freePending(PollNode& node);
+};
+
+#endif // NODE_POLLER_H
@@ -0,0 +1,134 @@
+#include "Reassembler.h"
+
+Reassembler::Reassembler() : completed(0), evicted(0), refused(0) {
+    for (uint8_t i = 0; i < REASSEMBLY_SLOTS; i++) {
+        slots[i].active = false;
+    }
+}
+
+Reassembly* Reassembler::find(uint8_t source, uint8_t transferId) {
+    for (uint8_t i = 0; i < REASSEMBLY_SLOTS; i++) {
+        if (slots[i].active && slots[i].source == source && slots[i].transferId == transferId) {
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+const Reassembly* Reassembler::add(uint8_t source, const FragmentInfo& fragment, const uint8_t* data, size_t length) {
+    size_t offset = (size_t)fragment.index * MSG_FRAGMENT_DATA_SIZE;
+
+    // Every fragment but the last is full size
+    bool last = (fragment.index == fragment.count - 1);
+    if (!last && length != MSG_FRAGMENT_DATA_SIZE) {
+        return nullptr;
+    }
+
+    Reassembly* transfer = find(source, fragment.transferId);
+    if (transfer == nullptr) {
+        expire();
+
+        // Too big for a slot: refuse up front instead of failing at the end
+        if ((size_t)(fragment.count - 1) * MSG_FRAGMENT_DATA_SIZE >= REASSEMBLY_BUFFER_SIZE) {
+            refused++;
+            return nullptr;
+        }
+
+        for (uint8_t i = 0; i < REASSEMBLY_SLOTS && transfer == nullptr; i++) {
+            if (!slots[i].active) {
+                transfer = &slots[i];
+            }
+        }
+        if (transfer == nullptr) {
+            refused++;
+            return nullptr;
+        }
+
+        transfer->active = true;
+        transfer->source = source;
+        transfer->transferId = fragment.transferId;
+        transfer->type = fragment.type;
+        transfer->count = fragment.count;
+        transfer->received = 0;
+        memset(transfer->present, 0, sizeof(transfer->present));
+        transfer->length = 0;
+        transfer->startedAt = millis();
+    } else if (transfer->count != fragment.count) {
+        // Transfer ID reused with a different shape: not ours to merge
+        return nullptr;
+    }
+
+    transfer->lastActivity = millis();
+
+    uint32_t bit = 1UL << (fragment.index & 31);
+    uint32_t& word = transfer->present[fragment.index >> 5];
+    if (word & bit) {
+        return nullptr;  // Already stored
+    }
+
+    if (offset + length > REASSEMBLY_BUFFER_SIZE) {
+        // Last fragment overruns the buffer: give up on the transfer
+        transfer->active = false;
+        refused++;
+        return nullptr;
+    }
+
+    memcpy(&transfer->data[offset], data, length);
+    word |= bit;
+    transfer->received++;
+    if (last) {
+        transfer->length = offset + length;
+    }
+
+    if (transfer->received < transfer->count) {
+        return nullptr;
+    }
+
+    completed++;
+    return transfer;
+}
+
+void Reassembler::release(const Reassembly* transfer) {
+    for (uint8_t i = 0; i < REASSEMBLY_SLOTS; i++) {
+        if (&slots[i] == transfer) {
+            slots[i].active = false;
+        }
+    }
+}
+
+uint8_t Reassembler::expire() {
+    unsigned long now = millis();
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < REASSEMBLY_SLOTS; i++) {
+        if (slots[i].active && now - slots[i].lastActivity >= REASSEMBLY_TIMEOUT_MS) {
+            slots[i].active = false;
+            evicted++;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+uint8_t Reassembler::getActive() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < REASSEMBLY_SLOTS; i++) {
+        if (slots[i].active) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t Reassembler::getCompleted() {
+    return completed;
+}
+
+uint32_t Reassembler::getEvicted() {
+    return evicted;
+}
+
+uint32_t Reassembler::getRefused() {
+    return refused;
+}
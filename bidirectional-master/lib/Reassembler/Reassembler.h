@@ -0,0 +1,78 @@
+#ifndef REASSEMBLER_H
+#define REASSEMBLER_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Transfers reassembled at once
+#ifndef REASSEMBLY_SLOTS
+    #define REASSEMBLY_SLOTS 2
+#endif
+
+// Largest payload one slot can hold (bytes)
+#ifndef REASSEMBLY_BUFFER_SIZE
+    #define REASSEMBLY_BUFFER_SIZE 4096
+#endif
+
+// A transfer with no new fragment for this long is evicted (ms)
+#ifndef REASSEMBLY_TIMEOUT_MS
+    #define REASSEMBLY_TIMEOUT_MS 30000
+#endif
+
+static_assert(REASSEMBLY_SLOTS >= 1, "REASSEMBLY_SLOTS must be at least 1");
+
+// One payload being put back together
+struct Reassembly {
+    bool active;
+    uint8_t source;
+    uint8_t transferId;
+    uint8_t type;                 // Inner MessageType
+    uint8_t count;                // Fragments in the transfer
+    uint8_t received;             // Fragments stored so far
+    uint32_t present[8];          // Bit i: fragment i stored
+    size_t length;                // Total size, known once the last fragment arrived
+    unsigned long startedAt;
+    unsigned long lastActivity;
+    uint8_t data[REASSEMBLY_BUFFER_SIZE];
+};
+
+// Reassembly of MSG_FRAGMENT transfers into a fixed pool of buffers.
+//
+// Fragments may arrive in any order and more than once; each lands at
+// its offset (index * MSG_FRAGMENT_DATA_SIZE). A transfer is identified
+// by source address and transfer ID. Stalled transfers are evicted after
+// REASSEMBLY_TIMEOUT_MS so a lost sender cannot hold a slot forever; a
+// new transfer finding no free slot is refused until one expires.
+class Reassembler {
+public:
+    Reassembler();
+
+    // Store one fragment. Returns the transfer once its last missing
+    // fragment is in (hand it back with release()), nullptr otherwise.
+    const Reassembly* add(uint8_t source, const FragmentInfo& fragment, const uint8_t* data, size_t length);
+
+    // Free a completed transfer's slot
+    void release(const Reassembly* transfer);
+
+    // Evict transfers that stalled, returns number evicted
+    uint8_t expire();
+
+    // Transfers in progress
+    uint8_t getActive();
+
+    // Counters: transfers completed, evicted on timeout, refused (no slot or too large)
+    uint32_t getCompleted();
+    uint32_t getEvicted();
+    uint32_t getRefused();
+
+private:
+    Reassembly slots[REASSEMBLY_SLOTS];
+    uint32_t completed;
+    uint32_t evicted;
+    uint32_t refused;
+
+    Reassembly* find(uint8_t source, uint8_t transferId);
+};
+
+#endif // REASSEMBLER_H
@@ -0,0 +1,57 @@
+#include "RxInbox.h"
+
+RxInbox::RxInbox() : freeCount(RX_INBOX_SLOTS), queueHead(0), queueCount(0), dropped(0) {
+    for (uint8_t i = 0; i < RX_INBOX_SLOTS; i++) {
+        freeSlots[i] = i;
+    }
+}
+
+bool RxInbox::push(const RxPacket& packet) {
+    if (freeCount == 0) {
+        dropped++;
+        return false;
+    }
+
+    uint8_t index = freeSlots[--freeCount];
+    RxPacket& slot = pool[index];
+
+    // Only the bytes actually received
+    memcpy(slot.data, packet.data, packet.length);
+    slot.length = packet.length;
+    slot.rssi = packet.rssi;
+    slot.snr = packet.snr;
+    slot.timestamp = packet.timestamp;
+
+    queue[(queueHead + queueCount) % RX_INBOX_SLOTS] = index;
+    queueCount++;
+    return true;
+}
+
+const RxPacket* RxInbox::front() {
+    if (queueCount == 0) {
+        return nullptr;
+    }
+    return &pool[queue[queueHead]];
+}
+
+void RxInbox::release() {
+    if (queueCount == 0) {
+        return;
+    }
+
+    freeSlots[freeCount++] = queue[queueHead];
+    queueHead = (queueHead + 1) % RX_INBOX_SLOTS;
+    queueCount--;
+}
+
+uint8_t RxInbox::getCount() {
+    return queueCount;
+}
+
+bool RxInbox::isEmpty() {
+    return queueCount == 0;
+}
+
+uint32_t RxInbox::getDropped() {
+    return dropped;
+}
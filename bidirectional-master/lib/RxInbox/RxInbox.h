@@ -0,0 +1,59 @@
+#ifndef RX_INBOX_H
+#define RX_INBOX_H
+
+#include <Arduino.h>
+#include "LoRaComm.h"
+#include "board_config.h"
+
+// Received frames queued for the application
+#ifndef RX_INBOX_SLOTS
+    #define RX_INBOX_SLOTS 4
+#endif
+
+static_assert(RX_INBOX_SLOTS >= 1 && RX_INBOX_SLOTS <= 255, "RX_INBOX_SLOTS must be between 1 and 255");
+
+// Bounded inbox of validated frames waiting to be handled.
+//
+// The RX ring only buffers between the DIO0 ISR and loop(); the inbox
+// takes frames out of it as soon as they are decoded, so the ring keeps
+// room for the ISR and ACKs behind a queued frame are seen at once.
+// Slots come from a fixed pool (free list) and are handed out in
+// arrival order through an index queue: no allocation, no copying
+// beyond the frame itself.
+class RxInbox {
+public:
+    RxInbox();
+
+    // Copy a frame into a free slot and queue it. False (and counted as
+    // dropped) if every slot is in use.
+    bool push(const RxPacket& packet);
+
+    // Oldest queued frame, nullptr if the inbox is empty
+    const RxPacket* front();
+
+    // Return the oldest frame's slot to the pool
+    void release();
+
+    // Occupancy
+    uint8_t getCount();
+    bool isEmpty();
+
+    // Number of frames dropped because the inbox was full
+    uint32_t getDropped();
+
+private:
+    RxPacket pool[RX_INBOX_SLOTS];
+
+    // Free slots (stack of pool indices)
+    uint8_t freeSlots[RX_INBOX_SLOTS];
+    uint8_t freeCount;
+
+    // Queued slots in arrival order (ring of pool indices)
+    uint8_t queue[RX_INBOX_SLOTS];
+    uint8_t queueHead;
+    uint8_t queueCount;
+
+    uint32_t dropped;
+};
+
+#endif // RX_INBOX_H
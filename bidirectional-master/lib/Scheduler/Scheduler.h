@@ -0,0 +1,87 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Task slots per scheduler
+#ifndef SCHEDULER_MAX_TASKS
+    #define SCHEDULER_MAX_TASKS 8
+#endif
+
+// Event flags sleep() watches (see wakeOn())
+#ifndef SCHEDULER_MAX_WAKE_FLAGS
+    #define SCHEDULER_MAX_WAKE_FLAGS 2
+#endif
+
+#define SCHEDULER_NO_TASK 0xFF
+#define SCHEDULER_FOREVER 0xFFFFFFFFUL
+
+typedef void (*TaskCallback)();
+
+// One registered task
+struct ScheduledTask {
+    TaskCallback callback;   // nullptr if the slot is free
+    unsigned long deadline;  // millis() of the next run
+    unsigned long period;    // 0 for one-shot tasks
+    bool armed;
+};
+
+// Deadline scheduler for the main loop.
+//
+// Replaces delay() and hand-written millis() arithmetic: periodic work
+// (sends, stats) and timeouts (LED pulses, retries) are tasks with a
+// deadline, run() fires the due ones, and sleep() idles until the next
+// deadline, a radio interrupt (wakeOn(), wake()) or serial input.
+class Scheduler {
+public:
+    Scheduler();
+
+    // Register a task without arming it (arm with reschedule())
+    uint8_t add(TaskCallback callback);
+
+    // Run callback every periodMs (first run after one period, or now)
+    uint8_t every(unsigned long periodMs, TaskCallback callback, bool runNow = false);
+
+    // Run callback once after delayMs (task stays registered for reschedule())
+    uint8_t after(unsigned long delayMs, TaskCallback callback);
+
+    // Arm a task to run delayMs from now (periodic tasks keep their period)
+    void reschedule(uint8_t taskId, unsigned long delayMs);
+
+    // Disarm a task
+    void stop(uint8_t taskId);
+
+    // Check if a task is armed
+    bool isPending(uint8_t taskId);
+
+    // Run every due task; returns ms until the next deadline
+    unsigned long run();
+
+    // Ms until the next deadline, SCHEDULER_FOREVER if nothing is armed
+    unsigned long timeUntilNext();
+
+    // Idle until the next deadline (or maxMs), wake() or serial input
+    void sleep(unsigned long maxMs = SCHEDULER_FOREVER);
+
+    // End the current sleep() early (safe from interrupt context)
+    static void wake();
+
+    // Also end sleep() while *flag is set, e.g. an ISR's event-pending
+    // flag: the ISR needs no callback. False if all slots are taken.
+    bool wakeOn(const volatile bool* flag);
+
+private:
+    ScheduledTask tasks[SCHEDULER_MAX_TASKS];
+
+    static volatile bool wakePending;
+
+    const volatile bool* wakeFlags[SCHEDULER_MAX_WAKE_FLAGS];
+    uint8_t wakeFlagCount;
+
+    // True if wake() was called or a watched flag is set
+    bool isWoken();
+
+    uint8_t allocate(TaskCallback callback, unsigned long delayMs, unsigned long periodMs, bool armed);
+};
+
+#endif // SCHEDULER_H
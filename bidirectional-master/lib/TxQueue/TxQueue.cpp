@@ -0,0 +1,244 @@
+#include "TxQueue.h"
+
+#define TX_NO_SLOT 0xFF
+
+TxQueue::TxQueue()
+    : freeCount(TX_QUEUE_SLOTS), reserved(TX_NO_SLOT), reservedClass(0),
+      peekClass(TX_CLASS_COUNT), dropCallback(nullptr) {
+    for (uint8_t i = 0; i < TX_QUEUE_SLOTS; i++) {
+        freeSlots[i] = i;
+    }
+    for (uint8_t c = 0; c < TX_CLASS_COUNT; c++) {
+        queueHead[c] = 0;
+        queueCount[c] = 0;
+        dropped[c] = 0;
+        expired[c] = 0;
+    }
+}
+
+bool TxQueue::allocate(uint8_t txClass, uint8_t& index) {
+    if (queueCount[txClass] >= TX_QUEUE_CLASS_DEPTH) {
+        dropped[txClass]++;
+        return false;
+    }
+
+    if (freeCount == 0) {
+        // Preempt the frame that would leave last: newest of the lowest class
+        uint8_t victim = TX_CLASS_COUNT - 1;
+        while (victim > txClass && queueCount[victim] == 0) {
+            victim--;
+        }
+        if (victim <= txClass) {
+            dropped[txClass]++;
+            return false;
+        }
+
+        uint8_t pos = queueCount[victim] - 1;
+        dropped[victim]++;
+        if (dropCallback != nullptr) {
+            dropCallback(pool[queue[victim][(queueHead[victim] + pos) % TX_QUEUE_CLASS_DEPTH]]);
+        }
+        removeAt(victim, pos);
+    }
+
+    index = freeSlots[--freeCount];
+    return true;
+}
+
+void TxQueue::push(uint8_t index, uint8_t txClass, size_t length, unsigned long ttlMs, uint8_t tag) {
+    TxEntry& entry = pool[index];
+    entry.length = (uint8_t)length;
+    entry.txClass = txClass;
+    entry.tag = tag;
+    entry.expires = (ttlMs != TX_TTL_NONE);
+    entry.deadline = millis() + ttlMs;
+
+    queue[txClass][(queueHead[txClass] + queueCount[txClass]) % TX_QUEUE_CLASS_DEPTH] = index;
+    queueCount[txClass]++;
+}
+
+void TxQueue::removeAt(uint8_t txClass, uint8_t pos) {
+    uint8_t* ring = queue[txClass];
+    uint8_t head = queueHead[txClass];
+
+    freeSlots[freeCount++] = ring[(head + pos) % TX_QUEUE_CLASS_DEPTH];
+
+    // Close the gap, keeping FIFO order
+    for (uint8_t i = pos; i + 1 < queueCount[txClass]; i++) {
+        ring[(head + i) % TX_QUEUE_CLASS_DEPTH] = ring[(head + i + 1) % TX_QUEUE_CLASS_DEPTH];
+    }
+    queueCount[txClass]--;
+
+    // A pending peek() may no longer point at the head
+    peekClass = TX_CLASS_COUNT;
+}
+
+uint8_t* TxQueue::reserve(TxClass txClass) {
+    // An uncommitted reservation is abandoned
+    if (reserved != TX_NO_SLOT) {
+        freeSlots[freeCount++] = reserved;
+        reserved = TX_NO_SLOT;
+    }
+
+    uint8_t index;
+    if (!allocate(txClass, index)) {
+        return nullptr;
+    }
+
+    reserved = index;
+    reservedClass = txClass;
+    pool[index].frame = pool[index].data;
+    return pool[index].data;
+}
+
+bool TxQueue::commit(size_t length, unsigned long ttlMs, uint8_t tag) {
+    if (reserved == TX_NO_SLOT) {
+        return false;
+    }
+
+    uint8_t index = reserved;
+    reserved = TX_NO_SLOT;
+
+    if (length == 0 || length > TX_QUEUE_FRAME_SIZE) {
+        freeSlots[freeCount++] = index;
+        return false;
+    }
+
+    push(index, reservedClass, length, ttlMs, tag);
+    return true;
+}
+
+bool TxQueue::enqueue(TxClass txClass, const uint8_t* frame, size_t length,
+                      unsigned long ttlMs, uint8_t tag) {
+    if (length == 0 || length > TX_QUEUE_FRAME_SIZE) {
+        dropped[txClass]++;
+        return false;
+    }
+
+    uint8_t* buffer = reserve(txClass);
+    if (buffer == nullptr) {
+        return false;
+    }
+
+    memcpy(buffer, frame, length);
+    return commit(length, ttlMs, tag);
+}
+
+bool TxQueue::enqueueRef(TxClass txClass, const uint8_t* frame, size_t length,
+                         unsigned long ttlMs, uint8_t tag) {
+    uint8_t index;
+    if (length == 0 || !allocate(txClass, index)) {
+        return false;
+    }
+
+    pool[index].frame = frame;
+    push(index, txClass, length, ttlMs, tag);
+    return true;
+}
+
+const TxEntry* TxQueue::peek() {
+    unsigned long now = millis();
+
+    for (uint8_t c = 0; c < TX_CLASS_COUNT; c++) {
+        while (queueCount[c] > 0) {
+            TxEntry& entry = pool[queue[c][queueHead[c]]];
+
+            if (entry.expires && (long)(now - entry.deadline) >= 0) {
+                expired[c]++;
+                if (dropCallback != nullptr) {
+                    dropCallback(entry);
+                }
+                removeAt(c, 0);
+                continue;
+            }
+
+            peekClass = c;
+            return &entry;
+        }
+    }
+
+    peekClass = TX_CLASS_COUNT;
+    return nullptr;
+}
+
+void TxQueue::pop() {
+    if (peekClass >= TX_CLASS_COUNT || queueCount[peekClass] == 0) {
+        return;
+    }
+
+    uint8_t c = peekClass;
+    freeSlots[freeCount++] = queue[c][queueHead[c]];
+    queueHead[c] = (queueHead[c] + 1) % TX_QUEUE_CLASS_DEPTH;
+    queueCount[c]--;
+    peekClass = TX_CLASS_COUNT;
+}
+
+uint8_t TxQueue::cancel(const uint8_t* frame) {
+    uint8_t removed = 0;
+
+    for (uint8_t c = 0; c < TX_CLASS_COUNT; c++) {
+        uint8_t pos = 0;
+        while (pos < queueCount[c]) {
+            if (pool[queue[c][(queueHead[c] + pos) % TX_QUEUE_CLASS_DEPTH]].frame == frame) {
+                removeAt(c, pos);
+                removed++;
+            } else {
+                pos++;
+            }
+        }
+    }
+
+    return removed;
+}
+
+void TxQueue::onDrop(void (*callback)(const TxEntry& entry)) {
+    dropCallback = callback;
+}
+
+uint8_t TxQueue::getDepth(TxClass txClass) {
+    return queueCount[txClass];
+}
+
+uint8_t TxQueue::getCount() {
+    uint8_t count = 0;
+    for (uint8_t c = 0; c < TX_CLASS_COUNT; c++) {
+        count += queueCount[c];
+    }
+    return count;
+}
+
+bool TxQueue::isEmpty() {
+    return getCount() == 0;
+}
+
+uint32_t TxQueue::getDropped(TxClass txClass) {
+    return dropped[txClass];
+}
+
+uint32_t TxQueue::getExpired(TxClass txClass) {
+    return expired[txClass];
+}
+
+const char* TxQueue::getClassName(uint8_t txClass) {
+    switch (txClass) {
+        case TX_CLASS_CONTROL:   return "control";
+        case TX_CLASS_ALARM:     return "alarm";
+        case TX_CLASS_TELEMETRY: return "telemetry";
+        case TX_CLASS_BULK:      return "bulk";
+        default:                 return "unknown";
+    }
+}
+
+void TxQueue::printStats() {
+    Serial.println(F("TX queue (queued/dropped/expired):"));
+    for (uint8_t c = 0; c < TX_CLASS_COUNT; c++) {
+        Serial.print(F("  "));
+        Serial.print(getClassName(c));
+        Serial.print(F(": "));
+        Serial.print(queueCount[c]);
+        Serial.print(F("/"));
+        Serial.print(dropped[c]);
+        Serial.print(F("/"));
+        Serial.println(expired[c]);
+    }
+}
@@ -3,13 +3,20 @@
 #include "MessageProtocol.h"
 #include "DummySensors.h"
 #include "SerialCommands.h"
+#include "ArqWindow.h"
+#include "DuplicateCache.h"
+#include "RxInbox.h"
+#include "TxQueue.h"
+#include "NodePoller.h"
+#include "Reassembler.h"
+#include "LinkAdr.h"
+#include "Scheduler.h"
 #include "board_config.h"
 
 // ===== State Machine =====
 enum State {
     STATE_IDLE,
     STATE_TX_WAIT_ACK,
-    STATE_RX_PROCESSING,
     STATE_ERROR
 };
 
@@ -18,40 +25,171 @@ LoRaComm loraComm;
 MessageProtocol protocol;
 DummySensors sensors;
 SerialCommands serialCmd;
+Scheduler scheduler;
 
 // ===== State Variables =====
 State currentState = STATE_IDLE;
-Statistics stats = {0, 0, 0, 0, 0, 0, 0};
-
-// ===== Pending Message Tracking =====
-uint16_t pendingMessageId = 0;
-unsigned long txTimestamp = 0;
-uint8_t retryCount = 0;
-size_t lastTxLength = 0;  // Store actual packet length for retries
+Statistics stats = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// ===== Sliding-Window ARQ =====
+// Outgoing frames stay in their window slot until cumulatively ACKed;
+// incoming IDs are tracked so every copy is ACKed but processed once.
+// One ARQ peer (PEER_ADDRESS): one ID sequence, receive window and RTT
+// estimate. Other nodes get unsequenced replies and ACKs by frame ID.
+// A broadcast PEER_ADDRESS means a two-node link: whoever answers is it.
+ArqWindow txWindow;
+ArqReceiver rxSequence;
+
+// Per-peer recent IDs and the reply to each peer's latest request
+DuplicateCache dedup;
+
+// ===== Delayed ACK =====
+// ACKs wait ARQ_ACK_HOLDOFF_MS for a reply to ride on before going out alone
+uint8_t ackTask = SCHEDULER_NO_TASK;
+uint8_t ackTo = PEER_ADDRESS;
+uint8_t ackStatus = ACK_OK;
+uint16_t ackId = 0;  // Frame ACKed when ackTo is not the ARQ peer
+
+#if STREAM_ENABLED
+// ===== Streaming =====
+// Publisher: sensors pushed to one subscriber every interval until its
+// lease runs out. Any frame from the subscriber renews the lease.
+struct Publication {
+    bool active;
+    uint8_t subscriber;
+    SubscribeInfo info;
+    unsigned long renewedAt;
+    uint8_t sentMask;                  // Sensors with a reading in lastValue
+    float lastValue[SENSOR_PRESSURE];  // Last reading sent, by sensor ID - 1
+};
+Publication publication = {};
+uint8_t streamTask = SCHEDULER_NO_TASK;
+
+// Subscriber: our lease at the peer. Explicit renewals go out only when
+// no other frame reached the peer for half the lease.
+SubscribeInfo subscription = {};
+unsigned long lastPeerTx = 0;
+uint8_t renewTask = SCHEDULER_NO_TASK;
+#endif
+
+#if POLL_ENABLED
+// ===== Polling =====
+// Master role: sensor polls to many addressed slaves. Polls and their
+// replies are unsequenced, so they never disturb the ARQ window to PEER_ADDRESS.
+NodePoller poller;
+uint8_t pollTask = SCHEDULER_NO_TASK;
+const unsigned long POLL_TICK_MS = 50;
+#endif
+
+#if FRAGMENT_ENABLED
+// ===== Fragmentation =====
+// Payloads larger than one frame go out as MSG_FRAGMENTs, each an
+// ordinary window frame: the SACK ARQ resends only the missing ones.
+// One outgoing transfer at a time, fed into the window as slots free up.
+struct OutgoingTransfer {
+    bool active;
+    uint8_t id;
+    uint8_t count;     // Fragments in the transfer
+    uint8_t next;      // Next fragment to hand to the window
+    size_t length;
+    unsigned long startedAt;
+};
+OutgoingTransfer transfer = {};
+uint8_t nextTransferId = 0;
+Reassembler reassembler;
+#endif
+
+#if ADR_ENABLED
+// ===== Adaptive Data Rate =====
+// With ADR on, this node proposes one step at a time to PEER_ADDRESS in a
+// sequenced MSG_LINK_ADR request. Both ends switch once the request is
+// ACKed, and each falls back to its old settings unless a frame from the
+// other arrives under the new ones in time. Either end answers requests.
+LinkAdr adr;
+uint8_t adrTask = SCHEDULER_NO_TASK;
+uint8_t adrFallbackTask = SCHEDULER_NO_TASK;
+RadioSettings adrPrevious = {};    // Last settings known to work
+RadioSettings adrPending = {};     // Proposed or accepted, not in use yet
+uint16_t adrRequestId = 0;         // Our request in the send window, 0 if none
+bool adrSwitchPending = false;     // Peer side: switch once our ACK is out
+unsigned long adrSwitchedAt = 0;   // Frames received since then confirm a switch
+#endif
 
 // ===== Configuration =====
-const unsigned long ACK_TIMEOUT = 2000;  // 2 seconds
+// ACK timeout comes from the measured RTT (ArqWindow), doubled per retry
 const uint8_t MAX_RETRIES = 3;
-const unsigned long RETRY_DELAYS[] = {500, 1000, 2000};  // Exponential backoff
+
+// ===== TX Queue =====
+// Everything goes out through the priority queue: ACKs as copies (control
+// class), data frames by reference to their window slot, tagged so their
+// ACK timer starts only when they leave
+TxQueue txQueue;
+const uint8_t TX_TAG_WINDOW = 1;
 
 // ===== Buffers =====
-uint8_t txBuffer[MSG_MAX_PACKET_SIZE];
-uint8_t rxBuffer[MSG_MAX_PACKET_SIZE];
-Message lastTxMessage;
-Message lastRxMessage;
+// Frames from the RX ring wait here until handled, whatever the TX state.
+// Without the inbox they are handled in place, straight from the ring.
+#if RX_INBOX_ENABLED
+RxInbox inbox;
+#endif
+MessageView lastRxMessage;  // Points into the frame being handled
+
+#ifdef __AVR__
+// ===== RAM Budget =====
+// 2 KB on the Uno: the radio, window and queue buffers leave about 1 KB
+// for Serial, string literals, the heap (command Strings) and the stack
+static_assert(sizeof(LoRaComm) + sizeof(ArqWindow) + sizeof(TxQueue) + sizeof(DuplicateCache) +
+              sizeof(Scheduler) <= 1024, "Buffers leave too little RAM: shrink them in board_config.h");
+#endif
 
 // ===== Function Prototypes =====
 void handleIdle();
 void handleTxWaitAck();
-void handleRxProcessing();
+void handleRxProcessing(const RxPacket* packet);
 void handleError();
 void processSerialCommand();
-void sendTextMessage(const char* text);
-void sendSensorRequest(uint8_t sensorId);
-void sendCommand(uint8_t cmdId);
-void sendAck(uint16_t msgId, uint8_t status);
+uint16_t sendTextMessage(const char* text);
+uint16_t sendSensorRequest(uint8_t sensorId);
+uint16_t sendCommand(uint8_t cmdId);
+uint16_t sendFrame(uint8_t* frame, size_t len, uint16_t msgId, TxClass txClass);
+void sendAck(uint8_t status);
+void holdAck(uint8_t status);
+void answerDuplicate(uint8_t peer, uint16_t msgId);
+void flushAck();
+void handleAck(uint16_t ackedMsgId, uint8_t status, uint32_t bitmap);
+void notePiggybackedAck();
+#if STREAM_ENABLED
+void handleSubscribe(uint8_t peer);
+void streamReadings();
+uint16_t sendSubscribe();
+void renewSubscription();
+#endif
+#if STREAM_ENABLED || POLL_ENABLED
+uint8_t parseSensorMask(const String& name);
+#endif
+#if POLL_ENABLED
+void pollNodes();
+#endif
+#if FRAGMENT_ENABLED
+bool startTransfer(size_t length);
+void feedTransfer();
+void handleFragment(uint8_t peer);
+#endif
+#if ADR_ENABLED
+void evaluateAdr();
+void handleLinkAdr();
+void finishAdrSwitch();
+void switchRadio(const RadioSettings& next);
+void useRadio(const RadioSettings& settings);
+void adrFallback();
+#endif
+void printRadioSettings(const RadioSettings& settings);
 void checkLoRaReceive();
-bool retryMessage();
+bool retransmit(ArqSlot* slot);
+void settleState();
+bool isArqPeer(uint8_t address);
+unsigned long pumpTxQueue();
+void onTxDrop(const TxEntry& entry);
 
 void setup() {
     // Initialize Serial
@@ -66,6 +204,12 @@ void setup() {
     Serial.println(F("===================================="));
     Serial.print(F("Board: "));
     Serial.println(BOARD_NAME);
+    if (NODE_ADDRESS != MSG_ADDR_NONE) {
+        Serial.print(F("Address: 0x"));
+        Serial.print(NODE_ADDRESS, HEX);
+        Serial.print(F(" -> Peer: 0x"));
+        Serial.println(PEER_ADDRESS, HEX);
+    }
     Serial.println();
 
     // Initialize LoRa
@@ -78,6 +222,29 @@ void setup() {
         }
     }
 
+    // Buffer incoming packets from the DIO0 interrupt so nothing is lost
+    // during retry backoff or while a response is being prepared
+    loraComm.enableRxInterrupt();
+
+    // Radio events (flagged by the DIO0 interrupt) end the idle sleep in loop()
+    scheduler.wakeOn(loraComm.getEventFlag());
+
+    // Open our ID sequence with a random first ID and the SYN flag, one
+    // frame at a time until the peer ACKs: the peer restarts its receive
+    // window on it instead of taking our new IDs for ones it already has
+    protocol.skipMessageIds(loraComm.randomWord());
+    protocol.setSyn(true);
+    txWindow.setLimit(1);
+
+    // Window frames preempted in the TX queue are retried after their timeout
+    txQueue.onDrop(onTxDrop);
+
+    // Address frames to the peer; frames for other nodes are dropped
+    // after a header-only read, before any payload transfer or checksum
+    protocol.setLocalAddress(NODE_ADDRESS);
+    protocol.setDestination(PEER_ADDRESS);
+    loraComm.setAddressFilter(NODE_ADDRESS);
+
     // Initialize sensors
     sensors.begin();
     Serial.println(F("Dummy sensors initialized"));
@@ -88,6 +255,29 @@ void setup() {
     // Initialize statistics
     stats.startTime = millis();
 
+    // Standalone ACK once the hold-off passes without a reply to carry it
+    ackTask = scheduler.add(flushAck);
+
+#if STREAM_ENABLED
+    // Streamed readings (publisher) and lease renewals (subscriber)
+    streamTask = scheduler.add(streamReadings);
+    renewTask = scheduler.every(STREAM_LEASE_S * 500UL, renewSubscription);
+    scheduler.stop(renewTask);
+#endif
+
+#if POLL_ENABLED
+    // Polling engine, started with the poll command
+    pollTask = scheduler.every(POLL_TICK_MS, pollNodes);
+    scheduler.stop(pollTask);
+#endif
+
+#if ADR_ENABLED
+    // Data rate steps, started with "adr on"; fallback armed per switch
+    adrTask = scheduler.every(ADR_INTERVAL_MS, evaluateAdr);
+    scheduler.stop(adrTask);
+    adrFallbackTask = scheduler.add(adrFallback);
+#endif
+
     // Print ready message
     Serial.println();
     Serial.println(F("===================================="));
@@ -97,18 +287,32 @@ void setup() {
     Serial.println(F("- Text messages"));
     Serial.println(F("- Sensor data (dummy)"));
     Serial.println(F("- Commands"));
-    Serial.println(F("- ACK with retries"));
+    Serial.print(F("- Sliding-window ARQ ("));
+    Serial.print(ARQ_WINDOW_SIZE);
+    Serial.println(F(" frames, cumulative + selective ACK)"));
+    Serial.println(F("- ACKs piggybacked on replies"));
+#if STREAM_ENABLED
+    Serial.println(F("- Sensor streaming (subscribe)"));
+#endif
     Serial.println(F("===================================="));
 
     serialCmd.printHelp();
 }
 
 void loop() {
-    // Check for incoming LoRa messages
+    // Drain the RX ring: ACKs act at once, data frames go to the inbox
     checkLoRaReceive();
 
-    // Process serial commands (if in IDLE state)
-    if (currentState == STATE_IDLE && serialCmd.available()) {
+#if RX_INBOX_ENABLED
+    // Handle one inbox message per pass, also while our frames await ACKs
+    if (!inbox.isEmpty()) {
+        handleRxProcessing(inbox.front());
+        inbox.release();
+    }
+#endif
+
+    // Process serial commands while the send window has room
+    if (!txWindow.isFull() && serialCmd.available()) {
         processSerialCommand();
     }
 
@@ -122,17 +326,36 @@ void loop() {
             handleTxWaitAck();
             break;
 
-        case STATE_RX_PROCESSING:
-            handleRxProcessing();
-            break;
-
         case STATE_ERROR:
             handleError();
             break;
     }
 
-    // Small delay
-    delay(10);
+    scheduler.run();
+
+#if FRAGMENT_ENABLED
+    // Keep the window full while a large payload is going out
+    feedTransfer();
+#endif
+
+    // Hand the next frame to the radio once the previous one is done
+    unsigned long txWait = pumpTxQueue();
+
+#if ADR_ENABLED
+    // Accepted data rate change: switch once our ACK has left the radio
+    finishAdrSwitch();
+#endif
+
+    // Idle until the oldest frame's ACK timeout, a radio event, serial
+    // input or the airtime budget covering the next queued frame
+    bool rxIdle = loraComm.getRxPending() == 0;
+#if RX_INBOX_ENABLED
+    rxIdle = rxIdle && inbox.isEmpty();
+#endif
+    if (rxIdle && (txQueue.isEmpty() || loraComm.isTransmitting() || txWait > 0)) {
+        unsigned long timeout = txWindow.timeUntilExpiry();
+        scheduler.sleep((txWait > 0 && txWait < timeout) ? txWait : timeout);
+    }
 }
 
 void handleIdle() {
@@ -140,60 +363,155 @@ void handleIdle() {
 }
 
 void handleTxWaitAck() {
-    // Check timeout
-    unsigned long elapsed = millis() - txTimestamp;
-
-    if (elapsed >= ACK_TIMEOUT) {
-        // Timeout occurred
-        if (retryCount < MAX_RETRIES) {
-            // Retry
-            serialCmd.printInfo("ACK timeout, retrying...");
-            delay(RETRY_DELAYS[retryCount]);
-            retryMessage();
-        } else {
-            // Max retries exceeded
-            serialCmd.printError("Max retries exceeded, message failed");
-            stats.messagesFailed++;
-            pendingMessageId = 0;
-            currentState = STATE_IDLE;
+    // ACK timeout starts once the frame has left the radio
+    if (loraComm.isTransmitting()) {
+        txWindow.holdLastTimer();
+        return;
+    }
+
+    // Each outstanding frame times out on its own
+    ArqSlot* slot = txWindow.nextExpired();
+    if (slot == nullptr) {
+        return;
+    }
+
+    if (slot->retries < MAX_RETRIES) {
+        // Retry
+        serialCmd.printInfo(F("ACK timeout, retrying..."));
+        retransmit(slot);
+    } else {
+        // Max retries exceeded: peer unreachable, drop the whole window and
+        // open a new ID sequence so the peer restarts its receive window
+        serialCmd.printError(F("Max retries exceeded, message failed"));
+        stats.messagesFailed += txWindow.clear();
+        protocol.skipMessageIds(ARQ_RX_WINDOW);
+        protocol.setSyn(true);
+        txWindow.setLimit(1);
+#if ADR_ENABLED
+        adrRequestId = 0;
+#endif
+#if FRAGMENT_ENABLED
+        if (transfer.active) {
+            transfer.active = false;
+            serialCmd.printError(F("Transfer aborted"));
         }
+#endif
+        currentState = STATE_IDLE;
     }
 }
 
-void handleRxProcessing() {
+void handleRxProcessing(const RxPacket* packet) {
+    if (!protocol.decodeView(packet->data, packet->length, lastRxMessage)) {
+        return;
+    }
+    lastRxMessage.rssi = packet->rssi;
+    lastRxMessage.snr = packet->snr;
+
+    // Replies (ACK, sensor response) go back to the sender of this frame
+    uint8_t peer = (lastRxMessage.source() != MSG_ADDR_NONE) ? lastRxMessage.source() : PEER_ADDRESS;
+    uint16_t msgId = lastRxMessage.messageId();
+    bool arqPeer = isArqPeer(peer);
+    protocol.setDestination(peer);
+
+    // Data frames: a retransmission means our ACK or reply was lost, so
+    // answer it again without running the handler twice. ACKs are held
+    // briefly so a reply sent meanwhile carries them in its header.
+    // Unsequenced frames (ID 0: streamed readings, polls) are never ACKed.
+    if (lastRxMessage.type() != MSG_NACK && msgId != 0) {
+        // No window slot for the response: leave a new request unaccepted
+        // and unACKed, so the peer's retransmission is answered once our
+        // frames are ACKed (an answered one still gets its cached reply)
+        if (arqPeer && lastRxMessage.type() == MSG_SENSOR_REQUEST && txWindow.isFull() &&
+            dedup.getResponse(peer, msgId) == 0) {
+            serialCmd.printError(F("Send window full, request deferred"));
+            protocol.setDestination(PEER_ADDRESS);
+            return;
+        }
+
+        // Only the ARQ peer shares our receive window; other nodes'
+        // frames are told apart by ID alone and ACKed by it
+        bool fresh = true;
+        if (arqPeer) {
+            fresh = rxSequence.accept(msgId, lastRxMessage.isSyn());
+            if (rxSequence.wasRestarted()) {
+                // Peer rebooted or gave up: its old IDs and replies are void
+                dedup.forget(peer);
+                Serial.println(F("[RX] Peer restarted its sequence"));
+            }
+        }
+        bool seen = dedup.check(peer, msgId);
+
+        if (!fresh || seen) {
+            stats.duplicates++;
+            Serial.print(F("[RX] Duplicate message "));
+            Serial.println(msgId);
+
+            // Another node's request has no cached reply: read it again
+            if (arqPeer || lastRxMessage.type() != MSG_SENSOR_REQUEST) {
+                answerDuplicate(peer, msgId);
+
+                protocol.setDestination(PEER_ADDRESS);
+                settleState();
+                return;
+            }
+        }
+    }
+
     // Process received message based on type
-    switch (lastRxMessage.type) {
+    switch (lastRxMessage.type()) {
         case MSG_TEXT: {
             // Print text message
-            char textBuffer[MSG_MAX_PAYLOAD + 1];
-            memcpy(textBuffer, lastRxMessage.payload, lastRxMessage.payloadLength);
-            textBuffer[lastRxMessage.payloadLength] = '\0';
-            serialCmd.printReceivedMessage(lastRxMessage, textBuffer);
+            serialCmd.printReceivedMessage(lastRxMessage);
 
-            // Send ACK
-            sendAck(lastRxMessage.messageId, ACK_OK);
+            // ACK (alone after the hold-off, nothing else to send)
+            holdAck(ACK_OK);
             break;
         }
 
         case MSG_SENSOR_REQUEST: {
-            if (lastRxMessage.payloadLength >= 1) {
-                uint8_t sensorId = lastRxMessage.payload[0];
+            if (lastRxMessage.payloadLength() >= 1) {
+                uint8_t sensorId = lastRxMessage.payload()[0];
 
                 Serial.print(F("[RX] Sensor request: "));
                 Serial.println(sensors.getSensorName(sensorId));
 
-                // Send ACK first
-                sendAck(lastRxMessage.messageId, ACK_OK);
+                // Other nodes: one unsequenced reading carrying the ACK,
+                // as for a poll (the send window is PEER_ADDRESS's)
+                if (!arqPeer) {
+                    holdAck(ACK_OK);
+                    float value = sensors.readSensorById(sensorId);
+                    uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+                    size_t len = (frame != nullptr) ? protocol.encodeSensorStream(sensorId, value, sensors.getSensorUnit(sensorId), frame) : 0;
+                    if (txQueue.commit(len, ARQ_RTO_INITIAL_MS)) {
+                        stats.messagesSent++;
+                        notePiggybackedAck();
+                    }
+                    break;
+                }
 
-                // Wait for ACK to be fully transmitted and received
-                delay(100);
+                // ACKed only once the response has a slot: a request
+                // that cannot be answered must not look delivered
+                uint8_t* frame = txWindow.nextFrame();
+                if (frame == nullptr) {
+                    serialCmd.printError(F("Send window full, response dropped"));
+                    sendAck(ACK_ERROR);
+                    break;
+                }
 
-                // Read sensor and send response
+                // The response carries the ACK: one transmission instead of two
+                holdAck(ACK_OK);
+
+                // Read sensor and send response (retransmitted until ACKed)
                 float value = sensors.readSensorById(sensorId);
                 const char* unit = sensors.getSensorUnit(sensorId);
 
-                size_t len = protocol.encodeSensorResponse(sensorId, value, unit, txBuffer);
-                if (len > 0 && loraComm.sendPacket(txBuffer, len)) {
+                uint16_t responseId = 0;
+                size_t len = protocol.encodeSensorResponse(sensorId, value, unit, frame, &responseId);
+                responseId = sendFrame(frame, len, responseId, TX_CLASS_TELEMETRY);
+                if (responseId != 0) {
+                    // A retransmitted request is answered with this frame
+                    dedup.setResponse(peer, msgId, responseId);
+
                     Serial.print(F("[TX] Sensor response: "));
                     Serial.print(value, 2);
                     Serial.print(F(" "));
@@ -206,63 +524,109 @@ void handleRxProcessing() {
         case MSG_SENSOR_RESPONSE: {
             // Parse sensor response
             SensorData data;
-            if (protocol.parseSensorResponse(lastRxMessage.payload, lastRxMessage.payloadLength, data)) {
+            if (protocol.parseSensorResponse(lastRxMessage, data)) {
                 serialCmd.printSensorData(data);
-                sendAck(lastRxMessage.messageId, ACK_OK);
+                holdAck(ACK_OK);
             } else {
-                serialCmd.printError("Failed to parse sensor response");
-                sendAck(lastRxMessage.messageId, ACK_ERROR);
+                serialCmd.printError(F("Failed to parse sensor response"));
+                holdAck(ACK_ERROR);
             }
             break;
         }
 
         case MSG_COMMAND: {
-            if (lastRxMessage.payloadLength >= 1) {
-                uint8_t cmdId = lastRxMessage.payload[0];
+            if (lastRxMessage.payloadLength() >= 1) {
+                uint8_t cmdId = lastRxMessage.payload()[0];
                 const char* cmdName = protocol.getCommandName(cmdId);
 
                 serialCmd.printCommandExecution(cmdId, cmdName);
 
-                // Send ACK
-                sendAck(lastRxMessage.messageId, ACK_OK);
+                // ACK (alone after the hold-off, nothing else to send)
+                holdAck(ACK_OK);
+            }
+            break;
+        }
+
+#if STREAM_ENABLED
+        case MSG_SUBSCRIBE: {
+            handleSubscribe(peer);
+            break;
+        }
+#endif
+
+        case MSG_SENSOR_STREAM: {
+            // One frame per reading: no request, no ACK (or the poll reply)
+            SensorData data;
+            if (protocol.parseSensorResponse(lastRxMessage, data)) {
+#if POLL_ENABLED
+                poller.handleReply(peer, data.sensorId);
+#endif
+                serialCmd.printSensorData(data);
             }
             break;
         }
 
-        case MSG_ACK: {
-            // Check if this ACK is for our pending message
-            if (lastRxMessage.payloadLength >= 3) {
-                uint16_t ackedMsgId = (lastRxMessage.payload[0] << 8) | lastRxMessage.payload[1];
-                uint8_t status = lastRxMessage.payload[2];
+        case MSG_POLL: {
+            // Answered with one streamed reading, which is also the ACK
+            if (lastRxMessage.payloadLength() >= 1) {
+                uint8_t sensorId = lastRxMessage.payload()[0];
+                float value = sensors.readSensorById(sensorId);
 
-                if (ackedMsgId == pendingMessageId) {
-                    // Our message was acknowledged
-                    serialCmd.printAckReceived(ackedMsgId, status == ACK_OK);
-                    pendingMessageId = 0;
-                    currentState = STATE_IDLE;
+                uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+                size_t len = (frame != nullptr) ? protocol.encodeSensorStream(sensorId, value, sensors.getSensorUnit(sensorId), frame) : 0;
+                if (txQueue.commit(len, POLL_TIMEOUT_MS)) {
+                    stats.messagesSent++;
+                    notePiggybackedAck();
                 }
             }
             break;
         }
 
+#if FRAGMENT_ENABLED
+        case MSG_FRAGMENT: {
+            handleFragment(peer);
+            break;
+        }
+#endif
+
+#if ADR_ENABLED
+        case MSG_LINK_ADR: {
+            handleLinkAdr();
+            break;
+        }
+#endif
+
         case MSG_NACK: {
-            serialCmd.printError("Received NACK");
+            serialCmd.printError(F("Received NACK"));
             break;
         }
 
         default:
-            serialCmd.printError("Unknown message type");
+            // Also features compiled out of this build: refused, so the
+            // sender does not retry the frame until it gives up
+            serialCmd.printError(F("Unknown message type"));
+            if (msgId != 0) {
+                holdAck(ACK_INVALID);
+            }
             break;
     }
 
-    // Return to idle
-    if (currentState == STATE_RX_PROCESSING) {
-        currentState = STATE_IDLE;
-    }
+    protocol.setDestination(PEER_ADDRESS);
+
+    // Back to idle, or keep waiting for ACKs of outstanding frames
+    settleState();
+}
+
+bool isArqPeer(uint8_t address) {
+    return address == PEER_ADDRESS || PEER_ADDRESS == MSG_ADDR_BROADCAST;
+}
+
+void settleState() {
+    currentState = txWindow.isEmpty() ? STATE_IDLE : STATE_TX_WAIT_ACK;
 }
 
 void handleError() {
-    serialCmd.printError("System error, resetting to idle");
+    serialCmd.printError(F("System error, resetting to idle"));
     currentState = STATE_IDLE;
 }
 
@@ -284,7 +648,7 @@ void processSerialCommand() {
             if (cmd.arg3.length() > 0) fullText += " " + cmd.arg3;
             sendTextMessage(fullText.c_str());
         } else {
-            serialCmd.printError("Usage: send <text>");
+            serialCmd.printError(F("Usage: send <text>"));
         }
     }
     else if (cmd.name == "request") {
@@ -297,7 +661,7 @@ void processSerialCommand() {
         } else if (cmd.arg1 == "pressure") {
             sendSensorRequest(SENSOR_PRESSURE);
         } else {
-            serialCmd.printError("Usage: request [temp|humid|bat|pressure]");
+            serialCmd.printError(F("Usage: request [temp|humid|bat|pressure]"));
         }
     }
     else if (cmd.name == "cmd") {
@@ -308,184 +672,931 @@ void processSerialCommand() {
         } else if (cmd.arg1 == "led" && cmd.arg2 == "toggle") {
             sendCommand(CMD_LED_TOGGLE);
         } else {
-            serialCmd.printError("Usage: cmd led [on|off|toggle]");
+            serialCmd.printError(F("Usage: cmd led [on|off|toggle]"));
+        }
+    }
+#if STREAM_ENABLED
+    else if (cmd.name == "subscribe") {
+        uint8_t mask = parseSensorMask(cmd.arg1);
+        long interval = cmd.arg2.toInt();
+        if (mask == 0 || interval < 1 || interval > 0xFFFF) {
+            serialCmd.printError(F("Usage: subscribe [temp|humid|bat|pressure|all] <sec> [deadband]"));
+        } else {
+            subscription.sensorMask = mask;
+            subscription.intervalS = (uint16_t)interval;
+            subscription.deadband = (cmd.arg3.length() > 0) ? cmd.arg3.toFloat() : 0.0f;
+            subscription.leaseS = STREAM_LEASE_S;
+            if (sendSubscribe() != 0) {
+                scheduler.reschedule(renewTask, STREAM_LEASE_S * 500UL);
+            }
+        }
+    }
+    else if (cmd.name == "unsubscribe") {
+        // Lease 0 ends the stream at once instead of letting it expire
+        subscription.leaseS = 0;
+        scheduler.stop(renewTask);
+        sendSubscribe();
+    }
+#endif
+#if POLL_ENABLED
+    else if (cmd.name == "poll") {
+        uint8_t address = (uint8_t)strtol(cmd.arg2.c_str(), nullptr, 16);
+        if (cmd.arg1 == "add") {
+            uint8_t mask = (cmd.arg3.length() > 0) ? parseSensorMask(cmd.arg3) : parseSensorMask("all");
+            if (!poller.addNode(address, mask)) {
+                serialCmd.printError(F("Usage: poll add <hex addr> [temp|humid|bat|pressure|all] (table full?)"));
+            }
+        } else if (cmd.arg1 == "remove") {
+            if (!poller.removeNode(address)) {
+                serialCmd.printError(F("Node not in poll table"));
+            }
+        } else if (cmd.arg1 == "start") {
+            if (NODE_ADDRESS == MSG_ADDR_NONE) {
+                // Replies are matched by source address
+                serialCmd.printError(F("Polling needs NODE_ADDRESS"));
+            } else {
+                poller.setMode(cmd.arg2 == "stale" ? POLL_STALEST : POLL_ROUND_ROBIN);
+                scheduler.reschedule(pollTask, 0);
+                serialCmd.printInfo(F("Polling started"));
+            }
+        } else if (cmd.arg1 == "stop") {
+            scheduler.stop(pollTask);
+            serialCmd.printInfo(F("Polling stopped"));
+        } else {
+            serialCmd.printError(F("Usage: poll [add|remove] <hex addr> | poll start [rr|stale] | poll stop"));
+        }
+    }
+#endif
+#if FRAGMENT_ENABLED
+    else if (cmd.name == "blob") {
+        long length = cmd.arg1.toInt();
+        if (length < 1 || (unsigned long)length > MSG_MAX_TRANSFER_SIZE) {
+            serialCmd.printError(F("Usage: blob <bytes> (up to 51000)"));
+        } else if (!startTransfer((size_t)length)) {
+            serialCmd.printError(F("Transfer already in progress"));
+        }
+    }
+#endif
+#if ADR_ENABLED
+    else if (cmd.name == "adr") {
+        if (cmd.arg1 == "on") {
+            scheduler.reschedule(adrTask, ADR_INTERVAL_MS);
+            serialCmd.printInfo(F("ADR on"));
+        } else if (cmd.arg1 == "off") {
+            scheduler.stop(adrTask);
+            serialCmd.printInfo(F("ADR off"));
+        } else {
+            serialCmd.printError(F("Usage: adr [on|off]"));
         }
     }
+#endif
+    else if (cmd.name == "subscribe" || cmd.name == "unsubscribe" || cmd.name == "poll" ||
+             cmd.name == "blob" || cmd.name == "adr") {
+        // Compiled out of this build (board_config.h)
+        serialCmd.printError(F("Not available on this board"));
+    }
     else if (cmd.name == "stats") {
         serialCmd.printStats(stats);
+        Serial.print(F("Filtered (other nodes): "));
+        Serial.println(loraComm.getRxFiltered());
+#if RX_INBOX_ENABLED
+        Serial.print(F("Inbox: "));
+        Serial.print(inbox.getCount());
+        Serial.print(F("/"));
+        Serial.print(RX_INBOX_SLOTS);
+        Serial.print(F(", dropped "));
+        Serial.println(inbox.getDropped());
+#endif
+        Serial.print(F("Send window: "));
+        Serial.print(txWindow.getOutstanding());
+        Serial.print(F("/"));
+        Serial.println(ARQ_WINDOW_SIZE);
+        const RttEstimator& rtt = txWindow.getRtt();
+        Serial.print(F("SRTT: "));
+        Serial.print(rtt.getSrtt());
+        Serial.print(F(" ms, RTTVAR: "));
+        Serial.print(rtt.getRttVar());
+        Serial.print(F(" ms, RTO: "));
+        Serial.print(rtt.getRto());
+        Serial.print(F(" ms ("));
+        Serial.print(rtt.getSampleCount());
+        Serial.println(F(" samples)"));
+        txQueue.printStats();
+        loraComm.getDutyCycle().printStats();
+        loraComm.getListenBeforeTalk().printStats();
+        Serial.print(F("Radio: "));
+        printRadioSettings(loraComm.getSettings());
+#if ADR_ENABLED
+        Serial.println(scheduler.isPending(adrTask) ? F(" (ADR on)") : F(""));
+        adr.printStats(loraComm.getSettings().spreadingFactor);
+#else
+        Serial.println();
+#endif
+#if POLL_ENABLED
+        if (poller.getCount() > 0) {
+            poller.printStats();
+        }
+#endif
+#if FRAGMENT_ENABLED
+        Serial.print(F("Reassembly: "));
+        Serial.print(reassembler.getActive());
+        Serial.print(F(" active, "));
+        Serial.print(reassembler.getCompleted());
+        Serial.print(F(" completed, "));
+        Serial.print(reassembler.getEvicted());
+        Serial.print(F(" evicted, "));
+        Serial.print(reassembler.getRefused());
+        Serial.println(F(" refused"));
+#endif
     }
     else if (cmd.name == "clear") {
         serialCmd.clearStats(stats);
     }
     else {
-        serialCmd.printError("Unknown command. Type 'help' for list.");
+        serialCmd.printError(F("Unknown command. Type 'help' for list."));
     }
 }
 
-void sendTextMessage(const char* text) {
-    size_t len = protocol.encodeText(text, txBuffer);
+uint16_t sendTextMessage(const char* text) {
+#if ARQ_FRAME_SIZE < MSG_MAX_PACKET_SIZE
+    // Window slots hold less than a full frame: longer text is refused, not cut
+    if (strlen(text) > ARQ_FRAME_SIZE - MSG_MAX_HEADER_SIZE - MSG_MAX_TRAILER_SIZE) {
+        serialCmd.printError(F("Text too long"));
+        return 0;
+    }
+#endif
+
+    uint8_t* frame = txWindow.nextFrame();
+    if (frame == nullptr) {
+        serialCmd.printError(F("Send window full"));
+        return 0;
+    }
+
+    uint16_t msgId = 0;
+    size_t len = protocol.encodeText(text, frame, &msgId);
     if (len == 0) {
-        serialCmd.printError("Failed to encode message");
-        return;
+        serialCmd.printError(F("Failed to encode message"));
+        return 0;
     }
 
-    // Decode to get message ID
-    Message msg;
-    if (protocol.decode(txBuffer, len, msg)) {
-        pendingMessageId = msg.messageId;
+    msgId = sendFrame(frame, len, msgId, TX_CLASS_BULK);
+    serialCmd.printSentMessage("TEXT", text, msgId != 0);
+    return msgId;
+}
+
+uint16_t sendSensorRequest(uint8_t sensorId) {
+    uint8_t* frame = txWindow.nextFrame();
+    if (frame == nullptr) {
+        serialCmd.printError(F("Send window full"));
+        return 0;
     }
 
-    // Store packet length for retries
-    lastTxLength = len;
-    Serial.print(F("[DEBUG] Stored packet length: "));
-    Serial.println(lastTxLength);
+    uint16_t msgId = 0;
+    size_t len = protocol.encodeSensorRequest(sensorId, frame, &msgId);
+    if (len == 0) {
+        serialCmd.printError(F("Failed to encode sensor request"));
+        return 0;
+    }
 
-    if (loraComm.sendPacket(txBuffer, len)) {
-        serialCmd.printSentMessage("TEXT", text, true);
-        stats.messagesSent++;
-        txTimestamp = millis();
-        retryCount = 0;
-        currentState = STATE_TX_WAIT_ACK;
-    } else {
-        serialCmd.printSentMessage("TEXT", text, false);
-        stats.messagesFailed++;
+    msgId = sendFrame(frame, len, msgId, TX_CLASS_TELEMETRY);
+    serialCmd.printSentMessage("SENSOR_REQ", sensors.getSensorName(sensorId), msgId != 0);
+    return msgId;
+}
+
+uint16_t sendCommand(uint8_t cmdId) {
+    uint8_t* frame = txWindow.nextFrame();
+    if (frame == nullptr) {
+        serialCmd.printError(F("Send window full"));
+        return 0;
+    }
+
+    uint16_t msgId = 0;
+    size_t len = protocol.encodeCommand(cmdId, nullptr, 0, frame, &msgId);
+    if (len == 0) {
+        serialCmd.printError(F("Failed to encode command"));
+        return 0;
     }
+
+    msgId = sendFrame(frame, len, msgId, TX_CLASS_ALARM);
+    serialCmd.printSentMessage("COMMAND", protocol.getCommandName(cmdId), msgId != 0);
+    return msgId;
 }
 
-void sendSensorRequest(uint8_t sensorId) {
-    size_t len = protocol.encodeSensorRequest(sensorId, txBuffer);
+uint16_t sendFrame(uint8_t* frame, size_t len, uint16_t msgId, TxClass txClass) {
     if (len == 0) {
-        serialCmd.printError("Failed to encode sensor request");
-        return;
+        return 0;
     }
 
-    // Decode to get message ID
-    Message msg;
-    if (protocol.decode(txBuffer, len, msg)) {
-        pendingMessageId = msg.messageId;
+    // The slot may still be queued from before it was ACKed
+    txQueue.cancel(frame);
+
+    // The ID is spent either way: a frame the queue refuses stays in the
+    // window and is retried like one lost on air
+    txWindow.commit(len, msgId, txClass);
+    if (!txQueue.enqueueRef(txClass, frame, len, TX_TTL_NONE, TX_TAG_WINDOW)) {
+        serialCmd.printError(F("TX queue full, will retry"));
+        txWindow.markSent(frame);
     }
+    stats.messagesSent++;
+    currentState = STATE_TX_WAIT_ACK;
 
-    // Store packet length for retries
-    lastTxLength = len;
+    notePiggybackedAck();
+    return msgId;
+}
 
-    const char* sensorName = sensors.getSensorName(sensorId);
+void notePiggybackedAck() {
+    // A held ACK was consumed by the last frame's header: no standalone ACK
+    if (scheduler.isPending(ackTask) && !protocol.hasPiggybackAck()) {
+        scheduler.stop(ackTask);
+        Serial.println(F("[TX] ACK piggybacked"));
+    }
+}
 
-    if (loraComm.sendPacket(txBuffer, len)) {
-        serialCmd.printSentMessage("SENSOR_REQ", sensorName, true);
-        stats.messagesSent++;
-        txTimestamp = millis();
-        retryCount = 0;
-        currentState = STATE_TX_WAIT_ACK;
+void sendAck(uint8_t status) {
+    uint8_t ackFrame[MSG_MAX_ACK_SIZE];
+    bool arqPeer = isArqPeer(protocol.getDestination());
+    uint16_t ackedId = arqPeer ? rxSequence.getCumulativeAck() : ackId;
+
+    // Supersedes any ACK held for piggybacking
+    protocol.clearPiggybackAck();
+    scheduler.stop(ackTask);
+
+    // Frames received past a hole: SACK so only the hole is resent
+    uint32_t bitmap = arqPeer ? rxSequence.getSelectiveBitmap() : 0;
+    size_t len;
+    if (bitmap != 0) {
+        len = protocol.encodeSack(ackedId, status, bitmap, ackFrame);
     } else {
-        serialCmd.printSentMessage("SENSOR_REQ", sensorName, false);
-        stats.messagesFailed++;
+        len = protocol.encodeAck(ackedId, status, ackFrame);
+    }
+
+    if (len > 0 && !txQueue.enqueue(TX_CLASS_CONTROL, ackFrame, len)) {
+        serialCmd.printError(F("TX queue full, ACK dropped"));
+    } else if (len > 0) {
+        Serial.print(bitmap != 0 ? F("[TX] SACK sent up to message ") : F("[TX] ACK sent up to message "));
+        Serial.print(ackedId);
+        if (bitmap != 0) {
+            Serial.print(F(", bitmap 0x"));
+            Serial.print(bitmap, HEX);
+        }
+        Serial.println();
     }
 }
 
-void sendCommand(uint8_t cmdId) {
-    size_t len = protocol.encodeCommand(cmdId, nullptr, 0, txBuffer);
-    if (len == 0) {
-        serialCmd.printError("Failed to encode command");
+void holdAck(uint8_t status) {
+    bool arqPeer = isArqPeer(protocol.getDestination());
+
+    // Out-of-order arrival: report the hole right away with a SACK
+    if (arqPeer && rxSequence.getSelectiveBitmap() != 0) {
+        sendAck(status);
         return;
     }
 
-    // Decode to get message ID
-    Message msg;
-    if (protocol.decode(txBuffer, len, msg)) {
-        pendingMessageId = msg.messageId;
+    // Cumulative point as of now (the frame's own ID for other nodes),
+    // for the peer this frame came from
+    ackTo = protocol.getDestination();
+    ackStatus = status;
+    ackId = lastRxMessage.messageId();
+    protocol.setPiggybackAck(arqPeer ? rxSequence.getCumulativeAck() : ackId, status);
+
+    // Hold-off counts from the first unacknowledged frame, so a steady
+    // stream of data cannot postpone the ACK indefinitely
+    if (!scheduler.isPending(ackTask)) {
+        scheduler.reschedule(ackTask, ARQ_ACK_HOLDOFF_MS);
     }
+}
 
-    // Store packet length for retries
-    lastTxLength = len;
+void answerDuplicate(uint8_t peer, uint16_t msgId) {
+    // Reply still awaiting its ACK: resend the cached frame instead of
+    // reading the sensor again (it carries the ACK if it did the first time)
+    uint16_t responseId = dedup.getResponse(peer, msgId);
+    ArqSlot* cached = (responseId != 0) ? txWindow.find(responseId) : nullptr;
+    if (cached != nullptr) {
+        serialCmd.printInfo(F("Answering duplicate from cached response"));
+        retransmit(cached);
+
+        MessageView response;
+        if (protocol.decodeView(cached->frame, cached->length, response) && response.hasAck()) {
+            return;
+        }
+    }
 
-    const char* cmdName = protocol.getCommandName(cmdId);
+    // Re-ACK from the receive window state
+    holdAck(ACK_OK);
+}
 
-    if (loraComm.sendPacket(txBuffer, len)) {
-        serialCmd.printSentMessage("COMMAND", cmdName, true);
-        stats.messagesSent++;
-        txTimestamp = millis();
-        retryCount = 0;
-        currentState = STATE_TX_WAIT_ACK;
-    } else {
-        serialCmd.printSentMessage("COMMAND", cmdName, false);
-        stats.messagesFailed++;
+void flushAck() {
+    // No reply carried the held ACK in time: send it on its own
+    if (!protocol.hasPiggybackAck()) {
+        return;
     }
+
+    protocol.setDestination(ackTo);
+    sendAck(ackStatus);
+    protocol.setDestination(PEER_ADDRESS);
 }
 
-void sendAck(uint16_t msgId, uint8_t status) {
-    size_t len = protocol.encodeAck(msgId, status, txBuffer);
-    if (len > 0) {
-        loraComm.sendPacket(txBuffer, len);
-        Serial.print(F("[TX] ACK sent for message "));
-        Serial.println(msgId);
+void handleAck(uint16_t ackedMsgId, uint8_t status, uint32_t bitmap) {
+    uint8_t released = txWindow.acknowledge(ackedMsgId);
+    if (released > 0) {
+        serialCmd.printAckReceived(ackedMsgId, status == ACK_OK);
+        if (protocol.hasSyn()) {
+            // Peer is in sync with our sequence: open the full window
+            protocol.setSyn(false);
+            txWindow.setLimit(ARQ_WINDOW_SIZE);
+        }
+#if ADR_ENABLED
+        adr.recordDelivered(released);
+#endif
+    }
+
+#if ADR_ENABLED
+    // Our data rate request got through: follow the peer to the new
+    // settings and tell it so under them
+    if (adrRequestId != 0 && txWindow.find(adrRequestId) == nullptr) {
+        bool refused = (ackedMsgId == adrRequestId && status != ACK_OK);
+        adrRequestId = 0;
+        if (refused) {
+            serialCmd.printError(F("ADR: peer refused the new settings"));
+        } else {
+            switchRadio(adrPending);
+
+            uint8_t* frame = txWindow.nextFrame();
+            if (frame != nullptr) {
+                const RadioSettings& now = loraComm.getSettings();
+                LinkAdrInfo confirm = {ADR_OP_CONFIRM, now.spreadingFactor, now.bandwidth, now.txPower};
+                uint16_t confirmId = 0;
+                size_t len = protocol.encodeLinkAdr(confirm, frame, &confirmId);
+                sendFrame(frame, len, confirmId, TX_CLASS_CONTROL);
+            }
+        }
+    }
+#endif
+
+    // Frames past the hole need no retransmission: count each one as a
+    // retry saved compared to cumulative-only ACKs
+    if (bitmap != 0) {
+        uint8_t saved = txWindow.acknowledgeSelective(ackedMsgId, bitmap);
+        stats.retriesSaved += saved;
+        if (saved > 0) {
+            Serial.print(F("[RX] SACK: "));
+            Serial.print(saved);
+            Serial.println(F(" frame(s) past a hole, resending holes only"));
+        }
     }
 }
 
 void checkLoRaReceive() {
-    int packetSize = loraComm.receivePacket(rxBuffer, sizeof(rxBuffer));
+    const RxPacket* packet;
 
-    if (packetSize > 0) {
+    while ((packet = loraComm.peek()) != nullptr) {
         // Debug: Print received packet details
         Serial.print(F("[DEBUG] Received packet: "));
-        Serial.print(packetSize);
+        Serial.print(packet->length);
         Serial.print(F(" bytes, RSSI: "));
-        Serial.println(loraComm.getRSSI());
+        Serial.println(packet->rssi);
 
         // Update statistics
         stats.messagesReceived++;
-        stats.totalRSSI += loraComm.getRSSI();
+        stats.totalRSSI += packet->rssi;
         stats.rssiCount++;
 
-        // Decode message
-        if (protocol.decode(rxBuffer, packetSize, lastRxMessage)) {
-            // Store RSSI and SNR
-            lastRxMessage.rssi = loraComm.getRSSI();
-            lastRxMessage.snr = loraComm.getSNR();
+        // Validate in place (no payload copy)
+        MessageView message;
+        if (protocol.decodeView(packet->data, packet->length, message)) {
+            uint8_t source = (message.source() != MSG_ADDR_NONE) ? message.source() : PEER_ADDRESS;
 
-            // If we're waiting for ACK and received an ACK, handle in TX_WAIT_ACK state
-            if (currentState == STATE_TX_WAIT_ACK && lastRxMessage.type == MSG_ACK) {
-                // Process immediately
-                handleRxProcessing();
+#if STREAM_ENABLED
+            // Any frame from our subscriber renews its lease
+            if (publication.active && source == publication.subscriber) {
+                publication.renewedAt = millis();
+            }
+#endif
+
+#if ADR_ENABLED
+            // Link history only from frames received under the current settings;
+            // the first one from the peer after a switch confirms it
+            if ((long)(packet->timestamp - adrSwitchedAt) >= 0) {
+                adr.addSample(source, packet->rssi, packet->snr);
+
+                if (source == PEER_ADDRESS && scheduler.isPending(adrFallbackTask)) {
+                    scheduler.stop(adrFallbackTask);
+                    Serial.print(F("[ADR] Confirmed: "));
+                    printRadioSettings(loraComm.getSettings());
+                    Serial.println();
+                }
             }
-            // Otherwise, process in next cycle
-            else if (currentState == STATE_IDLE) {
-                currentState = STATE_RX_PROCESSING;
+#endif
+
+            // ACKs free window slots right away, also when piggybacked
+            // on a data frame (e.g. the response to our sensor request).
+            // Only the ARQ peer holds sequenced frames of ours.
+            if (message.hasAck() && isArqPeer(source)) {
+                handleAck(message.ackedId(), message.ackStatus(), 0);
+            }
+
+            if (message.type() == MSG_ACK || message.type() == MSG_SACK) {
+                // Cumulative ACK: covers this message ID and everything before it,
+                // a SACK also lists the frames that arrived after a hole
+                AckInfo ack;
+                if (isArqPeer(source) && protocol.parseAck(message, ack)) {
+                    handleAck(ack.messageId, ack.status, ack.bitmap);
+                }
+            } else {
+#if RX_INBOX_ENABLED
+                if (!inbox.push(*packet)) {
+                    serialCmd.printError(F("Inbox full, message dropped"));
+                }
+#else
+                // Handled in place: the ring slot stays valid until pop()
+                handleRxProcessing(packet);
+#endif
             }
         } else {
-            serialCmd.printError("Failed to decode packet (checksum error?)");
+            serialCmd.printError(F("Failed to decode packet (checksum error?)"));
         }
+
+        loraComm.pop();
+    }
+
+    // Back to idle once every frame is ACKed
+    if (currentState == STATE_TX_WAIT_ACK && txWindow.isEmpty()) {
+        settleState();
     }
 }
 
-bool retryMessage() {
-    // Resend last message
-    if (pendingMessageId == 0 || lastTxLength == 0) {
-        Serial.print(F("[DEBUG] Retry failed: pendingMessageId="));
-        Serial.print(pendingMessageId);
-        Serial.print(F(", lastTxLength="));
-        Serial.println(lastTxLength);
-        return false;
+bool retransmit(ArqSlot* slot) {
+    // Still waiting for the radio: one copy is enough
+    if (slot->queued) {
+        return true;
     }
 
-    retryCount++;
+    txWindow.markRetransmitted(slot);
     stats.retries++;
 
     // Debug: Print retry details
     Serial.print(F("[DEBUG] Retry #"));
-    Serial.print(retryCount);
+    Serial.print(slot->retries);
     Serial.print(F(" - Sending "));
-    Serial.print(lastTxLength);
+    Serial.print(slot->length);
     Serial.print(F(" bytes (msgID: "));
-    Serial.print(pendingMessageId);
+    Serial.print(slot->messageId);
     Serial.println(F(")"));
 
-    // Resend with correct packet length
-    if (loraComm.sendPacket(txBuffer, lastTxLength)) {
-        serialCmd.printInfo("Message retransmitted");
-        txTimestamp = millis();
+    // Resend the stored frame unchanged, in its original class
+    if (txQueue.enqueueRef((TxClass)slot->priority, slot->frame, slot->length, TX_TTL_NONE, TX_TAG_WINDOW)) {
+        serialCmd.printInfo(F("Message retransmitted"));
         return true;
     } else {
-        serialCmd.printError("Retry transmission failed");
+        serialCmd.printError(F("Retry transmission failed"));
+        txWindow.markSent(slot->frame);
         return false;
     }
 }
+
+unsigned long pumpTxQueue() {
+    // One frame on air at a time; the queue picks the most urgent next
+    if (loraComm.isTransmitting()) {
+        return 0;
+    }
+
+    const TxEntry* entry = txQueue.peek();
+    if (entry == nullptr) {
+        return 0;
+    }
+
+    // Over the duty-cycle budget: the frame waits in the queue (its TTL
+    // still runs) and the loop sleeps until the budget covers it
+    unsigned long wait = loraComm.getTxDelay(entry->length);
+    if (wait > 0) {
+        return wait;
+    }
+
+    // Listen before talk: back off while another node is on air. A window
+    // frame given up is retried once its ACK timeout expires.
+    wait = loraComm.checkChannel(entry->length);
+    if (wait == LBT_GIVE_UP) {
+        serialCmd.printError(F("Channel busy, frame dropped"));
+        onTxDrop(*entry);
+        txQueue.pop();
+        return 0;
+    }
+    if (wait > 0) {
+        return wait;
+    }
+
+    // Window frames start their ACK timer now; one ACKed while it waited
+    // (an overtaken retransmission) is not sent at all
+    if (entry->tag != TX_TAG_WINDOW || txWindow.markSent(entry->frame)) {
+        if (!loraComm.sendPacketAsync(entry->frame, entry->length)) {
+            serialCmd.printError(F("Transmission failed, will retry"));
+        }
+#if ADR_ENABLED
+        if (entry->tag == TX_TAG_WINDOW) {
+            adr.recordTransmission();
+        }
+#endif
+#if STREAM_ENABLED
+        lastPeerTx = millis();
+#endif
+    }
+
+    txQueue.pop();
+    return 0;
+}
+
+void onTxDrop(const TxEntry& entry) {
+    // Preempted by a more urgent frame: retry once the ACK timeout expires
+    if (entry.tag == TX_TAG_WINDOW) {
+        txWindow.markSent(entry.frame);
+    }
+}
+
+#if STREAM_ENABLED
+// ===== Streaming =====
+
+void handleSubscribe(uint8_t peer) {
+    SubscribeInfo info;
+    if (!protocol.parseSubscribe(lastRxMessage, info)) {
+        serialCmd.printError(F("Failed to parse subscribe"));
+        holdAck(ACK_INVALID);
+        return;
+    }
+
+    // Held: the ACK rides on the first streamed reading
+    holdAck(ACK_OK);
+
+    if (info.leaseS == 0 || info.sensorMask == 0 || info.intervalS == 0) {
+        if (publication.active && publication.subscriber == peer) {
+            publication.active = false;
+            scheduler.stop(streamTask);
+            Serial.println(F("[SUB] Stream cancelled"));
+        }
+        return;
+    }
+
+    // A renewal with unchanged settings keeps the stream's rhythm
+    bool renewal = publication.active && publication.subscriber == peer &&
+                   publication.info.sensorMask == info.sensorMask &&
+                   publication.info.intervalS == info.intervalS;
+
+    publication.active = true;
+    publication.subscriber = peer;
+    publication.info = info;
+    publication.renewedAt = millis();
+
+    if (renewal) {
+        Serial.println(F("[SUB] Lease renewed"));
+        return;
+    }
+
+    publication.sentMask = 0;
+    scheduler.reschedule(streamTask, 0);
+
+    Serial.print(F("[SUB] Streaming mask 0x"));
+    Serial.print(info.sensorMask, HEX);
+    Serial.print(F(" every "));
+    Serial.print(info.intervalS);
+    Serial.print(F(" s to 0x"));
+    Serial.print(peer, HEX);
+    Serial.print(F(", lease "));
+    Serial.print(info.leaseS);
+    Serial.println(F(" s"));
+}
+
+void streamReadings() {
+    if (!publication.active) {
+        return;
+    }
+
+    if (millis() - publication.renewedAt >= publication.info.leaseS * 1000UL) {
+        publication.active = false;
+        Serial.println(F("[SUB] Lease expired, stream stopped"));
+        return;
+    }
+
+    unsigned long intervalMs = publication.info.intervalS * 1000UL;
+    protocol.setDestination(publication.subscriber);
+
+    for (uint8_t id = SENSOR_TEMPERATURE; id <= SENSOR_PRESSURE; id++) {
+        uint8_t bit = 1 << (id - 1);
+        if ((publication.info.sensorMask & bit) == 0) {
+            continue;
+        }
+
+        // Within the deadband of the last reading sent: nothing new to say
+        float value = sensors.readSensorById(id);
+        if ((publication.sentMask & bit) &&
+            fabs(value - publication.lastValue[id - 1]) < publication.info.deadband) {
+            continue;
+        }
+
+        // Stale once the next reading is due
+        uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+        size_t len = (frame != nullptr) ? protocol.encodeSensorStream(id, value, sensors.getSensorUnit(id), frame) : 0;
+        if (txQueue.commit(len, intervalMs)) {
+            publication.sentMask |= bit;
+            publication.lastValue[id - 1] = value;
+            stats.messagesSent++;
+            notePiggybackedAck();
+        }
+    }
+
+    protocol.setDestination(PEER_ADDRESS);
+    scheduler.reschedule(streamTask, intervalMs);
+}
+
+uint16_t sendSubscribe() {
+    uint8_t* frame = txWindow.nextFrame();
+    if (frame == nullptr) {
+        serialCmd.printError(F("Send window full"));
+        return 0;
+    }
+
+    uint16_t msgId = 0;
+    size_t len = protocol.encodeSubscribe(subscription, frame, &msgId);
+    if (len == 0) {
+        serialCmd.printError(F("Failed to encode subscribe"));
+        return 0;
+    }
+
+    msgId = sendFrame(frame, len, msgId, TX_CLASS_CONTROL);
+    serialCmd.printSentMessage("SUBSCRIBE", subscription.leaseS != 0 ? "start/renew" : "cancel", msgId != 0);
+    return msgId;
+}
+
+void renewSubscription() {
+    // Frames sent to the peer meanwhile renewed the lease already
+    if (millis() - lastPeerTx >= STREAM_LEASE_S * 500UL) {
+        sendSubscribe();
+    }
+}
+#endif
+
+#if STREAM_ENABLED || POLL_ENABLED
+uint8_t parseSensorMask(const String& name) {
+    if (name == "temp") {
+        return 1 << (SENSOR_TEMPERATURE - 1);
+    } else if (name == "humid") {
+        return 1 << (SENSOR_HUMIDITY - 1);
+    } else if (name == "bat") {
+        return 1 << (SENSOR_BATTERY - 1);
+    } else if (name == "pressure") {
+        return 1 << (SENSOR_PRESSURE - 1);
+    } else if (name == "all") {
+        return (1 << SENSOR_PRESSURE) - 1;
+    }
+    return 0;
+}
+#endif
+
+#if POLL_ENABLED
+// ===== Polling =====
+
+void pollNodes() {
+    poller.checkTimeouts();
+
+    // One poll waiting for the radio at a time, so each pick sees the
+    // latest replies and backoffs
+    uint8_t address;
+    uint8_t sensorId;
+    if (txQueue.getDepth(TX_CLASS_TELEMETRY) > 0 || !poller.next(address, sensorId)) {
+        return;
+    }
+
+    // Stale once the poller has given up on it
+    uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+    protocol.setDestination(address);
+    size_t len = (frame != nullptr) ? protocol.encodePoll(sensorId, frame) : 0;
+    protocol.setDestination(PEER_ADDRESS);
+
+    if (txQueue.commit(len, POLL_TIMEOUT_MS)) {
+        stats.messagesSent++;
+        notePiggybackedAck();
+    }
+}
+#endif
+
+#if FRAGMENT_ENABLED
+// ===== Fragmentation =====
+
+bool startTransfer(size_t length) {
+    if (transfer.active) {
+        return false;
+    }
+
+    transfer.active = true;
+    transfer.id = nextTransferId++;
+    transfer.count = MessageProtocol::getFragmentCount(length);
+    transfer.next = 0;
+    transfer.length = length;
+    transfer.startedAt = millis();
+
+    Serial.print(F("[TX] Transfer "));
+    Serial.print(transfer.id);
+    Serial.print(F(": "));
+    Serial.print(length);
+    Serial.print(F(" bytes in "));
+    Serial.print(transfer.count);
+    Serial.println(F(" fragments"));
+    return true;
+}
+
+void feedTransfer() {
+    if (!transfer.active) {
+        return;
+    }
+
+    // Every fragment ACKed: done
+    if (transfer.next == transfer.count) {
+        if (txWindow.isEmpty()) {
+            transfer.active = false;
+            Serial.print(F("[TX] Transfer "));
+            Serial.print(transfer.id);
+            Serial.print(F(" done in "));
+            Serial.print(millis() - transfer.startedAt);
+            Serial.println(F(" ms"));
+        }
+        return;
+    }
+
+    // Leave one slot for commands, replies and subscriptions
+    while (transfer.next < transfer.count && txWindow.getOutstanding() + 1 < ARQ_WINDOW_SIZE) {
+        uint8_t* frame = txWindow.nextFrame();
+        if (frame == nullptr) {
+            return;
+        }
+
+        // Test payload: A-Z repeated, sent as text so the receiver previews it
+        uint8_t data[MSG_FRAGMENT_DATA_SIZE];
+        size_t offset = (size_t)transfer.next * MSG_FRAGMENT_DATA_SIZE;
+        size_t length = transfer.length - offset;
+        if (length > MSG_FRAGMENT_DATA_SIZE) {
+            length = MSG_FRAGMENT_DATA_SIZE;
+        }
+        for (size_t i = 0; i < length; i++) {
+            data[i] = 'A' + (offset + i) % 26;
+        }
+
+        FragmentInfo fragment = {transfer.id, transfer.next, transfer.count, MSG_TEXT};
+        uint16_t msgId = 0;
+        size_t len = protocol.encodeFragment(fragment, data, length, frame, &msgId);
+        if (sendFrame(frame, len, msgId, TX_CLASS_BULK) == 0) {
+            return;
+        }
+        transfer.next++;
+    }
+}
+
+void handleFragment(uint8_t peer) {
+    FragmentInfo fragment;
+    const uint8_t* data;
+    size_t length;
+    if (!protocol.parseFragment(lastRxMessage, fragment, data, length)) {
+        serialCmd.printError(F("Failed to parse fragment"));
+        holdAck(ACK_ERROR);
+        return;
+    }
+
+    // ACKed even if the reassembler has no room: a refused transfer is
+    // not helped by the sender retrying it fragment by fragment
+    holdAck(ACK_OK);
+
+    const Reassembly* done = reassembler.add(peer, fragment, data, length);
+    if (done == nullptr) {
+        return;
+    }
+
+    Serial.print(F("[RX] Reassembled "));
+    Serial.print(done->length);
+    Serial.print(F(" bytes in "));
+    Serial.print(done->count);
+    Serial.print(F(" fragments, "));
+    Serial.print(millis() - done->startedAt);
+    Serial.println(F(" ms"));
+
+    if (done->type == MSG_TEXT) {
+        Serial.print(F("[RX] Text: "));
+        for (size_t i = 0; i < done->length && i < 40; i++) {
+            Serial.print((char)done->data[i]);
+        }
+        Serial.println(done->length > 40 ? F("...") : F(""));
+    }
+
+    reassembler.release(done);
+}
+#endif
+
+#if ADR_ENABLED
+// ===== Adaptive Data Rate =====
+
+void evaluateAdr() {
+    // One negotiation at a time, and none while a switch is unconfirmed
+    if (adrRequestId != 0 || adrSwitchPending || scheduler.isPending(adrFallbackTask)) {
+        return;
+    }
+
+    RadioSettings next;
+    if (!adr.evaluate(PEER_ADDRESS, loraComm.getSettings(), next)) {
+        return;
+    }
+
+    uint8_t* frame = txWindow.nextFrame();
+    if (frame == nullptr) {
+        return;
+    }
+
+    LinkAdrInfo request = {ADR_OP_REQUEST, next.spreadingFactor, next.bandwidth, next.txPower};
+    uint16_t msgId = 0;
+    size_t len = protocol.encodeLinkAdr(request, frame, &msgId);
+    msgId = sendFrame(frame, len, msgId, TX_CLASS_CONTROL);
+    if (msgId != 0) {
+        adrRequestId = msgId;
+        adrPending = next;
+        Serial.print(F("[ADR] Proposing "));
+        printRadioSettings(next);
+        Serial.println();
+    }
+}
+
+void handleLinkAdr() {
+    LinkAdrInfo info;
+    if (!protocol.parseLinkAdr(lastRxMessage, info)) {
+        serialCmd.printError(F("Failed to parse ADR request"));
+        holdAck(ACK_ERROR);
+        return;
+    }
+
+    // A confirmation already did its job by arriving
+    if (info.op != ADR_OP_REQUEST) {
+        holdAck(ACK_OK);
+        return;
+    }
+
+    // Refused while a change of our own is under way
+    RadioSettings next = {info.spreadingFactor, info.bandwidth, info.txPower};
+    if (!LoRaComm::isValidSettings(next) || adrRequestId != 0 || adrSwitchPending ||
+        scheduler.isPending(adrFallbackTask)) {
+        serialCmd.printError(F("ADR request refused"));
+        holdAck(ACK_ERROR);
+        return;
+    }
+
+    // The ACK has to go out under the old settings: switch afterwards
+    holdAck(ACK_OK);
+    adrPending = next;
+    adrSwitchPending = true;
+}
+
+void finishAdrSwitch() {
+    if (!adrSwitchPending || scheduler.isPending(ackTask) || !txQueue.isEmpty() || loraComm.isTransmitting()) {
+        return;
+    }
+
+    adrSwitchPending = false;
+    switchRadio(adrPending);
+}
+
+void switchRadio(const RadioSettings& next) {
+    adrPrevious = loraComm.getSettings();
+    useRadio(next);
+    adrSwitchedAt = millis();
+
+    // Room for the confirmation and its retries at the new rate
+    unsigned long fallbackMs = ADR_FALLBACK_MS +
+        (MAX_RETRIES + 1) * 2 * (loraComm.getAirtimeUs(LORA_MAX_PACKET_LENGTH) / 1000);
+    scheduler.reschedule(adrFallbackTask, fallbackMs);
+
+    Serial.print(F("[ADR] Switched to "));
+    printRadioSettings(next);
+    Serial.println(F(", awaiting peer"));
+}
+
+void useRadio(const RadioSettings& settings) {
+    if (!loraComm.applySettings(settings)) {
+        serialCmd.printError(F("Invalid radio settings"));
+        return;
+    }
+
+    // History and round-trip times from the old rate no longer apply;
+    // the timeout starts over at 600 symbols, like ARQ_RTO_INITIAL_MS
+    adr.reset();
+    txWindow.resetRtt((unsigned long)loraQuarterSymbolUs(settings.spreadingFactor, settings.bandwidth) * 4 * 600 / 1000);
+}
+
+void adrFallback() {
+    serialCmd.printError(F("ADR: nothing heard under the new settings, falling back"));
+    useRadio(adrPrevious);
+    adrSwitchedAt = millis();
+}
+#endif
+
+void printRadioSettings(const RadioSettings& settings) {
+    Serial.print(F("SF"));
+    Serial.print(settings.spreadingFactor);
+    Serial.print(F(", "));
+    Serial.print(settings.bandwidth / 1E3);
+    Serial.print(F(" kHz, "));
+    Serial.print(settings.txPower);
+    Serial.print(F(" dBm"));
+}
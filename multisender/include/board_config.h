@@ -55,6 +55,53 @@
 #define LORA_SYNC_WORD 0x12             // Private network sync word
 #define LORA_TX_POWER 17                // TX power in dBm (2-20)
 
+// Duty cycle: share of airtime the radio may use, per mille, averaged over
+// DUTY_CYCLE_WINDOW_S (EU 433 MHz SRD band: 10%). Frames over the budget wait.
+#define DUTY_CYCLE_PERMILLE 100
+#define DUTY_CYCLE_WINDOW_S 3600
+
+// Listen before talk: CAD before each transmission, random backoff while
+// the channel is busy, frame dropped after LBT_MAX_WAIT_MS of busy channel
+#define LBT_ENABLED 1
+#define LBT_MAX_WAIT_MS 2000
+
+// ===== Sender Mode =====
+#ifndef SEND_SNAPSHOT
+    #define SEND_SNAPSHOT 1  // 1 = all sensors in one batch frame per TX, 0 = rotate one sensor per TX
+#endif
+
+// Send timing: random phase plus up to SEND_JITTER_MS per send, or with
+// SEND_SLOTTED a slot (one frame + guard) picked by the short address in
+// periods started by the receiver's beacon (SLOT_BEACON_INTERVAL_MS)
+#ifndef SEND_JITTER_MS
+    #define SEND_JITTER_MS 1000
+#endif
+#ifndef SEND_SLOTTED
+    #define SEND_SLOTTED 0
+#endif
+
+// Uplink frequency hopping across HOP_CHANNEL_PLAN (see ChannelHopper.h),
+// one channel per receiver period. Needs the receiver built with
+// HOP_ENABLED; frames wait for its first beacon.
+#ifndef HOP_ENABLED
+    #define HOP_ENABLED 0
+#endif
+
+// ===== Join Handshake =====
+// Each module joins the receiver for its own short address
+#ifndef JOIN_RETRY_INTERVAL_MS
+    #define JOIN_RETRY_INTERVAL_MS 30000  // Until joined, frames carry LORA1_NAME/LORA2_NAME inline
+#endif
+#ifndef RX_POLL_INTERVAL_MS
+    #define RX_POLL_INTERVAL_MS 10  // Join replies are polled from both modules
+#endif
+
+// ===== TX Priority Queue =====
+// Frames waiting for either module (join requests ahead of telemetry)
+#ifndef TX_QUEUE_SLOTS
+    #define TX_QUEUE_SLOTS 4
+#endif
+
 // ===== Serial Configuration =====
 #define SERIAL_BAUD 9600
 
@@ -0,0 +1,242 @@
+#include "ChannelHopper.h"
+
+static const long HOP_PLAN[] = HOP_CHANNEL_PLAN;
+#define HOP_PLAN_SIZE ((uint8_t)(sizeof(HOP_PLAN) / sizeof(HOP_PLAN[0])))
+#define HOP_PLAN_MASK ((uint16_t)((1UL << HOP_PLAN_SIZE) - 1))
+
+static_assert(sizeof(HOP_PLAN) / sizeof(HOP_PLAN[0]) <= HOP_MAX_CHANNELS, "HOP_CHANNEL_PLAN has more than 16 channels");
+static_assert(HOP_MIN_CHANNELS >= 1, "HOP_MIN_CHANNELS must be at least 1");
+static_assert(HOP_BLACKLIST_LOSS > 0 && HOP_BLACKLIST_LOSS < 100, "HOP_BLACKLIST_LOSS must be 1-99");
+
+static uint8_t gcd(uint8_t a, uint8_t b) {
+    while (b != 0) {
+        uint8_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+ChannelHopper::ChannelHopper()
+    : synced(false), syncStart(0), lastSync(0), period(1), syncHop(0), blacklist(0), nextBlacklist(0) {
+    memset(quality, 0, sizeof(quality));
+}
+
+uint8_t ChannelHopper::getChannelCount() {
+    return HOP_PLAN_SIZE;
+}
+
+long ChannelHopper::getFrequency(uint8_t channel) {
+    return (channel < HOP_PLAN_SIZE) ? HOP_PLAN[channel] : HOP_PLAN[0];
+}
+
+// ===== Hop Clock =====
+
+void ChannelHopper::sync(unsigned long periodStart, unsigned long periodMs, uint16_t hop, uint16_t mask) {
+    syncStart = periodStart;
+    period = (periodMs > 0) ? periodMs : 1;
+    syncHop = hop;
+    lastSync = millis();
+    synced = true;
+
+    // Never leave the plan empty
+    mask &= HOP_PLAN_MASK;
+    blacklist = (mask == HOP_PLAN_MASK) ? 0 : mask;
+}
+
+bool ChannelHopper::isSynced() {
+    return synced && millis() - lastSync < HOP_SYNC_TIMEOUT_MS;
+}
+
+uint16_t ChannelHopper::getHop(unsigned long now) {
+    if ((long)(now - syncStart) < 0) {
+        return syncHop;
+    }
+    return syncHop + (uint16_t)((now - syncStart) / period);
+}
+
+unsigned long ChannelHopper::getHopOffset(unsigned long now) {
+    if ((long)(now - syncStart) < 0) {
+        return 0;
+    }
+    return (now - syncStart) % period;
+}
+
+uint8_t ChannelHopper::sequence(uint16_t hop) {
+    if (HOP_PLAN_SIZE < 2) {
+        return 0;
+    }
+
+    uint16_t run = hop / HOP_PLAN_SIZE;
+    uint8_t position = hop % HOP_PLAN_SIZE;
+
+    // Hash of key and run number (lowbias32 finalizer)
+    uint32_t h = ((uint32_t)HOP_SEED << 16) ^ run;
+    h ^= h >> 16;
+    h *= 0x7FEB352DUL;
+    h ^= h >> 15;
+    h *= 0x846CA68BUL;
+    h ^= h >> 16;
+
+    // position * step + offset is a permutation when step is coprime to N
+    uint8_t step = 1 + h % (HOP_PLAN_SIZE - 1);
+    while (gcd(step, HOP_PLAN_SIZE) != 1) {
+        step = step % (HOP_PLAN_SIZE - 1) + 1;
+    }
+    uint8_t offset = (h >> 8) % HOP_PLAN_SIZE;
+
+    return (uint8_t)((position * step + offset) % HOP_PLAN_SIZE);
+}
+
+uint8_t ChannelHopper::getChannel(unsigned long now) {
+    uint8_t channel = sequence(getHop(now));
+
+    // Blacklisted: the next usable channel takes the hop
+    for (uint8_t i = 0; i < HOP_PLAN_SIZE && (blacklist & (1U << channel)); i++) {
+        channel = (channel + 1) % HOP_PLAN_SIZE;
+    }
+    return channel;
+}
+
+unsigned long ChannelHopper::getTxDelay(uint32_t airtimeUs) {
+    if (!isSynced()) {
+        return HOP_SYNC_TIMEOUT_MS;
+    }
+
+    unsigned long airtimeMs = airtimeUs / 1000 + 1;
+    if (airtimeMs + 2 * HOP_GUARD_MS > period) {
+        return 0;  // Longer than a hop: cannot be kept inside one
+    }
+
+    unsigned long offset = getHopOffset(millis());
+    if (offset < HOP_GUARD_MS) {
+        return HOP_GUARD_MS - offset;
+    }
+    if (offset + airtimeMs + HOP_GUARD_MS <= period) {
+        return 0;
+    }
+    return period - offset + HOP_GUARD_MS;
+}
+
+// ===== Channel Quality =====
+
+void ChannelHopper::recordVisit(uint8_t channel, uint16_t frames) {
+    if (channel >= HOP_PLAN_SIZE) {
+        return;
+    }
+
+    ChannelQuality& q = quality[channel];
+    q.received += frames;
+
+    // Frames per hop, EWMA with weight 1/4
+    uint16_t sample = (frames > 4095) ? 65520 : frames * 16;
+    q.frames = (q.visits == 0) ? sample : q.frames - q.frames / 4 + sample / 4;
+    if (q.visits < 0xFFFF) {
+        q.visits++;
+    }
+
+    evaluate();
+}
+
+void ChannelHopper::evaluate() {
+    unsigned long now = millis();
+
+    // Blacklisted channels get another chance after HOP_BLACKLIST_MS
+    for (uint8_t c = 0; c < HOP_PLAN_SIZE; c++) {
+        if ((nextBlacklist & (1U << c)) && now - quality[c].blacklistedAt >= HOP_BLACKLIST_MS) {
+            nextBlacklist &= ~(1U << c);
+            quality[c].visits = 0;
+        }
+    }
+
+    // Mean frames per hop over the channels in use with enough visits
+    uint32_t sum = 0;
+    uint8_t counted = 0;
+    uint8_t usable = 0;
+    for (uint8_t c = 0; c < HOP_PLAN_SIZE; c++) {
+        if (nextBlacklist & (1U << c)) {
+            continue;
+        }
+        usable++;
+        if (quality[c].visits >= HOP_MIN_VISITS) {
+            sum += quality[c].frames;
+            counted++;
+        }
+    }
+    if (counted < 2 || usable <= HOP_MIN_CHANNELS) {
+        return;
+    }
+
+    // Under one frame per hop: too little traffic to judge
+    uint32_t mean = sum / counted;
+    if (mean < 16) {
+        return;
+    }
+
+    // Blacklist the worst channel, if it is bad enough (one per hop)
+    uint8_t worst = HOP_PLAN_SIZE;
+    for (uint8_t c = 0; c < HOP_PLAN_SIZE; c++) {
+        if ((nextBlacklist & (1U << c)) || quality[c].visits < HOP_MIN_VISITS) {
+            continue;
+        }
+        if ((uint32_t)quality[c].frames * 100 < mean * (100 - HOP_BLACKLIST_LOSS) &&
+            (worst == HOP_PLAN_SIZE || quality[c].frames < quality[worst].frames)) {
+            worst = c;
+        }
+    }
+    if (worst < HOP_PLAN_SIZE) {
+        nextBlacklist |= (1U << worst);
+        quality[worst].blacklistedAt = now;
+    }
+}
+
+uint16_t ChannelHopper::getBlacklist() {
+    return blacklist;
+}
+
+uint16_t ChannelHopper::getNextBlacklist() {
+    return nextBlacklist;
+}
+
+void ChannelHopper::printStats() {
+    Serial.print(F("Hopping: "));
+    if (!HOP_ENABLED) {
+        Serial.println(F("off"));
+        return;
+    }
+
+    Serial.print(HOP_PLAN_SIZE);
+    Serial.print(F(" channels, "));
+    if (!isSynced()) {
+        Serial.println(F("waiting for beacon"));
+    } else {
+        unsigned long now = millis();
+        uint8_t channel = getChannel(now);
+        Serial.print(F("hop "));
+        Serial.print(getHop(now));
+        Serial.print(F(" on ch"));
+        Serial.print(channel);
+        Serial.print(F(" ("));
+        Serial.print(getFrequency(channel) / 1E6, 3);
+        Serial.print(F(" MHz), blacklist 0x"));
+        Serial.println(blacklist, HEX);
+    }
+
+    // Receiver only: reception per channel
+    for (uint8_t c = 0; c < HOP_PLAN_SIZE; c++) {
+        if (quality[c].visits == 0 && quality[c].received == 0) {
+            continue;
+        }
+        Serial.print(F("  ch"));
+        Serial.print(c);
+        Serial.print(F(": "));
+        Serial.print(quality[c].received);
+        Serial.print(F(" frames, "));
+        Serial.print(quality[c].frames / 16.0, 1);
+        Serial.print(F("/hop"));
+        if (nextBlacklist & (1U << c)) {
+            Serial.print(F(", blacklisted"));
+        }
+        Serial.println();
+    }
+}
@@ -1,6 +1,15 @@
 #include "DualLoRaComm.h"
 
-DualLoRaComm::DualLoRaComm() {
+// ESP32: interrupt handlers must sit in IRAM (flash cache may be off)
+#if defined(ESP32)
+    #define LORA_ISR_ATTR IRAM_ATTR
+#else
+    #define LORA_ISR_ATTR
+#endif
+
+DualLoRaComm* DualLoRaComm::instance = nullptr;
+
+DualLoRaComm::DualLoRaComm() : txDoneCallback(nullptr), cadTimeoutMs(0) {
     // Initialize device names from build flags
     deviceNames[MODULE_1] = LORA1_NAME;
     deviceNames[MODULE_2] = LORA2_NAME;
@@ -14,6 +23,16 @@ DualLoRaComm::DualLoRaComm() {
 
     resetPins[MODULE_1] = LORA1_RESET;
     resetPins[MODULE_2] = LORA2_RESET;
+
+    for (uint8_t i = 0; i < NUM_LORA_MODULES; i++) {
+        txBusy[i] = false;
+        irqPending[i] = false;
+        txStartTime[i] = 0;
+        cadStates[i] = CAD_IDLE;
+        cadStarts[i] = 0;
+        txFrequencies[i] = LORA_FREQUENCY;
+        tunedFrequencies[i] = LORA_FREQUENCY;
+    }
 }
 
 bool DualLoRaComm::begin() {
@@ -53,6 +72,18 @@ bool DualLoRaComm::begin() {
     Serial.print(deviceNames[MODULE_2]);
     Serial.println(F(") initialized successfully"));
 
+    // Packet data bypasses LoRaClass::write() and uses burst transfers
+    fifos[MODULE_1].begin(nssPins[MODULE_1]);
+    fifos[MODULE_2].begin(nssPins[MODULE_2]);
+
+    // TxDone interrupts for asynchronous sends: the ISRs only flag them,
+    // isTransmitting() clears them over SPI from loop()
+    instance = this;
+    pinMode(dio0Pins[MODULE_1], INPUT);
+    pinMode(dio0Pins[MODULE_2], INPUT);
+    attachInterrupt(digitalPinToInterrupt(dio0Pins[MODULE_1]), handleDio0Module1, RISING);
+    attachInterrupt(digitalPinToInterrupt(dio0Pins[MODULE_2]), handleDio0Module2, RISING);
+
     Serial.println(F("\n=== Both modules initialized successfully ==="));
     return true;
 }
@@ -112,6 +143,14 @@ void DualLoRaComm::selectModule(uint8_t moduleIndex) {
 }
 
 bool DualLoRaComm::sendPacket(uint8_t moduleIndex, const uint8_t* data, size_t length) {
+    return transmit(moduleIndex, data, length, false);
+}
+
+bool DualLoRaComm::sendPacketAsync(uint8_t moduleIndex, const uint8_t* data, size_t length) {
+    return transmit(moduleIndex, data, length, true);
+}
+
+bool DualLoRaComm::transmit(uint8_t moduleIndex, const uint8_t* data, size_t length, bool async) {
     if (moduleIndex >= NUM_LORA_MODULES) {
         Serial.println(F("ERROR: Invalid module index"));
         return false;
@@ -125,11 +164,38 @@ bool DualLoRaComm::sendPacket(uint8_t moduleIndex, const uint8_t* data, size_t l
     // Get reference to correct module
     LoRaClass& lora = (moduleIndex == MODULE_1) ? lora1 : lora2;
 
+    // Charged up front: a packet the budget cannot cover is not sent at all
+    if (!dutyCycles[moduleIndex].consume(getAirtimeUs(length))) {
+        Serial.print(F("ERROR: Duty cycle limit reached on module "));
+        Serial.println(moduleIndex);
+        return false;
+    }
+
+    // Only one packet per module can be on air at a time
+    waitTransmitDone(moduleIndex);
+    cancelCad(moduleIndex);
+
     // Begin packet
-    lora.beginPacket();
+    if (!lora.beginPacket()) {
+        Serial.print(F("ERROR: Radio busy on module "));
+        Serial.println(moduleIndex);
+        return false;
+    }
+
+    // beginPacket() left the radio in standby: switch to the TX channel
+    tune(moduleIndex, txFrequencies[moduleIndex]);
 
-    // Write data
-    lora.write(data, length);
+    // Write data (single burst into the FIFO)
+    fifos[moduleIndex].writePacket(data, (uint8_t)length);
+
+    if (async) {
+        // Start TX and return; isTransmitting() finishes up after TxDone
+        txStartTime[moduleIndex] = millis();
+        txBusy[moduleIndex] = true;
+        fifos[moduleIndex].mapDio0(SX1278_DIO0_TX_DONE);
+        lora.endPacket(true);
+        return true;
+    }
 
     // End packet and transmit
     if (!lora.endPacket()) {
@@ -141,6 +207,229 @@ bool DualLoRaComm::sendPacket(uint8_t moduleIndex, const uint8_t* data, size_t l
     return true;
 }
 
+bool DualLoRaComm::isTransmitting(uint8_t moduleIndex) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        return false;
+    }
+
+    if (irqPending[moduleIndex]) {
+        irqPending[moduleIndex] = false;
+        if ((fifos[moduleIndex].takeIrqFlags(SX1278_IRQ_TX_DONE) & SX1278_IRQ_TX_DONE) && txBusy[moduleIndex]) {
+            finishTransmit(moduleIndex);
+        }
+    }
+
+    if (txBusy[moduleIndex] && millis() - txStartTime[moduleIndex] > LORA_TX_TIMEOUT_MS) {
+        // TxDone never arrived (DIO0 not wired?)
+        Serial.print(F("ERROR: TX done interrupt timeout on module "));
+        Serial.println(moduleIndex);
+        txBusy[moduleIndex] = false;
+    }
+    return txBusy[moduleIndex];
+}
+
+void DualLoRaComm::waitTransmitDone(uint8_t moduleIndex) {
+    while (isTransmitting(moduleIndex)) {
+        yield();
+    }
+}
+
+int DualLoRaComm::receivePacket(uint8_t moduleIndex, uint8_t* buffer, size_t maxLength) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        return 0;
+    }
+
+    // parsePacket() switches the radio to RX and would cut a transmission
+    // or a CAD cycle short
+    serviceCad(moduleIndex);
+    if (isTransmitting(moduleIndex) || cadStates[moduleIndex] == CAD_RUNNING) {
+        return 0;
+    }
+
+    LoRaClass& lora = (moduleIndex == MODULE_1) ? lora1 : lora2;
+
+    // Back from a TX channel: listen on the home channel again
+    if (tunedFrequencies[moduleIndex] != LORA_FREQUENCY) {
+        lora.idle();
+        tune(moduleIndex, LORA_FREQUENCY);
+    }
+
+    int packetSize = lora.parsePacket();
+    if (packetSize <= 0) {
+        return 0;
+    }
+
+    // Read packet data (single burst from the FIFO)
+    size_t length = ((size_t)packetSize > maxLength) ? maxLength : (size_t)packetSize;
+    return fifos[moduleIndex].readPacket(buffer, (uint8_t)length);
+}
+
+void DualLoRaComm::onTxDone(void (*callback)(uint8_t moduleIndex)) {
+    txDoneCallback = callback;
+}
+
+const volatile bool* DualLoRaComm::getEventFlag(uint8_t moduleIndex) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        moduleIndex = MODULE_1;
+    }
+    return &irqPending[moduleIndex];
+}
+
+void LORA_ISR_ATTR DualLoRaComm::handleDio0Module1() {
+    if (instance != nullptr) {
+        instance->irqPending[MODULE_1] = true;
+    }
+}
+
+void LORA_ISR_ATTR DualLoRaComm::handleDio0Module2() {
+    if (instance != nullptr) {
+        instance->irqPending[MODULE_2] = true;
+    }
+}
+
+void DualLoRaComm::finishTransmit(uint8_t moduleIndex) {
+    txBusy[moduleIndex] = false;
+
+    if (txDoneCallback != nullptr) {
+        txDoneCallback(moduleIndex);
+    }
+}
+
+void DualLoRaComm::setTxFrequency(uint8_t moduleIndex, long frequency) {
+    if (moduleIndex < NUM_LORA_MODULES) {
+        txFrequencies[moduleIndex] = frequency;
+    }
+}
+
+void DualLoRaComm::tune(uint8_t moduleIndex, long frequency) {
+    if (tunedFrequencies[moduleIndex] != frequency) {
+        LoRaClass& lora = (moduleIndex == MODULE_1) ? lora1 : lora2;
+        lora.setFrequency(frequency);
+        tunedFrequencies[moduleIndex] = frequency;
+    }
+}
+
+uint32_t DualLoRaComm::getAirtimeUs(size_t length) {
+    return loraTimeOnAirUs(length);
+}
+
+unsigned long DualLoRaComm::getTxDelay(uint8_t moduleIndex, size_t length) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        return 0;
+    }
+    return dutyCycles[moduleIndex].getDelay(getAirtimeUs(length));
+}
+
+DutyCycle& DualLoRaComm::getDutyCycle(uint8_t moduleIndex) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        moduleIndex = MODULE_1;
+    }
+    return dutyCycles[moduleIndex];
+}
+
+void DualLoRaComm::setListenBeforeTalk(bool enabled) {
+    for (uint8_t i = 0; i < NUM_LORA_MODULES; i++) {
+        lbts[i].setEnabled(enabled);
+    }
+}
+
+unsigned long DualLoRaComm::checkChannel(uint8_t moduleIndex, size_t length) {
+    if (moduleIndex >= NUM_LORA_MODULES || !lbts[moduleIndex].isEnabled()) {
+        return 0;
+    }
+
+    // CAD under way: come back once it should be done
+    serviceCad(moduleIndex);
+    if (cadStates[moduleIndex] == CAD_RUNNING) {
+        return 1;
+    }
+
+    // One slot is about the airtime of the frame waiting to go
+    unsigned long slotMs = getAirtimeUs(length) / 1000 + 1;
+
+    // A result is taken by the call that follows the cycle; one left
+    // over from a frame that went away meanwhile is out of date
+    if (cadStates[moduleIndex] != CAD_IDLE) {
+        bool busy = (cadStates[moduleIndex] == CAD_BUSY);
+        bool fresh = millis() - cadStarts[moduleIndex] <= 2 * cadTimeoutMs;
+        cadStates[moduleIndex] = CAD_IDLE;
+        if (fresh) {
+            return lbts[moduleIndex].next(busy, slotMs);
+        }
+    }
+
+    // Still backing off: the channel is not sensed again before the slot
+    unsigned long wait = lbts[moduleIndex].getBackoff();
+    if (wait > 0) {
+        return wait;
+    }
+
+    // Only one radio operation per module at a time
+    if (isTransmitting(moduleIndex)) {
+        return 1;
+    }
+
+    // A packet being received is activity already; CAD would cut it off
+    if (fifos[moduleIndex].signalDetected()) {
+        return lbts[moduleIndex].next(true, slotMs);
+    }
+
+    // CAD lasts under two symbols; allow four before reading it as clear
+    uint32_t symbolUs = loraQuarterSymbolUs(LORA_SPREADING_FACTOR, (uint32_t)LORA_SIGNAL_BANDWIDTH) * 4;
+    cadTimeoutMs = (symbolUs * 4 + 1000) / 1000 + 1;
+
+    // Sense the channel the packet will go out on (receivePacket() retunes)
+    if (tunedFrequencies[moduleIndex] != txFrequencies[moduleIndex]) {
+        LoRaClass& lora = (moduleIndex == MODULE_1) ? lora1 : lora2;
+        lora.idle();
+        tune(moduleIndex, txFrequencies[moduleIndex]);
+    }
+    fifos[moduleIndex].startCad();
+    cadStates[moduleIndex] = CAD_RUNNING;
+    cadStarts[moduleIndex] = millis();
+    return (symbolUs * 2) / 1000 + 1;
+}
+
+void DualLoRaComm::serviceCad(uint8_t moduleIndex) {
+    if (cadStates[moduleIndex] != CAD_RUNNING) {
+        return;
+    }
+
+    // CAD not done in time reads as a clear channel
+    uint8_t flags = fifos[moduleIndex].takeIrqFlags(SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED);
+    if (!(flags & SX1278_IRQ_CAD_DONE)) {
+        if (millis() - cadStarts[moduleIndex] <= cadTimeoutMs) {
+            return;
+        }
+        LoRaClass& lora = (moduleIndex == MODULE_1) ? lora1 : lora2;
+        lora.idle();
+    }
+    cadStates[moduleIndex] = (flags & SX1278_IRQ_CAD_DETECTED) ? CAD_BUSY : CAD_CLEAR;
+}
+
+void DualLoRaComm::cancelCad(uint8_t moduleIndex) {
+    if (cadStates[moduleIndex] == CAD_RUNNING) {
+        LoRaClass& lora = (moduleIndex == MODULE_1) ? lora1 : lora2;
+        lora.idle();
+        fifos[moduleIndex].takeIrqFlags(SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED);
+    }
+    cadStates[moduleIndex] = CAD_IDLE;
+}
+
+ListenBeforeTalk& DualLoRaComm::getListenBeforeTalk(uint8_t moduleIndex) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        moduleIndex = MODULE_1;
+    }
+    return lbts[moduleIndex];
+}
+
+const SpiStats& DualLoRaComm::getSpiStats(uint8_t moduleIndex) {
+    if (moduleIndex >= NUM_LORA_MODULES) {
+        moduleIndex = MODULE_1;
+    }
+    return fifos[moduleIndex].getStats();
+}
+
 const char* DualLoRaComm::getDeviceName(uint8_t moduleIndex) {
     if (moduleIndex >= NUM_LORA_MODULES) {
         return "Unknown";
@@ -171,6 +460,15 @@ void DualLoRaComm::printConfig() {
     Serial.print(F("Sync Word: 0x"));
     Serial.println(LORA_SYNC_WORD, HEX);
 
+    Serial.print(F("Airtime (255 bytes): "));
+    Serial.print(loraTimeOnAirUs(255) / 1000.0, 1);
+    Serial.print(F(" ms, duty cycle "));
+    Serial.print(DUTY_CYCLE_PERMILLE / 10.0, 1);
+    Serial.println(F("% per module"));
+
+    Serial.print(F("Listen before talk: "));
+    Serial.println(lbts[MODULE_1].isEnabled() ? F("on (CAD)") : F("off"));
+
     Serial.println(F("\n--- Module 1 ---"));
     Serial.print(F("Name: "));
     Serial.println(deviceNames[MODULE_1]);
@@ -4,6 +4,9 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <LoRa.h>
+#include "SX1278Fifo.h"
+#include "DutyCycle.h"
+#include "ListenBeforeTalk.h"
 #include "board_config.h"
 
 // Number of LoRa modules
@@ -13,6 +16,9 @@
 #define MODULE_1 0
 #define MODULE_2 1
 
+// Longest a transmission may stay on air before it is considered lost
+#define LORA_TX_TIMEOUT_MS 12000
+
 class DualLoRaComm {
 public:
     DualLoRaComm();
@@ -20,9 +26,62 @@ public:
     // Initialize both LoRa modules
     bool begin();
 
-    // Send packet via specified module (0 or 1)
+    // Send packet via specified module (0 or 1), blocking until done.
+    // Both send calls refuse packets over the module's duty-cycle budget.
     bool sendPacket(uint8_t moduleIndex, const uint8_t* data, size_t length);
 
+    // Start sending via specified module and return immediately.
+    // Completion is flagged by that module's DIO0 TxDone interrupt and
+    // handled in isTransmitting().
+    bool sendPacketAsync(uint8_t moduleIndex, const uint8_t* data, size_t length);
+
+    // Check if a module still has an asynchronous transmission on air
+    bool isTransmitting(uint8_t moduleIndex);
+
+    // Block until the module's current transmission has finished
+    void waitTransmitDone(uint8_t moduleIndex);
+
+    // Poll a module for a received packet (non-blocking).
+    // Returns number of bytes copied, 0 if none or the module is transmitting.
+    int receivePacket(uint8_t moduleIndex, uint8_t* buffer, size_t maxLength);
+
+    // Set TX complete callback (runs from isTransmitting() in loop())
+    void onTxDone(void (*callback)(uint8_t moduleIndex));
+
+    // Set by a module's DIO0 interrupt until loop() has handled the event
+    // (pass to Scheduler::wakeOn())
+    const volatile bool* getEventFlag(uint8_t moduleIndex);
+
+    // Send (and sense the channel) through a module on this frequency
+    // (Hz). Receiving stays on LORA_FREQUENCY. Default LORA_FREQUENCY.
+    void setTxFrequency(uint8_t moduleIndex, long frequency);
+
+    // Time on air of a packet of this length (us)
+    uint32_t getAirtimeUs(size_t length);
+
+    // ms until a packet of this length fits the module's duty-cycle
+    // budget, 0 if it may go now
+    unsigned long getTxDelay(uint8_t moduleIndex, size_t length);
+
+    // Cumulative airtime and budget counters of a module
+    DutyCycle& getDutyCycle(uint8_t moduleIndex);
+
+    // Run CAD before each transmission on both modules (default: LBT_ENABLED)
+    void setListenBeforeTalk(bool enabled);
+
+    // Sense the channel through a module before sending a packet of this
+    // length: 0 if clear, ms to back off while busy, LBT_GIVE_UP once it
+    // has been busy for LBT_MAX_WAIT_MS. Both modules share the channel,
+    // so one module on air holds the other back. Does not block: the
+    // first call starts CAD and returns its duration, the next takes the result.
+    unsigned long checkChannel(uint8_t moduleIndex, size_t length);
+
+    // Channel sensing and backoff counters of a module
+    ListenBeforeTalk& getListenBeforeTalk(uint8_t moduleIndex);
+
+    // SPI traffic used to move packet data through a module's FIFO
+    const SpiStats& getSpiStats(uint8_t moduleIndex);
+
     // Get device name for module
     const char* getDeviceName(uint8_t moduleIndex);
 
@@ -34,6 +93,15 @@ private:
     LoRaClass lora1;
     LoRaClass lora2;
 
+    // Burst FIFO access per module (one SPI transaction per packet)
+    SX1278Fifo fifos[NUM_LORA_MODULES];
+
+    // Airtime budget per module (each one is a separate transmitter)
+    DutyCycle dutyCycles[NUM_LORA_MODULES];
+
+    // CAD backoff per module
+    ListenBeforeTalk lbts[NUM_LORA_MODULES];
+
     // Module names
     const char* deviceNames[NUM_LORA_MODULES];
 
@@ -42,6 +110,44 @@ private:
     int dio0Pins[NUM_LORA_MODULES];
     int resetPins[NUM_LORA_MODULES];
 
+    // TX channel per module, and the one each radio is on
+    long txFrequencies[NUM_LORA_MODULES];
+    long tunedFrequencies[NUM_LORA_MODULES];
+
+    // Asynchronous transmit state per module; irqPending is the only
+    // state shared with the DIO0 ISRs
+    bool txBusy[NUM_LORA_MODULES];
+    volatile bool irqPending[NUM_LORA_MODULES];
+    unsigned long txStartTime[NUM_LORA_MODULES];
+    void (*txDoneCallback)(uint8_t moduleIndex);
+
+    // Channel activity detection per module: running, or its result
+    // not yet taken by checkChannel()
+    enum CadState : uint8_t { CAD_IDLE, CAD_RUNNING, CAD_CLEAR, CAD_BUSY };
+    CadState cadStates[NUM_LORA_MODULES];
+    unsigned long cadStarts[NUM_LORA_MODULES];
+    unsigned long cadTimeoutMs;
+
+    static DualLoRaComm* instance;
+
+    // Common transmit path for blocking and asynchronous sends
+    bool transmit(uint8_t moduleIndex, const uint8_t* data, size_t length, bool async);
+
+    // DIO0 interrupts (attachInterrupt() passes no context): flag only
+    static void handleDio0Module1();
+    static void handleDio0Module2();
+    void finishTransmit(uint8_t moduleIndex);
+
+    // Pick up a finished (or overdue) CAD cycle; the radio is left in
+    // standby until receivePacket() or a transmission
+    void serviceCad(uint8_t moduleIndex);
+
+    // Stop a CAD cycle still running (before TX)
+    void cancelCad(uint8_t moduleIndex);
+
+    // Retune a module if it is not on this frequency (outside RX/TX)
+    void tune(uint8_t moduleIndex, long frequency);
+
     // Initialize a single module
     bool initModule(LoRaClass& lora, int nss, int dio0, int rst, const char* name);
 
@@ -0,0 +1,77 @@
+#ifndef LISTEN_BEFORE_TALK_H
+#define LISTEN_BEFORE_TALK_H
+
+#include <Arduino.h>
+#include "board_config.h"
+
+// Sense the channel with CAD before every transmission
+#ifndef LBT_ENABLED
+    #define LBT_ENABLED 1
+#endif
+
+// Longest a frame waits for a clear channel before it is dropped (ms)
+#ifndef LBT_MAX_WAIT_MS
+    #define LBT_MAX_WAIT_MS 2000
+#endif
+
+// Backoff window doubles per busy check up to 2^LBT_MAX_BACKOFF_EXP slots
+#ifndef LBT_MAX_BACKOFF_EXP
+    #define LBT_MAX_BACKOFF_EXP 4
+#endif
+
+// checkChannel() result: channel busy for LBT_MAX_WAIT_MS, drop the frame
+#define LBT_GIVE_UP 0xFFFFFFFFUL
+
+static_assert(LBT_MAX_BACKOFF_EXP >= 1 && LBT_MAX_BACKOFF_EXP <= 8, "LBT_MAX_BACKOFF_EXP must be 1-8");
+
+// Listen-before-talk backoff for one radio.
+//
+// The radio driver runs CAD and reports the result; this class decides
+// what happens next. A busy channel backs off a random 1..2^n slots
+// (n grows with each busy check, one slot being about one frame's
+// airtime) so nodes that found the channel busy together do not retry
+// together. A frame that finds the channel busy for LBT_MAX_WAIT_MS is
+// given up. Nothing here touches the radio, so a simulated channel can
+// drive it as well.
+class ListenBeforeTalk {
+public:
+    ListenBeforeTalk();
+
+    // Turn sensing on or off (off: every frame goes straight out)
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // ms left of the current backoff, 0 once the channel may be sensed
+    unsigned long getBackoff();
+
+    // Feed one channel sensing result. Returns 0 if the frame may go now,
+    // ms to back off if the channel is busy, or LBT_GIVE_UP.
+    unsigned long next(bool busy, unsigned long slotMs);
+
+    // Counters: channel checks, checks that found it busy, backoffs and
+    // their total length, frames given up
+    uint32_t getChecks();
+    uint32_t getBusy();
+    uint32_t getBackoffs();
+    uint32_t getBackoffMs();
+    uint32_t getGaveUp();
+
+    // Print sensing and backoff counters
+    void printStats();
+
+private:
+    bool enabled;
+    bool waiting;               // The current frame found the channel busy
+    uint8_t attempt;            // Busy checks for the current frame
+    unsigned long firstBusy;
+    unsigned long backoffStart;
+    unsigned long backoffLength;
+
+    uint32_t checks;
+    uint32_t busyChecks;
+    uint32_t backoffs;
+    uint32_t backoffMs;
+    uint32_t gaveUp;
+};
+
+#endif // LISTEN_BEFORE_TALK_H
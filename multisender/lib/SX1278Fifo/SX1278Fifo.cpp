@@ -0,0 +1,187 @@
+#include "SX1278Fifo.h"
+
+// SX1278 registers used by this layer
+#define REG_FIFO 0x00
+#define REG_OP_MODE 0x01
+#define REG_FIFO_ADDR_PTR 0x0D
+#define REG_FIFO_RX_CURRENT_ADDR 0x10
+#define REG_IRQ_FLAGS 0x12
+#define REG_RX_NB_BYTES 0x13
+#define REG_RX_PACKET_CNT_MSB 0x16
+#define REG_MODEM_STAT 0x18
+#define REG_PAYLOAD_LENGTH 0x22
+#define REG_DIO_MAPPING_1 0x40
+
+// RegOpMode values (LoRa mode)
+#define MODE_LONG_RANGE 0x80
+#define MODE_STDBY 0x01
+#define MODE_CAD 0x07
+
+// RegModemStat: signal detected or synchronized (reception under way)
+#define MODEM_STAT_SIGNAL 0x03
+
+// Address byte MSB selects write access
+#define SPI_WRITE_FLAG 0x80
+
+// Stack scratch for buffer transfers of const data (no writeBytes() on AVR)
+#define WRITE_CHUNK_SIZE 32
+
+SX1278Fifo::SX1278Fifo() : nss(-1), spi(&SPI) {
+    resetStats();
+}
+
+void SX1278Fifo::begin(int nssPin, SPIClass& spiBus) {
+    nss = nssPin;
+    spi = &spiBus;
+}
+
+// ===== Bus Helpers =====
+
+void SX1278Fifo::select() {
+    spi->beginTransaction(SPISettings(SX1278_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+    digitalWrite(nss, LOW);
+    stats.transactions++;
+}
+
+void SX1278Fifo::deselect() {
+    digitalWrite(nss, HIGH);
+    spi->endTransaction();
+}
+
+// ===== Burst FIFO Access =====
+
+uint8_t SX1278Fifo::readPacket(uint8_t* buffer, uint8_t length) {
+    stats.packets++;
+    return readFifo(buffer, length);
+}
+
+uint8_t SX1278Fifo::readFifo(uint8_t* buffer, uint8_t length) {
+    if (length == 0) {
+        return 0;
+    }
+
+    select();
+    spi->transfer(REG_FIFO & ~SPI_WRITE_FLAG);
+
+    #if defined(ESP32)
+        // Whole burst goes through the SPI peripheral FIFO in one call
+        spi->transferBytes(nullptr, buffer, length);
+    #else
+        // In-place transfer: clock out dummy bytes, read back the FIFO
+        memset(buffer, 0, length);
+        spi->transfer(buffer, length);
+    #endif
+
+    deselect();
+
+    stats.bytes += 1 + length;
+
+    return length;
+}
+
+void SX1278Fifo::writePacket(const uint8_t* data, uint8_t length) {
+    select();
+    spi->transfer(REG_FIFO | SPI_WRITE_FLAG);
+
+    #if defined(ESP32)
+        spi->writeBytes(data, length);
+    #else
+        // transfer() overwrites its buffer, so the const source goes
+        // through a scratch copy, chunk by chunk in the same CS window
+        uint8_t chunk[WRITE_CHUNK_SIZE];
+        for (uint8_t offset = 0; offset < length;) {
+            uint8_t count = length - offset;
+            if (count > WRITE_CHUNK_SIZE) {
+                count = WRITE_CHUNK_SIZE;
+            }
+            memcpy(chunk, data + offset, count);
+            spi->transfer(chunk, count);
+            offset += count;
+        }
+    #endif
+
+    deselect();
+
+    stats.bytes += 1 + length;
+    stats.packets++;
+
+    writeRegister(REG_PAYLOAD_LENGTH, length);
+}
+
+uint8_t SX1278Fifo::seekRxPacket() {
+    writeRegister(REG_FIFO_ADDR_PTR, readRegister(REG_FIFO_RX_CURRENT_ADDR));
+    return readRegister(REG_RX_NB_BYTES);
+}
+
+uint16_t SX1278Fifo::rxPacketCount() {
+    // MSB and LSB in one burst (the register address auto-increments)
+    select();
+    spi->transfer(REG_RX_PACKET_CNT_MSB & ~SPI_WRITE_FLAG);
+    uint8_t msb = spi->transfer(0x00);
+    uint8_t lsb = spi->transfer(0x00);
+    deselect();
+
+    stats.bytes += 3;
+    return ((uint16_t)msb << 8) | lsb;
+}
+
+// ===== Interrupt Sources =====
+
+uint8_t SX1278Fifo::takeIrqFlags(uint8_t mask) {
+    uint8_t flags = readRegister(REG_IRQ_FLAGS) & mask;
+    if (flags != 0) {
+        writeRegister(REG_IRQ_FLAGS, flags);
+    }
+    return flags;
+}
+
+void SX1278Fifo::mapDio0(uint8_t function) {
+    writeRegister(REG_DIO_MAPPING_1, function);
+}
+
+// ===== Channel Activity Detection =====
+
+bool SX1278Fifo::signalDetected() {
+    return (readRegister(REG_MODEM_STAT) & MODEM_STAT_SIGNAL) != 0;
+}
+
+void SX1278Fifo::startCad() {
+    // CAD starts from standby; clear only the CAD flags so a pending
+    // RxDone/TxDone is left for the DIO0 handler
+    writeRegister(REG_OP_MODE, MODE_LONG_RANGE | MODE_STDBY);
+    writeRegister(REG_IRQ_FLAGS, SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED);
+    writeRegister(REG_OP_MODE, MODE_LONG_RANGE | MODE_CAD);
+}
+
+// ===== Register Access =====
+
+uint8_t SX1278Fifo::readRegister(uint8_t address) {
+    select();
+    spi->transfer(address & ~SPI_WRITE_FLAG);
+    uint8_t value = spi->transfer(0x00);
+    deselect();
+
+    stats.bytes += 2;
+    return value;
+}
+
+void SX1278Fifo::writeRegister(uint8_t address, uint8_t value) {
+    select();
+    spi->transfer(address | SPI_WRITE_FLAG);
+    spi->transfer(value);
+    deselect();
+
+    stats.bytes += 2;
+}
+
+// ===== Statistics =====
+
+const SpiStats& SX1278Fifo::getStats() {
+    return stats;
+}
+
+void SX1278Fifo::resetStats() {
+    stats.transactions = 0;
+    stats.bytes = 0;
+    stats.packets = 0;
+}
@@ -0,0 +1,129 @@
+#include "SendSchedule.h"
+
+SendSchedule::SendSchedule(unsigned long periodMs)
+    : period(periodMs), cycleStart(0), started(false), slotted(false), phase(0), synced(false), address(MSG_ADDR_NONE), airtimeMs(0), rng(1) {
+}
+
+void SendSchedule::begin(const char* nodeName) {
+    // FNV-1a over the name, mixed with the boot time
+    uint32_t hash = 2166136261UL;
+    while (*nodeName != '\0') {
+        hash = (hash ^ (uint8_t)*nodeName++) * 16777619UL;
+    }
+    rng = hash ^ micros();
+    if (rng == 0) {
+        rng = 1;
+    }
+}
+
+void SendSchedule::setAddress(uint8_t newAddress) {
+    address = newAddress;
+}
+
+void SendSchedule::recordAirtime(uint32_t airtimeUs) {
+    uint32_t ms = (airtimeUs + 999) / 1000;
+    if (ms > airtimeMs) {
+        airtimeMs = ms;
+    }
+}
+
+bool SendSchedule::sync(unsigned long periodStart, unsigned long periodMs) {
+    if (periodMs != period) {
+        return false;
+    }
+    phase = periodStart % period;
+    synced = true;
+    return true;
+}
+
+uint32_t SendSchedule::nextRandom(uint32_t range) {
+    // xorshift32: own sequence, independent of random() reseeding elsewhere
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return range > 0 ? rng % range : 0;
+}
+
+unsigned long SendSchedule::slotLength() {
+    return airtimeMs + SEND_SLOT_GUARD_MS;
+}
+
+uint8_t SendSchedule::getSlotCount() {
+    if (!SEND_SLOTTED || address == MSG_ADDR_NONE || airtimeMs == 0) {
+        return 0;
+    }
+    // Slot 0 belongs to the beacon
+    unsigned long count = period / slotLength();
+    if (count < 2) {
+        return 0;
+    }
+    return count > 250 ? 250 : (uint8_t)count;
+}
+
+uint8_t SendSchedule::getSlot() {
+    uint8_t count = getSlotCount();
+    if (count == 0) {
+        return SEND_NO_SLOT;
+    }
+    return (uint8_t)(1 + (address - MSG_ADDR_FIRST_NODE) % (count - 1));
+}
+
+unsigned long SendSchedule::next() {
+    unsigned long now = millis();
+
+    uint8_t slot = getSlot();
+    if (slot != SEND_NO_SLOT) {
+        // Periods aligned to the last beacon (or the local clock, so
+        // nodes started together still share slot boundaries). One send
+        // per period, even if a beacon or a new address moved the slot
+        // later after this period's send.
+        unsigned long base = now - ((now - phase) % period);
+        if (slotted && (long)(base - cycleStart) < (long)(period / 2)) {
+            base += period;
+        }
+        if ((long)(base + slot * slotLength() - now) <= 0) {
+            base += period;
+        }
+        slotted = true;
+        started = false;
+        cycleStart = base;
+        return base + slot * slotLength() - now;
+    }
+
+    // Random phase for the first period, then one period per send
+    if (!started) {
+        started = true;
+        slotted = false;
+        cycleStart = now + nextRandom(period);
+    } else {
+        cycleStart += period;
+        if ((long)(now - cycleStart) >= (long)period) {
+            // Fell more than a period behind: restart the grid
+            cycleStart = now;
+        }
+    }
+
+    unsigned long target = cycleStart + nextRandom(SEND_JITTER_MS + 1);
+    return (long)(target - now) > 0 ? target - now : 0;
+}
+
+void SendSchedule::printStats() {
+    uint8_t slot = getSlot();
+    Serial.print(F("Send schedule: every "));
+    Serial.print(period);
+    if (slot != SEND_NO_SLOT) {
+        Serial.print(F(" ms, slot "));
+        Serial.print(slot);
+        Serial.print(F("/"));
+        Serial.print(getSlotCount());
+        Serial.print(F(" ("));
+        Serial.print(slotLength());
+        Serial.print(F(" ms, "));
+        Serial.print(synced ? F("beacon") : F("local clock"));
+        Serial.println(F(")"));
+    } else {
+        Serial.print(F(" ms, jitter up to "));
+        Serial.print((unsigned long)SEND_JITTER_MS);
+        Serial.println(F(" ms"));
+    }
+}
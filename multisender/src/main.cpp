@@ -2,16 +2,26 @@
 #include "DualLoRaComm.h"
 #include "MessageProtocol.h"
 #include "DummySensors.h"
+#include "Scheduler.h"
+#include "TxQueue.h"
+#include "SendSchedule.h"
+#include "ChannelHopper.h"
 #include "board_config.h"
 
 // ===== Global Objects =====
 DualLoRaComm dualLora;
 MessageProtocol protocol;
 DummySensors sensors;
+Scheduler scheduler;
+
+// Frames for both modules, tagged with the module that sends them
+TxQueue txQueue;
 
 // ===== Configuration =====
 const unsigned long SEND_INTERVAL = 5000;  // Send every 5 seconds
-unsigned long lastSendTime = 0;
+SendSchedule sendSchedule(SEND_INTERVAL);  // Jitter or address slot within each interval
+uint8_t sendTask = SCHEDULER_NO_TASK;
+ChannelHopper hopper;  // Uplink channel per period (HOP_ENABLED), clock from the beacon
 
 // ===== Module/Sensor State =====
 // Alternate between modules and rotate through sensors
@@ -28,8 +38,28 @@ struct Statistics {
 
 Statistics stats = {0, 0, 0, 0};
 
+// ===== Snapshot =====
+// Sensors included in each MSG_SENSOR_BATCH frame
+const uint8_t SNAPSHOT_SENSORS[] = {SENSOR_TEMPERATURE, SENSOR_HUMIDITY, SENSOR_BATTERY, SENSOR_PRESSURE};
+const uint8_t SNAPSHOT_COUNT = sizeof(SNAPSHOT_SENSORS);
+
+// ===== Join State =====
+// Short address per module, assigned by the receiver's MSG_JOIN_ACCEPT
+uint8_t shortAddrs[NUM_LORA_MODULES] = {MSG_ADDR_NONE, MSG_ADDR_NONE};
+uint8_t joinTask = SCHEDULER_NO_TASK;  // Retries join requests for unjoined modules
+
 // ===== Buffer =====
-uint8_t txBuffer[MSG_MAX_PACKET_SIZE];
+uint8_t rxBuffer[MSG_MAX_PACKET_SIZE];
+
+// ===== Function Prototypes =====
+void sendSensorData();
+void sendJoinRequests();
+bool sendSnapshot(const char* deviceName);
+bool sendNextSensor(const char* deviceName);
+void sendJoinRequest(uint8_t module);
+void selectAddress(uint8_t module);
+void checkJoinReplies();
+unsigned long pumpTxQueue();
 
 void setup() {
     // Initialize Serial
@@ -63,6 +93,10 @@ void setup() {
     // Print configuration
     dualLora.printConfig();
 
+    // A module finishing its transmission ends the idle sleep in loop()
+    scheduler.wakeOn(dualLora.getEventFlag(MODULE_1));
+    scheduler.wakeOn(dualLora.getEventFlag(MODULE_2));
+
     // Initialize sensors
     sensors.begin();
     Serial.println(F("Dummy sensors initialized"));
@@ -75,125 +109,343 @@ void setup() {
     Serial.println(F("=========================================="));
     Serial.println(F("Sending sensor data every 5 seconds..."));
     Serial.println(F("Alternating: Module1 -> Module2 -> Module1..."));
-    Serial.println(F("Rotating: Temp -> Humid -> Bat -> Pressure"));
+    sendSchedule.printStats();
+    hopper.printStats();
+    if (SEND_SNAPSHOT) {
+        Serial.println(F("Snapshot: Temp + Humid + Bat + Pressure per packet"));
+    } else {
+        Serial.println(F("Rotating: Temp -> Humid -> Bat -> Pressure"));
+    }
     Serial.println(F("=========================================="));
     Serial.println();
+
+    // Short addresses: ask now, then retry until the receiver assigns them
+    joinTask = scheduler.every(JOIN_RETRY_INTERVAL_MS, sendJoinRequests, true);
+
+    // Not on a fixed grid from boot: nodes powered up together would
+    // collide on every send
+    sendSchedule.begin(LORA1_NAME);
+    sendTask = scheduler.after(sendSchedule.next(), sendSensorData);
+
+    // Join replies are polled: the modules have no RX interrupt path
+    scheduler.every(RX_POLL_INTERVAL_MS, checkJoinReplies);
 }
 
 void loop() {
-    unsigned long currentTime = millis();
-
-    // Send sensor data at interval
-    if (currentTime - lastSendTime >= SEND_INTERVAL) {
-        lastSendTime = currentTime;
-
-        // Get current module's device name
-        const char* deviceName = dualLora.getDeviceName(currentModule);
-
-        // Read sensor data
-        float value;
-        const char* unit;
-        const char* sensorName;
-
-        switch (currentSensor) {
-            case SENSOR_TEMPERATURE:
-                value = sensors.readTemperature();
-                unit = sensors.getSensorUnit(SENSOR_TEMPERATURE);
-                sensorName = sensors.getSensorName(SENSOR_TEMPERATURE);
-                break;
-            case SENSOR_HUMIDITY:
-                value = sensors.readHumidity();
-                unit = sensors.getSensorUnit(SENSOR_HUMIDITY);
-                sensorName = sensors.getSensorName(SENSOR_HUMIDITY);
-                break;
-            case SENSOR_BATTERY:
-                value = sensors.readBatteryVoltage();
-                unit = sensors.getSensorUnit(SENSOR_BATTERY);
-                sensorName = sensors.getSensorName(SENSOR_BATTERY);
-                break;
-            case SENSOR_PRESSURE:
-                value = sensors.readPressure();
-                unit = sensors.getSensorUnit(SENSOR_PRESSURE);
-                sensorName = sensors.getSensorName(SENSOR_PRESSURE);
-                break;
-            default:
-                currentSensor = SENSOR_TEMPERATURE;
-                return;
+    scheduler.run();
+
+    // Hand queued frames to their modules while those are free
+    unsigned long txWait = pumpTxQueue();
+
+    // Idle until the next send, join retry, RX poll, TX done or airtime budget
+    scheduler.sleep(txWait > 0 ? txWait : SCHEDULER_FOREVER);
+}
+
+void sendSensorData() {
+    // Get current module's device name
+    const char* deviceName = dualLora.getDeviceName(currentModule);
+
+    // Send a full snapshot or the next sensor in the rotation
+    bool sent = SEND_SNAPSHOT ? sendSnapshot(deviceName) : sendNextSensor(deviceName);
+
+    if (sent) {
+        // Update statistics
+        if (currentModule == MODULE_1) {
+            stats.module1Sent++;
+        } else {
+            stats.module2Sent++;
         }
+    } else {
+        stats.totalFailed++;
+        Serial.print(F("[ERROR] Failed to send via "));
+        Serial.println(deviceName);
+    }
 
-        // Encode sensor response with device name
-        size_t len = protocol.encodeSensorResponseWithDevice(deviceName, currentSensor, value, unit, txBuffer);
+    // Alternate to next module
+    currentModule = (currentModule == MODULE_1) ? MODULE_2 : MODULE_1;
 
-        // Send via current module
-        if (len > 0 && dualLora.sendPacket(currentModule, txBuffer, len)) {
-            // Update statistics
-            if (currentModule == MODULE_1) {
-                stats.module1Sent++;
-            } else {
-                stats.module2Sent++;
-            }
+    // Slotted mode: the next send uses the slot of the module sending it
+    sendSchedule.setAddress(shortAddrs[currentModule]);
+    scheduler.reschedule(sendTask, sendSchedule.next());
 
-            // Print transmission info
-            Serial.print(F("[TX] ["));
-            Serial.print(deviceName);
-            Serial.print(F("] "));
-            Serial.print(sensorName);
+    // Print statistics every 20 messages
+    unsigned long totalSent = stats.module1Sent + stats.module2Sent;
+    if (totalSent > 0 && totalSent % 20 == 0) {
+        Serial.println();
+        Serial.println(F("--- Statistics ---"));
+        Serial.print(F("Module 1 ("));
+        Serial.print(dualLora.getDeviceName(MODULE_1));
+        Serial.print(F("): "));
+        Serial.println(stats.module1Sent);
+        Serial.print(F("Module 2 ("));
+        Serial.print(dualLora.getDeviceName(MODULE_2));
+        Serial.print(F("): "));
+        Serial.println(stats.module2Sent);
+        Serial.print(F("Total sent: "));
+        Serial.println(totalSent);
+        Serial.print(F("Failed: "));
+        Serial.println(stats.totalFailed);
+        txQueue.printStats();
+        sendSchedule.printStats();
+        hopper.printStats();
+        for (uint8_t m = MODULE_1; m <= MODULE_2; m++) {
+            const SpiStats& spi = dualLora.getSpiStats(m);
+            Serial.print(F("SPI module "));
+            Serial.print(m + 1);
             Serial.print(F(": "));
-            Serial.print(value, 2);
+            Serial.print(spi.transactions);
+            Serial.print(F(" transactions, "));
+            Serial.print(spi.bytes);
+            Serial.print(F(" bytes, "));
+            Serial.print(spi.packets);
+            Serial.println(F(" packets"));
+            Serial.print(F("Module "));
+            Serial.print(m + 1);
             Serial.print(F(" "));
-            Serial.print(unit);
-            Serial.print(F(" ("));
-            Serial.print(len);
-            Serial.println(F(" bytes)"));
-        } else {
+            dualLora.getDutyCycle(m).printStats();
+            Serial.print(F("Module "));
+            Serial.print(m + 1);
+            Serial.print(F(" "));
+            dualLora.getListenBeforeTalk(m).printStats();
+        }
+        Serial.print(F("Uptime: "));
+        Serial.print((millis() - stats.startTime) / 1000);
+        Serial.println(F(" seconds"));
+        Serial.println(F("------------------"));
+        Serial.println();
+    }
+}
+
+bool sendSnapshot(const char* deviceName) {
+    // Read every sensor into one batch behind a single device name
+    SensorReading readings[SNAPSHOT_COUNT];
+    for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+        readings[i].sensorId = SNAPSHOT_SENSORS[i];
+        readings[i].value = sensors.readSensorById(SNAPSHOT_SENSORS[i]);
+    }
+
+    // Header addresses follow the module sending this frame
+    selectAddress(currentModule);
+
+    // Encoded straight into the TX queue; stale once the next reading is due
+    uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+    size_t len = 0;
+    if (frame != nullptr && shortAddrs[currentModule] != MSG_ADDR_NONE) {
+        len = protocol.encodeSensorBatch(shortAddrs[currentModule], readings, SNAPSHOT_COUNT, frame);
+    } else if (frame != nullptr) {
+        len = protocol.encodeSensorBatch(deviceName, readings, SNAPSHOT_COUNT, frame);
+    }
+
+    // Queue for the current module
+    if (!txQueue.commit(len, SEND_INTERVAL, currentModule)) {
+        return false;
+    }
+    sendSchedule.recordAirtime(dualLora.getAirtimeUs(len));
+
+    // Print transmission info
+    Serial.print(F("[TX] ["));
+    Serial.print(deviceName);
+    Serial.print(F("] Snapshot:"));
+    for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+        Serial.print(F(" "));
+        Serial.print(sensors.getSensorName(readings[i].sensorId));
+        Serial.print(F(" "));
+        Serial.print(readings[i].value, 2);
+        Serial.print(F(" "));
+        Serial.print(sensors.getSensorUnit(readings[i].sensorId));
+        if (i + 1 < SNAPSHOT_COUNT) {
+            Serial.print(F(","));
+        }
+    }
+    Serial.print(F(" ("));
+    Serial.print(len);
+    Serial.println(F(" bytes)"));
+
+    return true;
+}
+
+bool sendNextSensor(const char* deviceName) {
+    uint8_t sensorToSend = currentSensor;
+
+    // Rotate to next sensor
+    switch (currentSensor) {
+        case SENSOR_TEMPERATURE:
+            currentSensor = SENSOR_HUMIDITY;
+            break;
+        case SENSOR_HUMIDITY:
+            currentSensor = SENSOR_BATTERY;
+            break;
+        case SENSOR_BATTERY:
+            currentSensor = SENSOR_PRESSURE;
+            break;
+        default:
+            currentSensor = SENSOR_TEMPERATURE;
+            break;
+    }
+
+    // Read sensor data
+    float value = sensors.readSensorById(sensorToSend);
+    const char* unit = sensors.getSensorUnit(sensorToSend);
+    const char* sensorName = sensors.getSensorName(sensorToSend);
+
+    // Encode compact sensor reading with short address or device name
+    // Header addresses follow the module sending this frame
+    selectAddress(currentModule);
+
+    uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+    size_t len = 0;
+    if (frame != nullptr && shortAddrs[currentModule] != MSG_ADDR_NONE) {
+        len = protocol.encodeSensorCompact(shortAddrs[currentModule], sensorToSend, value, frame);
+    } else if (frame != nullptr) {
+        len = protocol.encodeSensorCompact(deviceName, sensorToSend, value, frame);
+    }
+
+    // Queue for the current module
+    if (!txQueue.commit(len, SEND_INTERVAL, currentModule)) {
+        return false;
+    }
+    sendSchedule.recordAirtime(dualLora.getAirtimeUs(len));
+
+    // Print transmission info
+    Serial.print(F("[TX] ["));
+    Serial.print(deviceName);
+    Serial.print(F("] "));
+    Serial.print(sensorName);
+    Serial.print(F(": "));
+    Serial.print(value, 2);
+    Serial.print(F(" "));
+    Serial.print(unit);
+    Serial.print(F(" ("));
+    Serial.print(len);
+    Serial.println(F(" bytes)"));
+
+    return true;
+}
+
+void sendJoinRequests() {
+    for (uint8_t m = MODULE_1; m <= MODULE_2; m++) {
+        if (shortAddrs[m] == MSG_ADDR_NONE) {
+            sendJoinRequest(m);
+        }
+    }
+}
+
+void sendJoinRequest(uint8_t module) {
+    const char* deviceName = dualLora.getDeviceName(module);
+    selectAddress(module);
+
+    // Control class: goes out ahead of any queued telemetry
+    uint8_t* frame = txQueue.reserve(TX_CLASS_CONTROL);
+    size_t len = (frame != nullptr) ? protocol.encodeJoinRequest(deviceName, frame) : 0;
+
+    Serial.print(F("[JOIN] ["));
+    Serial.print(deviceName);
+    if (txQueue.commit(len, TX_TTL_NONE, module)) {
+        Serial.println(F("] Requesting short address"));
+    } else {
+        Serial.println(F("] Failed to queue join request"));
+    }
+}
+
+unsigned long pumpTxQueue() {
+    // Most urgent frame first; stop when its module is still on air
+    const TxEntry* entry;
+    while ((entry = txQueue.peek()) != nullptr && !dualLora.isTransmitting(entry->tag)) {
+        // Module over its duty-cycle budget: the frame waits in the queue
+        unsigned long wait = dualLora.getTxDelay(entry->tag, entry->length);
+        if (wait > 0) {
+            return wait;
+        }
+
+        // Frequency hopping: uplink on this period's channel, never across a hop
+        if (HOP_ENABLED) {
+            wait = hopper.getTxDelay(dualLora.getAirtimeUs(entry->length));
+            if (wait > 0) {
+                return wait;
+            }
+            dualLora.setTxFrequency(entry->tag, ChannelHopper::getFrequency(hopper.getChannel(millis())));
+        }
+
+        // Listen before talk: back off while the channel is in use
+        wait = dualLora.checkChannel(entry->tag, entry->length);
+        if (wait == LBT_GIVE_UP) {
+            stats.totalFailed++;
+            Serial.print(F("[ERROR] Channel busy, dropped packet for "));
+            Serial.println(dualLora.getDeviceName(entry->tag));
+            txQueue.pop();
+            continue;
+        }
+        if (wait > 0) {
+            return wait;
+        }
+
+        if (!dualLora.sendPacketAsync(entry->tag, entry->frame, entry->length)) {
             stats.totalFailed++;
             Serial.print(F("[ERROR] Failed to send via "));
-            Serial.println(deviceName);
+            Serial.println(dualLora.getDeviceName(entry->tag));
         }
+        txQueue.pop();
+    }
+    return 0;
+}
 
-        // Rotate to next sensor
-        switch (currentSensor) {
-            case SENSOR_TEMPERATURE:
-                currentSensor = SENSOR_HUMIDITY;
-                break;
-            case SENSOR_HUMIDITY:
-                currentSensor = SENSOR_BATTERY;
-                break;
-            case SENSOR_BATTERY:
-                currentSensor = SENSOR_PRESSURE;
-                break;
-            case SENSOR_PRESSURE:
-                currentSensor = SENSOR_TEMPERATURE;
-                break;
+void checkJoinReplies() {
+    // Both modules share the channel, so either may hear a reply for the other
+    for (uint8_t rx = MODULE_1; rx <= MODULE_2; rx++) {
+        int len = dualLora.receivePacket(rx, rxBuffer, sizeof(rxBuffer));
+        if (len <= 0) {
+            continue;
         }
 
-        // Alternate to next module
-        currentModule = (currentModule == MODULE_1) ? MODULE_2 : MODULE_1;
-
-        // Print statistics every 20 messages
-        unsigned long totalSent = stats.module1Sent + stats.module2Sent;
-        if (totalSent > 0 && totalSent % 20 == 0) {
-            Serial.println();
-            Serial.println(F("--- Statistics ---"));
-            Serial.print(F("Module 1 ("));
-            Serial.print(dualLora.getDeviceName(MODULE_1));
-            Serial.print(F("): "));
-            Serial.println(stats.module1Sent);
-            Serial.print(F("Module 2 ("));
-            Serial.print(dualLora.getDeviceName(MODULE_2));
-            Serial.print(F("): "));
-            Serial.println(stats.module2Sent);
-            Serial.print(F("Total sent: "));
-            Serial.println(totalSent);
-            Serial.print(F("Failed: "));
-            Serial.println(stats.totalFailed);
-            Serial.print(F("Uptime: "));
-            Serial.print((millis() - stats.startTime) / 1000);
-            Serial.println(F(" seconds"));
-            Serial.println(F("------------------"));
-            Serial.println();
+        MessageView message;
+        JoinInfo join;
+        BeaconInfo beacon;
+        if (!protocol.decodeView(rxBuffer, len, message)) {
+            continue;
+        }
+
+        // The beacon went on air offsetMs into the receiver's period (polled,
+        // so up to RX_POLL_INTERVAL_MS late; the slot and hop guards absorb it)
+        if (protocol.parseBeacon(message, beacon)) {
+            unsigned long periodStart = millis() - dualLora.getAirtimeUs(len) / 1000 - beacon.offsetMs;
+            bool wasSynced = hopper.isSynced();
+            sendSchedule.sync(periodStart, beacon.periodMs);
+            hopper.sync(periodStart, beacon.periodMs, beacon.hop, beacon.blacklist);
+            if (HOP_ENABLED && !wasSynced) {
+                hopper.printStats();
+            }
+            continue;
+        }
+
+        if (!protocol.parseJoin(message, join)) {
+            continue;
+        }
+
+        for (uint8_t m = MODULE_1; m <= MODULE_2; m++) {
+            if (message.type() == MSG_JOIN_ACCEPT &&
+                strncmp(join.deviceName, dualLora.getDeviceName(m), sizeof(join.deviceName) - 1) == 0) {
+                if (shortAddrs[m] != join.address) {
+                    shortAddrs[m] = join.address;
+                    Serial.print(F("[JOIN] ["));
+                    Serial.print(dualLora.getDeviceName(m));
+                    Serial.print(F("] Joined as 0x"));
+                    Serial.println(join.address, HEX);
+                }
+            } else if (message.type() == MSG_JOIN_REJOIN && shortAddrs[m] != MSG_ADDR_NONE &&
+                       join.address == shortAddrs[m]) {
+                // Receiver lost this address: send the name inline until rejoined
+                shortAddrs[m] = MSG_ADDR_NONE;
+                scheduler.reschedule(joinTask, 0);
+                Serial.print(F("[JOIN] ["));
+                Serial.print(dualLora.getDeviceName(m));
+                Serial.println(F("] Receiver requested rejoin"));
+            }
         }
     }
+}
 
-    delay(10);
+void selectAddress(uint8_t module) {
+    // Joined modules send addressed frames to the receiver, others unaddressed
+    protocol.setLocalAddress(shortAddrs[module]);
+    protocol.setDestination(shortAddrs[module] != MSG_ADDR_NONE ? MSG_ADDR_GATEWAY : MSG_ADDR_BROADCAST);
 }
@@ -36,6 +36,61 @@
 #define LORA_SYNC_WORD 0x12             // Private network sync word
 #define LORA_TX_POWER 17                // TX power in dBm (2-20)
 
+// Duty cycle: share of airtime the radio may use, per mille, averaged over
+// DUTY_CYCLE_WINDOW_S (EU 433 MHz SRD band: 10%). Frames over the budget wait.
+#define DUTY_CYCLE_PERMILLE 100
+#define DUTY_CYCLE_WINDOW_S 3600
+
+// Listen before talk: CAD before each transmission, random backoff while
+// the channel is busy, frame dropped after LBT_MAX_WAIT_MS of busy channel
+#define LBT_ENABLED 1
+#define LBT_MAX_WAIT_MS 2000
+
+// RX ring buffer (packets held between the DIO0 ISR and loop())
+#ifdef BOARD_ARDUINO_UNO
+    #define LORA_RX_RING_SLOTS 2        // 2KB RAM: keep the ring small
+#else
+    #define LORA_RX_RING_SLOTS 8
+#endif
+
+// Short address registry (nodes joined through MSG_JOIN_REQUEST)
+#ifdef BOARD_ARDUINO_UNO
+    #define NODE_REGISTRY_SIZE 4        // 36 bytes per node
+#else
+    #define NODE_REGISTRY_SIZE 32
+#endif
+
+// Duplicate filter (recent message IDs per joined node)
+#ifdef BOARD_ARDUINO_UNO
+    #define DUP_CACHE_PEERS 4           // 16 bytes per node
+#else
+    #define DUP_CACHE_PEERS 32
+#endif
+
+// TX priority queue (join replies waiting for the radio)
+#ifdef BOARD_ARDUINO_UNO
+    #define TX_QUEUE_SLOTS 2
+#else
+    #define TX_QUEUE_SLOTS 8
+#endif
+#define TX_QUEUE_FRAME_SIZE (MSG_MAX_HEADER_SIZE + 33 + MSG_MAX_TRAILER_SIZE)  // Join accept: address + device name
+
+// Slot beacon: MSG_BEACON every SLOT_BEACON_INTERVAL_MS (0 = off) carries
+// the SLOT_PERIOD_MS period clock to senders built with SEND_SLOTTED
+#ifndef SLOT_BEACON_INTERVAL_MS
+    #define SLOT_BEACON_INTERVAL_MS 0
+#endif
+#ifndef SLOT_PERIOD_MS
+    #define SLOT_PERIOD_MS 5000         // Senders' SEND_INTERVAL
+#endif
+
+// Uplink frequency hopping: listen on a new HOP_CHANNEL_PLAN channel each
+// SLOT_PERIOD_MS (see ChannelHopper.h), blacklisting channels that lose
+// frames. Replies and beacons stay on LORA_FREQUENCY. Needs the beacon.
+#ifndef HOP_ENABLED
+    #define HOP_ENABLED 0
+#endif
+
 // Serial Configuration
 #define SERIAL_BAUD 9600
 
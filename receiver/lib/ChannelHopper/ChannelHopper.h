@@ -0,0 +1,127 @@
+#ifndef CHANNEL_HOPPER_H
+#define CHANNEL_HOPPER_H
+
+#include <Arduino.h>
+#include "board_config.h"
+
+// Uplink frequency hopping (needs the receiver's slot beacon)
+#ifndef HOP_ENABLED
+    #define HOP_ENABLED 0
+#endif
+
+// Uplink channels (Hz), 125 kHz wide with 200 kHz spacing inside the
+// 433.05-434.79 MHz band. LORA_FREQUENCY stays the downlink channel.
+#ifndef HOP_CHANNEL_PLAN
+    #define HOP_CHANNEL_PLAN {433175000L, 433375000L, 433575000L, 433775000L, \
+                              433975000L, 434175000L, 434375000L, 434575000L}
+#endif
+
+// Network key of the hop sequence (same on every node and the receiver)
+#ifndef HOP_SEED
+    #define HOP_SEED 0x4C52
+#endif
+
+// No frame starts or ends closer than this to a hop (ms)
+#ifndef HOP_GUARD_MS
+    #define HOP_GUARD_MS 50
+#endif
+
+// A node that has not heard a beacon for this long stops hopping (ms)
+#ifndef HOP_SYNC_TIMEOUT_MS
+    #define HOP_SYNC_TIMEOUT_MS 300000UL
+#endif
+
+// Blacklisting (receiver): a channel that delivers HOP_BLACKLIST_LOSS
+// percent fewer frames per hop than the others, over at least
+// HOP_MIN_VISITS hops, is skipped for HOP_BLACKLIST_MS. At least
+// HOP_MIN_CHANNELS always stay in use.
+#ifndef HOP_MIN_VISITS
+    #define HOP_MIN_VISITS 8
+#endif
+#ifndef HOP_BLACKLIST_LOSS
+    #define HOP_BLACKLIST_LOSS 50
+#endif
+#ifndef HOP_BLACKLIST_MS
+    #define HOP_BLACKLIST_MS 600000UL
+#endif
+#ifndef HOP_MIN_CHANNELS
+    #define HOP_MIN_CHANNELS 2
+#endif
+
+// Blacklist is a 16-bit channel mask
+#define HOP_MAX_CHANNELS 16
+
+// Reception quality of one channel (receiver side)
+struct ChannelQuality {
+    uint16_t visits;            // Hops spent listening on it
+    uint16_t frames;            // Frames per hop, EWMA x16
+    uint32_t received;          // Frames since boot
+    unsigned long blacklistedAt;
+};
+
+// Pseudo-random uplink hopping across a channel plan.
+//
+// Time is cut into hops of one send period; the receiver's beacon tells
+// where the current hop started and its number. Every run of N hops
+// visits each of the N channels once, in an order derived from HOP_SEED
+// and the run number, so load spreads evenly and nodes and receiver
+// agree on the channel without exchanging it. Blacklisted channels are
+// replaced by the next usable one.
+//
+// The receiver listens on the hop channel and tracks frames per hop on
+// each channel; one that falls well behind the others is blacklisted.
+// A new blacklist takes effect with the next beacon, which carries it
+// to the nodes.
+class ChannelHopper {
+public:
+    ChannelHopper();
+
+    // Channels in the plan and their frequencies (Hz)
+    static uint8_t getChannelCount();
+    static long getFrequency(uint8_t channel);
+
+    // A hop with this number started at periodStart (millis()); the
+    // blacklist given applies from now on
+    void sync(unsigned long periodStart, unsigned long periodMs, uint16_t hop, uint16_t blacklist);
+
+    // Beacon heard within HOP_SYNC_TIMEOUT_MS
+    bool isSynced();
+
+    // Hop number, ms into the hop and channel at a given millis()
+    uint16_t getHop(unsigned long now);
+    unsigned long getHopOffset(unsigned long now);
+    uint8_t getChannel(unsigned long now);
+
+    // ms until a frame with this airtime may start on the current hop's
+    // channel without crossing a hop, 0 if now. HOP_SYNC_TIMEOUT_MS while
+    // not synced (the next beacon ends the wait).
+    unsigned long getTxDelay(uint32_t airtimeUs);
+
+    // Receiver: frames heard during one hop on a channel
+    void recordVisit(uint8_t channel, uint16_t frames);
+
+    // Blacklist in use, and the one the next beacon will carry
+    uint16_t getBlacklist();
+    uint16_t getNextBlacklist();
+
+    // Print hop state (and channel quality on the receiver)
+    void printStats();
+
+private:
+    bool synced;
+    unsigned long syncStart;    // Start of hop syncHop
+    unsigned long lastSync;
+    unsigned long period;
+    uint16_t syncHop;
+    uint16_t blacklist;
+    uint16_t nextBlacklist;
+    ChannelQuality quality[HOP_MAX_CHANNELS];
+
+    // Channel of a hop before the blacklist is applied
+    uint8_t sequence(uint16_t hop);
+
+    // Update nextBlacklist from channel quality
+    void evaluate();
+};
+
+#endif // CHANNEL_HOPPER_H
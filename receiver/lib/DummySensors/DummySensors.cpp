@@ -1,5 +1,5 @@
 #include "DummySensors.h"
-#include "MessageProtocol.h"  // For sensor ID constants
+#include "MessageProtocol.h"  // For sensor IDs and the sensor dictionary
 
 DummySensors::DummySensors() {
     // Initialize base values
@@ -72,21 +72,12 @@ float DummySensors::readSensorById(uint8_t sensorId) {
 }
 
 const char* DummySensors::getSensorName(uint8_t sensorId) {
-    switch (sensorId) {
-        case SENSOR_TEMPERATURE: return "Temperature";
-        case SENSOR_HUMIDITY: return "Humidity";
-        case SENSOR_BATTERY: return "Battery";
-        case SENSOR_PRESSURE: return "Pressure";
-        default: return "Unknown";
-    }
+    const SensorInfo* info = MessageProtocol::getSensorInfo(sensorId);
+    return (info != nullptr) ? info->name : "Unknown";
 }
 
 const char* DummySensors::getSensorUnit(uint8_t sensorId) {
-    switch (sensorId) {
-        case SENSOR_TEMPERATURE: return "°C";
-        case SENSOR_HUMIDITY: return "%";
-        case SENSOR_BATTERY: return "V";
-        case SENSOR_PRESSURE: return "hPa";
-        default: return "";
-    }
+    // Same dictionary the compact sensor encoding uses
+    const SensorInfo* info = MessageProtocol::getSensorInfo(sensorId);
+    return (info != nullptr) ? info->unit : "";
 }
@@ -0,0 +1,63 @@
+#ifndef DUPLICATE_CACHE_H
+#define DUPLICATE_CACHE_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Number of peers tracked at once (least recently heard peer is replaced)
+#ifndef DUP_CACHE_PEERS
+    #define DUP_CACHE_PEERS 8
+#endif
+
+// Message IDs remembered per peer, below its newest one
+#define DUP_CACHE_WINDOW 32
+
+// Recent message IDs from one peer
+struct DupPeer {
+    uint8_t address;         // MSG_ADDR_NONE if the slot is free
+    uint16_t newest;         // Highest message ID seen
+    uint32_t seen;           // Bit i: newest - i seen
+    uint16_t requestId;      // Request answered by responseId
+    uint16_t responseId;     // Message ID of our reply, 0 if none cached
+    unsigned long lastHeard; // millis() of the last frame
+};
+
+// Per-peer duplicate filter for retransmitted frames.
+// Each peer has a sliding bitmap under its newest ID (O(1) per check),
+// plus the ID of the reply sent to its latest request so a duplicate
+// can be answered from the cached reply instead of re-running the handler.
+class DuplicateCache {
+public:
+    DuplicateCache();
+
+    // Record a message ID from a peer. True if it was seen before.
+    // Frames without a source address (MSG_ADDR_NONE) or unsequenced (ID 0:
+    // streamed readings, polls) are never duplicates.
+    bool check(uint8_t address, uint16_t messageId);
+
+    // Remember our reply to a peer's request
+    void setResponse(uint8_t address, uint16_t requestId, uint16_t responseId);
+
+    // Reply sent for a request, 0 if none is cached
+    uint16_t getResponse(uint8_t address, uint16_t requestId);
+
+    // Drop everything known about a peer (it rebooted or re-joined:
+    // its IDs start over and cached replies no longer apply)
+    void forget(uint8_t address);
+
+    // Number of duplicates detected
+    uint32_t getHits();
+
+private:
+    DupPeer peers[DUP_CACHE_PEERS];
+    uint32_t hits;
+
+    // Slot for a peer, claiming the least recently heard one if new
+    DupPeer& peerFor(uint8_t address);
+
+    // Slot for a known peer, nullptr if not tracked
+    DupPeer* find(uint8_t address);
+};
+
+#endif // DUPLICATE_CACHE_H
@@ -0,0 +1,117 @@
+#ifndef DUTY_CYCLE_H
+#define DUTY_CYCLE_H
+
+#include <Arduino.h>
+#include "board_config.h"
+
+// Share of airtime a radio may use, per mille (1000 = no limit).
+// EU 433 MHz SRD band: 10%; the 868 MHz sub-bands are mostly 1%.
+#ifndef DUTY_CYCLE_PERMILLE
+    #define DUTY_CYCLE_PERMILLE 100
+#endif
+
+// Period the duty cycle is averaged over; a full period's budget may be
+// spent in one burst (s)
+#ifndef DUTY_CYCLE_WINDOW_S
+    #define DUTY_CYCLE_WINDOW_S 3600
+#endif
+
+// Frame format as set up by the radio drivers: explicit header, payload CRC
+#ifndef LORA_IMPLICIT_HEADER
+    #define LORA_IMPLICIT_HEADER 0
+#endif
+#ifndef LORA_PAYLOAD_CRC
+    #define LORA_PAYLOAD_CRC 1
+#endif
+
+// Airtime budget of one window (us)
+#define DUTY_CYCLE_BUDGET_US ((uint32_t)DUTY_CYCLE_WINDOW_S * DUTY_CYCLE_PERMILLE * 1000UL)
+
+static_assert(DUTY_CYCLE_PERMILLE >= 1 && DUTY_CYCLE_PERMILLE <= 1000, "DUTY_CYCLE_PERMILLE must be 1-1000");
+static_assert((uint32_t)DUTY_CYCLE_WINDOW_S * DUTY_CYCLE_PERMILLE <= 4294967UL, "Duty cycle budget overflows 32 bits");
+
+// ===== Time on Air =====
+// Semtech AN1200.13. Everything is counted in quarter symbols (the
+// preamble is n + 4.25 symbols), so integer math stays exact at the
+// standard bandwidths and all of it folds at compile time.
+
+// Quarter of one symbol time (us)
+constexpr uint32_t loraQuarterSymbolUs(uint8_t sf, uint32_t bandwidth) {
+    return (uint32_t)((1UL << sf) * 250000UL / bandwidth);
+}
+
+// Low data rate optimization, as the LoRa library decides it: symbols
+// longer than 16 ms in its integer math (SF12 at 125 kHz, SF11 below)
+constexpr bool loraLowDataRateOptimize(uint8_t sf, uint32_t bandwidth) {
+    return 1000 / (bandwidth >> sf) > 16;
+}
+
+// Payload bits beyond what the 8 fixed payload symbols carry
+constexpr long loraPayloadBits(size_t length, uint8_t sf, bool crc, bool implicitHeader) {
+    return 8L * (long)length - 4L * sf + 28 + (crc ? 16 : 0) - (implicitHeader ? 20 : 0);
+}
+
+// Symbols after the preamble; codingRate is the denominator (5 = 4/5)
+constexpr uint16_t loraPayloadSymbols(size_t length, uint8_t sf, uint8_t codingRate,
+                                      bool crc, bool implicitHeader, bool ldro) {
+    return 8 + (loraPayloadBits(length, sf, crc, implicitHeader) <= 0 ? 0 :
+        (uint16_t)((loraPayloadBits(length, sf, crc, implicitHeader) + 4L * (sf - (ldro ? 2 : 0)) - 1) /
+                   (4L * (sf - (ldro ? 2 : 0)))) * codingRate);
+}
+
+// Time on air of one packet (us)
+constexpr uint32_t loraTimeOnAirUs(size_t length, uint8_t sf, uint32_t bandwidth, uint8_t codingRate,
+                                   uint16_t preamble, bool crc, bool implicitHeader, bool ldro) {
+    return (4UL * preamble + 17 + 4UL * loraPayloadSymbols(length, sf, codingRate, crc, implicitHeader, ldro)) *
+           loraQuarterSymbolUs(sf, bandwidth);
+}
+
+// Time on air of one packet with the board's radio settings (us)
+constexpr uint32_t loraTimeOnAirUs(size_t length) {
+    return loraTimeOnAirUs(length, LORA_SPREADING_FACTOR, (uint32_t)LORA_SIGNAL_BANDWIDTH, LORA_CODING_RATE,
+                           LORA_PREAMBLE_LENGTH, LORA_PAYLOAD_CRC, LORA_IMPLICIT_HEADER,
+                           loraLowDataRateOptimize(LORA_SPREADING_FACTOR, (uint32_t)LORA_SIGNAL_BANDWIDTH));
+}
+
+static_assert(loraTimeOnAirUs(255) <= DUTY_CYCLE_BUDGET_US, "Duty cycle budget smaller than one full frame");
+
+// ===== Duty-Cycle Regulator =====
+// Token bucket of airtime for one radio. It refills at DUTY_CYCLE_PERMILLE
+// of wall time up to DUTY_CYCLE_BUDGET_US; a frame may go once the bucket
+// covers its whole airtime, so the long-run share never exceeds the limit.
+class DutyCycle {
+public:
+    DutyCycle();
+
+    // ms until a frame with this airtime fits the budget, 0 if it does now
+    unsigned long getDelay(uint32_t airtimeUs);
+
+    // Charge a transmission. False, and nothing charged, if over budget.
+    bool consume(uint32_t airtimeUs);
+
+    // Airtime spent since boot (ms)
+    uint32_t getAirtimeMs();
+
+    // Budget left (ms of airtime)
+    uint32_t getAvailableMs();
+
+    // Times a waiting frame found the budget spent, frames refused
+    uint32_t getThrottled();
+    uint32_t getRejected();
+
+    // Print airtime and budget counters
+    void printStats();
+
+private:
+    uint32_t tokens;            // us of airtime
+    unsigned long lastRefill;
+    uint32_t airtimeMs;
+    uint16_t airtimeRemainderUs;
+    uint32_t throttled;
+    uint32_t rejected;
+    bool waiting;               // A frame is being held back
+
+    void refill();
+};
+
+#endif // DUTY_CYCLE_H
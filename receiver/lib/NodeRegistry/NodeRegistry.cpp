@@ -0,0 +1,90 @@
+#include "NodeRegistry.h"
+
+NodeRegistry::NodeRegistry() {
+    for (uint8_t i = 0; i < NODE_REGISTRY_SIZE; i++) {
+        entries[i].deviceName[0] = '\0';
+        entries[i].lastSeen = 0;
+    }
+}
+
+uint8_t NodeRegistry::join(const char* deviceName) {
+    int freeSlot = -1;
+    int oldestSlot = 0;
+
+    for (uint8_t i = 0; i < NODE_REGISTRY_SIZE; i++) {
+        if (entries[i].deviceName[0] == '\0') {
+            if (freeSlot < 0) {
+                freeSlot = i;
+            }
+            continue;
+        }
+
+        // Rejoining node keeps its address
+        if (strcmp(entries[i].deviceName, deviceName) == 0) {
+            entries[i].lastSeen = millis();
+            return MSG_ADDR_FIRST_NODE + i;
+        }
+
+        if (millis() - entries[i].lastSeen > millis() - entries[oldestSlot].lastSeen) {
+            oldestSlot = i;
+        }
+    }
+
+    // Table full: the evicted node gets MSG_JOIN_REJOIN on its next frame
+    int slot = (freeSlot >= 0) ? freeSlot : oldestSlot;
+
+    strncpy(entries[slot].deviceName, deviceName, sizeof(entries[slot].deviceName) - 1);
+    entries[slot].deviceName[sizeof(entries[slot].deviceName) - 1] = '\0';
+    entries[slot].lastSeen = millis();
+
+    return MSG_ADDR_FIRST_NODE + slot;
+}
+
+const char* NodeRegistry::lookup(uint8_t address) {
+    int slot = slotFor(address);
+    if (slot < 0 || entries[slot].deviceName[0] == '\0') {
+        return nullptr;
+    }
+    return entries[slot].deviceName;
+}
+
+void NodeRegistry::touch(uint8_t address) {
+    int slot = slotFor(address);
+    if (slot >= 0) {
+        entries[slot].lastSeen = millis();
+    }
+}
+
+uint8_t NodeRegistry::getCount() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < NODE_REGISTRY_SIZE; i++) {
+        if (entries[i].deviceName[0] != '\0') {
+            count++;
+        }
+    }
+    return count;
+}
+
+void NodeRegistry::printTable() {
+    Serial.println(F("--- Joined Nodes ---"));
+    for (uint8_t i = 0; i < NODE_REGISTRY_SIZE; i++) {
+        if (entries[i].deviceName[0] == '\0') {
+            continue;
+        }
+        Serial.print(F("0x"));
+        Serial.print(MSG_ADDR_FIRST_NODE + i, HEX);
+        Serial.print(F(" -> "));
+        Serial.print(entries[i].deviceName);
+        Serial.print(F(" (seen "));
+        Serial.print((millis() - entries[i].lastSeen) / 1000);
+        Serial.println(F("s ago)"));
+    }
+    Serial.println(F("--------------------"));
+}
+
+int NodeRegistry::slotFor(uint8_t address) {
+    if (address < MSG_ADDR_FIRST_NODE || address >= MSG_ADDR_FIRST_NODE + NODE_REGISTRY_SIZE) {
+        return -1;
+    }
+    return address - MSG_ADDR_FIRST_NODE;
+}
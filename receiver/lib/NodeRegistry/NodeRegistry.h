@@ -0,0 +1,51 @@
+#ifndef NODE_REGISTRY_H
+#define NODE_REGISTRY_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Number of nodes that can hold a short address at once
+#ifndef NODE_REGISTRY_SIZE
+    #define NODE_REGISTRY_SIZE 16
+#endif
+
+static_assert(NODE_REGISTRY_SIZE <= MSG_ADDR_LAST_NODE - MSG_ADDR_FIRST_NODE + 1,
+              "NODE_REGISTRY_SIZE exceeds the short address range");
+
+// One joined node
+struct NodeEntry {
+    char deviceName[32];      // Empty if the slot is free
+    unsigned long lastSeen;   // millis() of the last join or frame
+};
+
+// Short address -> device name table for joined nodes.
+// Address N lives in slot N - MSG_ADDR_FIRST_NODE, so lookups are O(1).
+class NodeRegistry {
+public:
+    NodeRegistry();
+
+    // Address for a device name: the existing one if already joined,
+    // else a free slot, else the least recently seen node's slot
+    uint8_t join(const char* deviceName);
+
+    // Device name for a short address, nullptr if not joined
+    const char* lookup(uint8_t address);
+
+    // Record activity from a joined node (keeps it from being evicted)
+    void touch(uint8_t address);
+
+    // Number of joined nodes
+    uint8_t getCount();
+
+    // Print address table
+    void printTable();
+
+private:
+    NodeEntry entries[NODE_REGISTRY_SIZE];
+
+    // Slot index for an address, -1 if out of range
+    int slotFor(uint8_t address);
+};
+
+#endif // NODE_REGISTRY_H
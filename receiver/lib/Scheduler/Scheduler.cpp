@@ -0,0 +1,160 @@
+#include "Scheduler.h"
+
+#if defined(__AVR__)
+    #include <avr/sleep.h>
+#endif
+
+volatile bool Scheduler::wakePending = false;
+
+Scheduler::Scheduler() : wakeFlagCount(0) {
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        tasks[i].callback = nullptr;
+        tasks[i].deadline = 0;
+        tasks[i].period = 0;
+        tasks[i].armed = false;
+    }
+}
+
+// ===== Task Registration =====
+
+uint8_t Scheduler::allocate(TaskCallback callback, unsigned long delayMs, unsigned long periodMs, bool armed) {
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        if (tasks[i].callback == nullptr) {
+            tasks[i].callback = callback;
+            tasks[i].deadline = millis() + delayMs;
+            tasks[i].period = periodMs;
+            tasks[i].armed = armed;
+            return i;
+        }
+    }
+
+    Serial.println(F("ERROR: Scheduler task table full"));
+    return SCHEDULER_NO_TASK;
+}
+
+uint8_t Scheduler::add(TaskCallback callback) {
+    return allocate(callback, 0, 0, false);
+}
+
+uint8_t Scheduler::every(unsigned long periodMs, TaskCallback callback, bool runNow) {
+    return allocate(callback, runNow ? 0 : periodMs, periodMs, true);
+}
+
+uint8_t Scheduler::after(unsigned long delayMs, TaskCallback callback) {
+    return allocate(callback, delayMs, 0, true);
+}
+
+void Scheduler::reschedule(uint8_t taskId, unsigned long delayMs) {
+    if (taskId >= SCHEDULER_MAX_TASKS || tasks[taskId].callback == nullptr) {
+        return;
+    }
+    tasks[taskId].deadline = millis() + delayMs;
+    tasks[taskId].armed = true;
+}
+
+void Scheduler::stop(uint8_t taskId) {
+    if (taskId < SCHEDULER_MAX_TASKS) {
+        tasks[taskId].armed = false;
+    }
+}
+
+bool Scheduler::isPending(uint8_t taskId) {
+    return taskId < SCHEDULER_MAX_TASKS && tasks[taskId].armed;
+}
+
+// ===== Dispatch =====
+
+unsigned long Scheduler::run() {
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        ScheduledTask& task = tasks[i];
+        unsigned long now = millis();
+
+        if (!task.armed || (long)(now - task.deadline) < 0) {
+            continue;
+        }
+
+        // Update before the callback so it may reschedule or stop itself
+        if (task.period > 0) {
+            task.deadline += task.period;
+            if ((long)(now - task.deadline) >= 0) {
+                // Fell more than a period behind: skip the missed runs
+                task.deadline = now + task.period;
+            }
+        } else {
+            task.armed = false;
+        }
+
+        task.callback();
+    }
+
+    return timeUntilNext();
+}
+
+unsigned long Scheduler::timeUntilNext() {
+    unsigned long now = millis();
+    unsigned long next = SCHEDULER_FOREVER;
+
+    for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+        if (!tasks[i].armed) {
+            continue;
+        }
+        long remaining = (long)(tasks[i].deadline - now);
+        if (remaining <= 0) {
+            return 0;
+        }
+        if ((unsigned long)remaining < next) {
+            next = remaining;
+        }
+    }
+
+    return next;
+}
+
+// ===== Idle =====
+
+void Scheduler::sleep(unsigned long maxMs) {
+    unsigned long wait = timeUntilNext();
+    if (maxMs < wait) {
+        wait = maxMs;
+    }
+
+    unsigned long start = millis();
+    while (!isWoken() && millis() - start < wait && !Serial.available()) {
+        #if defined(ESP32)
+            // Blocks this task for one tick; FreeRTOS idles the core
+            delay(1);
+        #elif defined(__AVR__)
+            // Idle mode: the next interrupt (1 ms timer tick, DIO0, UART) wakes the CPU
+            set_sleep_mode(SLEEP_MODE_IDLE);
+            sleep_mode();
+        #else
+            yield();
+        #endif
+    }
+
+    wakePending = false;
+}
+
+void Scheduler::wake() {
+    wakePending = true;
+}
+
+bool Scheduler::wakeOn(const volatile bool* flag) {
+    if (wakeFlagCount >= SCHEDULER_MAX_WAKE_FLAGS) {
+        return false;
+    }
+    wakeFlags[wakeFlagCount++] = flag;
+    return true;
+}
+
+bool Scheduler::isWoken() {
+    if (wakePending) {
+        return true;
+    }
+    for (uint8_t i = 0; i < wakeFlagCount; i++) {
+        if (*wakeFlags[i]) {
+            return true;
+        }
+    }
+    return false;
+}
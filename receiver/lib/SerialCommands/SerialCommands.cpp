@@ -98,6 +98,14 @@ void SerialCommands::printHelp() {
     Serial.println(F("cmd led on              - LED on command"));
     Serial.println(F("cmd led off             - LED off command"));
     Serial.println(F("cmd led toggle          - LED toggle command"));
+    Serial.println(F("subscribe <sensor|all> <sec> [deadband] - Stream readings from the peer"));
+    Serial.println(F("unsubscribe             - Stop the stream"));
+    Serial.println(F("poll add <addr> [sensor] - Add a node to the poll table"));
+    Serial.println(F("poll remove <addr>      - Remove a node"));
+    Serial.println(F("poll start [rr|stale]   - Poll round-robin or stalest first"));
+    Serial.println(F("poll stop               - Stop polling"));
+    Serial.println(F("blob <bytes>            - Send a test payload in fragments"));
+    Serial.println(F("adr [on|off]            - Adaptive data rate towards the peer"));
     Serial.println(F("stats                   - Show statistics"));
     Serial.println(F("clear                   - Clear statistics"));
     Serial.println(F("========================================\n"));
@@ -125,6 +133,12 @@ void SerialCommands::printStats(const Statistics& stats) {
     Serial.print(F("Retries:           "));
     Serial.println(stats.retries);
 
+    Serial.print(F("Retries Saved:     "));
+    Serial.println(stats.retriesSaved);
+
+    Serial.print(F("Duplicates:        "));
+    Serial.println(stats.duplicates);
+
     if (stats.rssiCount > 0) {
         float avgRSSI = (float)stats.totalRSSI / stats.rssiCount;
         Serial.print(F("Avg RSSI:          "));
@@ -143,6 +157,8 @@ void SerialCommands::clearStats(Statistics& stats) {
     stats.messagesReceived = 0;
     stats.messagesFailed = 0;
     stats.retries = 0;
+    stats.retriesSaved = 0;
+    stats.duplicates = 0;
     stats.totalRSSI = 0;
     stats.rssiCount = 0;
     stats.startTime = millis();
@@ -167,6 +183,24 @@ void SerialCommands::printReceivedMessage(const Message& msg, const char* conten
     Serial.println(F(" dB]"));
 }
 
+void SerialCommands::printReceivedMessage(const MessageView& msg) {
+    Serial.print(F("["));
+    Serial.print(getTimestamp());
+    Serial.print(F("] RX << "));
+
+    MessageProtocol protocol;
+    Serial.print(protocol.getMessageTypeName(msg.type()));
+    Serial.print(F(": \""));
+    Serial.write(msg.payload(), msg.payloadLength());
+    Serial.print(F("\" [ID: "));
+    Serial.print(msg.messageId());
+    Serial.print(F(", RSSI: "));
+    Serial.print(msg.rssi);
+    Serial.print(F(" dBm, SNR: "));
+    Serial.print(msg.snr, 1);
+    Serial.println(F(" dB]"));
+}
+
 void SerialCommands::printSentMessage(const char* type, const char* content, bool success) {
     Serial.print(F("["));
     Serial.print(getTimestamp());
@@ -208,11 +242,21 @@ void SerialCommands::printError(const char* message) {
     Serial.println(message);
 }
 
+void SerialCommands::printError(const __FlashStringHelper* message) {
+    Serial.print(F("[ERROR] "));
+    Serial.println(message);
+}
+
 void SerialCommands::printInfo(const char* message) {
     Serial.print(F("[INFO] "));
     Serial.println(message);
 }
 
+void SerialCommands::printInfo(const __FlashStringHelper* message) {
+    Serial.print(F("[INFO] "));
+    Serial.println(message);
+}
+
 String SerialCommands::getUptime(unsigned long startTime) {
     unsigned long uptime = (millis() - startTime) / 1000;  // Convert to seconds
 
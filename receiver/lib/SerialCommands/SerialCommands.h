@@ -26,6 +26,8 @@ struct Statistics {
     uint32_t messagesReceived;
     uint32_t messagesFailed;
     uint32_t retries;
+    uint32_t retriesSaved;  // Retransmissions avoided by selective ACKs
+    uint32_t duplicates;    // Retransmitted frames answered without re-running the handler
     int32_t totalRSSI;
     uint32_t rssiCount;
     unsigned long startTime;
@@ -56,6 +58,9 @@ public:
     // Print received message
     void printReceivedMessage(const Message& msg, const char* content);
 
+    // Print received message, payload shown as text straight from the view
+    void printReceivedMessage(const MessageView& msg);
+
     // Print sent message status
     void printSentMessage(const char* type, const char* content, bool success);
 
@@ -68,11 +73,13 @@ public:
     // Print ACK received
     void printAckReceived(uint16_t msgId, bool success);
 
-    // Print error message
+    // Print error message (F() literals stay in flash)
     void printError(const char* message);
+    void printError(const __FlashStringHelper* message);
 
     // Print info message
     void printInfo(const char* message);
+    void printInfo(const __FlashStringHelper* message);
 
     // Get uptime string
     String getUptime(unsigned long startTime);
@@ -2,33 +2,258 @@
 #include "LoRaComm.h"
 #include "MessageProtocol.h"
 #include "DummySensors.h"
+#include "NodeRegistry.h"
+#include "DuplicateCache.h"
+#include "Scheduler.h"
+#include "TxQueue.h"
+#include "ChannelHopper.h"
 #include "board_config.h"
 
 // ===== Global Objects =====
 LoRaComm loraComm;
 MessageProtocol protocol;
 DummySensors sensors;
+NodeRegistry registry;
+DuplicateCache dedup;
+Scheduler scheduler;
+TxQueue txQueue;
+ChannelHopper hopper;  // Period clock, and uplink channel per period (HOP_ENABLED)
 
 // ===== Statistics =====
 struct Statistics {
     unsigned long messagesReceived;
     unsigned long messagesFailed;
+    unsigned long duplicates;
     long totalRSSI;
     unsigned long rssiCount;
     unsigned long startTime;
 };
 
-Statistics stats = {0, 0, 0, 0, 0};
-
-// ===== Buffers =====
-uint8_t rxBuffer[MSG_MAX_PACKET_SIZE];
-Message lastMessage;
+Statistics stats = {0, 0, 0, 0, 0, 0};
 
 // ===== LED Blink Function =====
+const unsigned long LED_PULSE_MS = 50;  // Brief 50ms flash
+uint8_t ledTask = SCHEDULER_NO_TASK;
+
+void ledOff() {
+    digitalWrite(LED_PIN, LOW);
+}
+
 void blinkLED() {
+    // Switched off by the scheduler, packet processing continues meanwhile
     digitalWrite(LED_PIN, HIGH);
-    delay(50);  // Brief 50ms flash
-    digitalWrite(LED_PIN, LOW);
+    scheduler.reschedule(ledTask, LED_PULSE_MS);
+}
+
+// ===== Join Handshake =====
+void handleJoinRequest(const MessageView& message) {
+    JoinInfo join;
+    if (!protocol.parseJoin(message, join) || join.deviceName[0] == '\0') {
+        Serial.println(F("[ERROR] Failed to parse join request"));
+        stats.messagesFailed++;
+        return;
+    }
+
+    // Same name gets the same address back, so repeated requests are harmless
+    uint8_t address = registry.join(join.deviceName);
+
+    // A (re)joining node starts its message IDs over: drop the old ones
+    // and any cached reply, so new frames are not taken for duplicates
+    dedup.forget(address);
+
+    // Node has no address yet: it picks its reply out of the broadcast by name
+    uint8_t* frame = txQueue.reserve(TX_CLASS_CONTROL);
+    protocol.setDestination(MSG_ADDR_BROADCAST);
+    size_t len = (frame != nullptr) ? protocol.encodeJoinAccept(address, join.deviceName, frame) : 0;
+    if (txQueue.commit(len)) {
+        Serial.print(F("[JOIN] "));
+        Serial.print(join.deviceName);
+        Serial.print(F(" -> 0x"));
+        Serial.println(address, HEX);
+    } else {
+        Serial.println(F("[ERROR] Failed to queue join accept"));
+    }
+}
+
+// Device name for a reading: inline name, else the registry entry of a
+// joined node. Unknown addresses (receiver restarted or node evicted) are
+// told to join again and shown as nullptr.
+const char* resolveDevice(const char* deviceName, uint8_t deviceAddr) {
+    if (deviceAddr == MSG_ADDR_NONE) {
+        return deviceName;
+    }
+
+    const char* name = registry.lookup(deviceAddr);
+    if (name != nullptr) {
+        registry.touch(deviceAddr);
+        return name;
+    }
+
+    uint8_t* frame = txQueue.reserve(TX_CLASS_CONTROL);
+    protocol.setDestination(deviceAddr);
+    size_t len = (frame != nullptr) ? protocol.encodeJoinRejoin(deviceAddr, frame) : 0;
+    if (txQueue.commit(len)) {
+        Serial.print(F("[JOIN] Unknown address 0x"));
+        Serial.print(deviceAddr, HEX);
+        Serial.println(F(", rejoin requested"));
+    }
+    return nullptr;
+}
+
+// ===== Period Clock =====
+// Senders' periods (slots, hops) follow this clock through the beacon
+static_assert(SLOT_PERIOD_MS > 0 && SLOT_PERIOD_MS <= 0xFFFF, "SLOT_PERIOD_MS must fit the beacon (1-65535)");
+static_assert(!HOP_ENABLED || (SLOT_BEACON_INTERVAL_MS > 0 && SLOT_BEACON_INTERVAL_MS < HOP_SYNC_TIMEOUT_MS),
+              "HOP_ENABLED needs a beacon more often than HOP_SYNC_TIMEOUT_MS");
+
+// Periods from one beacon to the next
+const uint16_t BEACON_PERIODS = (SLOT_BEACON_INTERVAL_MS > SLOT_PERIOD_MS) ? SLOT_BEACON_INTERVAL_MS / SLOT_PERIOD_MS : 1;
+
+uint8_t periodTask = SCHEDULER_NO_TASK;
+uint16_t periodHop = 0;          // Period the task last handled
+uint16_t periodsSinceBeacon = 0;
+bool beaconDue = false;          // Sent by pumpTxQueue() ahead of queued replies
+uint8_t listenChannel = 0;       // Uplink channel listened on this period
+uint16_t framesThisHop = 0;      // Frames decoded on it so far
+
+void listenOnHopChannel() {
+    listenChannel = hopper.getChannel(millis());
+    loraComm.setRxFrequency(ChannelHopper::getFrequency(listenChannel));
+}
+
+void onPeriod() {
+    unsigned long now = millis();
+    uint16_t hop = hopper.getHop(now);
+
+    if (hop != periodHop) {
+        periodHop = hop;
+
+        // Score the channel just listened to, then move to this period's
+        if (HOP_ENABLED) {
+            hopper.recordVisit(listenChannel, framesThisHop);
+            framesThisHop = 0;
+            listenOnHopChannel();
+        }
+
+        if (++periodsSinceBeacon >= BEACON_PERIODS) {
+            periodsSinceBeacon = 0;
+            beaconDue = true;
+        }
+    }
+
+    // Re-armed from the hop clock so scheduling delays do not add up
+    scheduler.reschedule(periodTask, SLOT_PERIOD_MS - hopper.getHopOffset(now));
+}
+
+// Encode the beacon for this instant: the offset is exact only if it goes
+// on air now
+size_t encodeBeaconNow(BeaconInfo& beacon, uint8_t* frame) {
+    unsigned long now = millis();
+    beacon.periodMs = SLOT_PERIOD_MS;
+    beacon.offsetMs = hopper.getHopOffset(now);
+    beacon.hop = hopper.getHop(now);
+    beacon.blacklist = hopper.getNextBlacklist();
+
+    protocol.setDestination(MSG_ADDR_BROADCAST);
+    return protocol.encodeBeacon(beacon, frame);
+}
+
+void onBeaconSent(const BeaconInfo& beacon) {
+    // Channels blacklisted since the last beacon are skipped from now on,
+    // as the nodes that hear this one do
+    bool changed = (beacon.blacklist != hopper.getBlacklist());
+    hopper.sync(millis() - beacon.offsetMs, SLOT_PERIOD_MS, beacon.hop, beacon.blacklist);
+    if (HOP_ENABLED && changed) {
+        Serial.print(F("[HOP] Blacklist now 0x"));
+        Serial.println(beacon.blacklist, HEX);
+        listenOnHopChannel();
+    }
+}
+
+// ===== TX Queue =====
+unsigned long pumpTxQueue() {
+    // Join replies go out one at a time, as the radio becomes free
+    if (loraComm.isTransmitting()) {
+        return 0;
+    }
+
+    // A due beacon goes first, encoded on each attempt so that its period
+    // offset holds for the moment it goes on air
+    uint8_t beaconFrame[MSG_HEADER_V2_SIZE + MSG_ADDR_FIELDS_SIZE + MSG_BEACON_PAYLOAD_SIZE + MSG_MAX_TRAILER_SIZE];
+    BeaconInfo beacon;
+    const TxEntry* entry = nullptr;
+    const uint8_t* frame;
+    size_t length;
+    if (beaconDue) {
+        frame = beaconFrame;
+        length = encodeBeaconNow(beacon, beaconFrame);
+    } else {
+        entry = txQueue.peek();
+        if (entry == nullptr) {
+            return 0;
+        }
+        frame = entry->frame;
+        length = entry->length;
+    }
+
+    // Airtime budget spent: the frame stays queued until it is covered
+    unsigned long wait = loraComm.getTxDelay(length);
+    if (wait > 0) {
+        return wait;
+    }
+
+    // Listen before talk: back off while another node is on air
+    wait = loraComm.checkChannel(length);
+    if (wait == LBT_GIVE_UP) {
+        Serial.println(F("[ERROR] Channel busy, packet dropped"));
+    } else if (wait > 0) {
+        return wait;
+    } else if (!loraComm.sendPacketAsync(frame, length)) {
+        Serial.println(F("[ERROR] Failed to send packet"));
+    } else if (entry == nullptr) {
+        onBeaconSent(beacon);
+    }
+
+    if (entry != nullptr) {
+        txQueue.pop();
+    } else {
+        beaconDue = false;
+    }
+    return 0;
+}
+
+// ===== Sensor Display =====
+void printReading(const char* deviceName, uint8_t deviceAddr, uint8_t sensorId, float value,
+                  const char* unit, const MessageView& message) {
+    unsigned long uptime = (millis() - stats.startTime) / 1000;
+
+    Serial.print(F("["));
+    Serial.print(uptime);
+    Serial.print(F("s] "));
+
+    // Display device name if available, else the unresolved short address
+    if (deviceName != nullptr && deviceName[0] != '\0') {
+        Serial.print(F("["));
+        Serial.print(deviceName);
+        Serial.print(F("] "));
+    } else if (deviceAddr != MSG_ADDR_NONE) {
+        Serial.print(F("[0x"));
+        Serial.print(deviceAddr, HEX);
+        Serial.print(F("] "));
+    }
+
+    Serial.print(sensors.getSensorName(sensorId));
+    Serial.print(F(": "));
+    Serial.print(value, 2);
+    Serial.print(F(" "));
+    Serial.print(unit);
+
+    Serial.print(F(" | RSSI: "));
+    Serial.print(message.rssi);
+    Serial.print(F(" dBm | SNR: "));
+    Serial.print(message.snr, 1);
+    Serial.print(F(" dB | ID: "));
+    Serial.println(message.messageId());
 }
 
 void setup() {
@@ -39,6 +264,7 @@ void setup() {
     // Initialize LED pin
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, LOW);
+    ledTask = scheduler.add(ledOff);
 
     // Print banner
     Serial.println(F("\n\n"));
@@ -62,6 +288,26 @@ void setup() {
         }
     }
 
+    // Drain packets from DIO0 interrupt so none are lost during LED/serial output
+    loraComm.enableRxInterrupt();
+
+    // Radio events (flagged by the DIO0 interrupt) end the idle sleep in loop()
+    scheduler.wakeOn(loraComm.getEventFlag());
+
+    // Frames addressed to other nodes are dropped after a header-only read
+    protocol.setLocalAddress(MSG_ADDR_GATEWAY);
+    loraComm.setAddressFilter(MSG_ADDR_GATEWAY);
+
+    // Period clock for slotted and hopping senders, beacon right away
+    if (SLOT_BEACON_INTERVAL_MS > 0 || HOP_ENABLED) {
+        hopper.sync(millis(), SLOT_PERIOD_MS, 0, 0);
+        if (HOP_ENABLED) {
+            listenOnHopChannel();
+        }
+        beaconDue = (SLOT_BEACON_INTERVAL_MS > 0);
+        periodTask = scheduler.after(SLOT_PERIOD_MS, onPeriod);
+    }
+
     // Initialize sensors (for getting sensor names)
     sensors.begin();
 
@@ -77,12 +323,15 @@ void setup() {
 }
 
 void loop() {
-    // Check for incoming LoRa packets
-    int packetSize = loraComm.receivePacket(rxBuffer, sizeof(rxBuffer));
+    // Check for incoming LoRa packets (buffered by the RX interrupt)
+    const RxPacket* packet = loraComm.peek();
+
+    if (packet != nullptr) {
+        int packetSize = packet->length;
+        const uint8_t* rxBuffer = packet->data;
 
-    if (packetSize > 0) {
         stats.messagesReceived++;
-        stats.totalRSSI += loraComm.getRSSI();
+        stats.totalRSSI += packet->rssi;
         stats.rssiCount++;
 
         // Blink LED on packet received
@@ -92,7 +341,7 @@ void loop() {
         Serial.print(F("[DEBUG] Received "));
         Serial.print(packetSize);
         Serial.print(F(" bytes, RSSI: "));
-        Serial.print(loraComm.getRSSI());
+        Serial.print(packet->rssi);
         Serial.print(F(" | Raw: "));
         for (int i = 0; i < min(packetSize, 20); i++) {
             if (rxBuffer[i] < 0x10) Serial.print('0');
@@ -102,19 +351,34 @@ void loop() {
         if (packetSize > 20) Serial.print(F("..."));
         Serial.println();
 
-        // Decode message
-        if (protocol.decode(rxBuffer, packetSize, lastMessage)) {
-            lastMessage.rssi = loraComm.getRSSI();
-            lastMessage.snr = loraComm.getSNR();
+        // Decode message in place (view points into the ring slot, no copy)
+        MessageView message;
+        if (protocol.decodeView(rxBuffer, packetSize, message)) {
+            framesThisHop++;  // Channel quality: frames that got through
+            message.rssi = packet->rssi;
+            message.snr = packet->snr;
 
-            // Process based on message type
-            if (lastMessage.type == MSG_SENSOR_RESPONSE) {
-                // Parse sensor response - try with device name first, then fallback to legacy
+            // Process based on message type (a retransmitted copy of a
+            // frame already handled is only counted)
+            if (dedup.check(message.source(), message.messageId())) {
+                stats.duplicates++;
+                Serial.print(F("[RX] Duplicate message "));
+                Serial.print(message.messageId());
+                Serial.print(F(" from 0x"));
+                Serial.print(message.source(), HEX);
+                Serial.println(F(", ignored"));
+            } else if (message.type() == MSG_SENSOR_RESPONSE || message.type() == MSG_SENSOR_COMPACT) {
+                // Parse sensor response - compact format, else with device name, then fallback to legacy
                 SensorData data;
-                bool parsed = protocol.parseSensorResponseWithDevice(lastMessage.payload, lastMessage.payloadLength, data);
-                if (!parsed) {
+                bool parsed;
+                if (message.type() == MSG_SENSOR_COMPACT) {
+                    parsed = protocol.parseSensorCompact(message, data);
+                } else {
+                    parsed = protocol.parseSensorResponseWithDevice(message, data);
+                }
+                if (!parsed && message.type() == MSG_SENSOR_RESPONSE) {
                     // Fallback to legacy parsing (no device name)
-                    parsed = protocol.parseSensorResponse(lastMessage.payload, lastMessage.payloadLength, data);
+                    parsed = protocol.parseSensorResponse(message, data);
                 }
 
                 // Debug: Show parsing result
@@ -123,70 +387,63 @@ void loop() {
                 if (parsed) {
                     Serial.print(F(", Device='"));
                     Serial.print(data.deviceName);
-                    Serial.print(F("', Sensor="));
+                    Serial.print(F("', Addr=0x"));
+                    Serial.print(data.deviceAddr, HEX);
+                    Serial.print(F(", Sensor="));
                     Serial.println(data.sensorId);
                 } else {
                     Serial.println();
                 }
 
                 if (parsed) {
-                    // Display sensor data
-                    unsigned long uptime = (millis() - stats.startTime) / 1000;
-
-                    Serial.print(F("["));
-                    Serial.print(uptime);
-                    Serial.print(F("s] "));
-
-                    // Display device name if available
-                    if (data.deviceName[0] != '\0') {
-                        Serial.print(F("["));
-                        Serial.print(data.deviceName);
-                        Serial.print(F("] "));
-                    }
-
-                    Serial.print(sensors.getSensorName(data.sensorId));
-                    Serial.print(F(": "));
-                    Serial.print(data.value, 2);
-                    Serial.print(F(" "));
-                    Serial.print(data.unit);
-
-                    Serial.print(F(" | RSSI: "));
-                    Serial.print(lastMessage.rssi);
-                    Serial.print(F(" dBm | SNR: "));
-                    Serial.print(lastMessage.snr, 1);
-                    Serial.print(F(" dB | ID: "));
-                    Serial.println(lastMessage.messageId);
+                    const char* deviceName = resolveDevice(data.deviceName, data.deviceAddr);
+                    printReading(deviceName, data.deviceAddr, data.sensorId, data.value, data.unit, message);
                 } else {
                     Serial.println(F("[ERROR] Failed to parse sensor data"));
                     stats.messagesFailed++;
                 }
-            } else if (lastMessage.type == MSG_TEXT) {
+            } else if (message.type() == MSG_SENSOR_BATCH) {
+                // Snapshot: several readings behind one device name
+                SensorBatch batch;
+                if (protocol.parseSensorBatch(message, batch)) {
+                    const char* deviceName = resolveDevice(batch.deviceName, batch.deviceAddr);
+                    for (uint8_t i = 0; i < batch.count; i++) {
+                        const SensorReading& reading = batch.readings[i];
+                        printReading(deviceName, batch.deviceAddr, reading.sensorId, reading.value,
+                                     sensors.getSensorUnit(reading.sensorId), message);
+                    }
+                } else {
+                    Serial.println(F("[ERROR] Failed to parse sensor batch"));
+                    stats.messagesFailed++;
+                }
+            } else if (message.type() == MSG_JOIN_REQUEST) {
+                handleJoinRequest(message);
+            } else if (message.type() == MSG_TEXT) {
                 // Display text message
-                char textBuffer[MSG_MAX_PAYLOAD + 1];
-                memcpy(textBuffer, lastMessage.payload, lastMessage.payloadLength);
-                textBuffer[lastMessage.payloadLength] = '\0';
-
                 unsigned long uptime = (millis() - stats.startTime) / 1000;
 
                 Serial.print(F("["));
                 Serial.print(uptime);
                 Serial.print(F("s] TEXT: \""));
-                Serial.print(textBuffer);
+                Serial.write(message.payload(), message.payloadLength());
                 Serial.print(F("\" | RSSI: "));
-                Serial.print(lastMessage.rssi);
+                Serial.print(message.rssi);
                 Serial.print(F(" dBm | SNR: "));
-                Serial.print(lastMessage.snr, 1);
+                Serial.print(message.snr, 1);
                 Serial.println(F(" dB"));
             } else {
                 // Unknown message type
                 Serial.print(F("[RX] Unknown message type: 0x"));
-                Serial.println(lastMessage.type, HEX);
+                Serial.println(message.type(), HEX);
             }
         } else {
             Serial.println(F("[ERROR] Failed to decode packet (checksum error)"));
             stats.messagesFailed++;
         }
 
+        // Release the ring slot
+        loraComm.pop();
+
         // Print statistics every 20 messages
         if (stats.messagesReceived % 20 == 0) {
             Serial.println();
@@ -195,6 +452,26 @@ void loop() {
             Serial.println(stats.messagesReceived);
             Serial.print(F("Failed: "));
             Serial.println(stats.messagesFailed);
+            Serial.print(F("Duplicates: "));
+            Serial.println(stats.duplicates);
+            Serial.print(F("Dropped (ring full): "));
+            Serial.println(loraComm.getRxDropped());
+            Serial.print(F("Filtered (other nodes): "));
+            Serial.println(loraComm.getRxFiltered());
+            Serial.print(F("Joined nodes: "));
+            Serial.println(registry.getCount());
+            txQueue.printStats();
+            loraComm.getDutyCycle().printStats();
+            loraComm.getListenBeforeTalk().printStats();
+            hopper.printStats();
+            const SpiStats& spi = loraComm.getSpiStats();
+            Serial.print(F("SPI: "));
+            Serial.print(spi.transactions);
+            Serial.print(F(" transactions, "));
+            Serial.print(spi.bytes);
+            Serial.print(F(" bytes, "));
+            Serial.print(spi.packets);
+            Serial.println(F(" packets"));
             if (stats.rssiCount > 0) {
                 Serial.print(F("Avg RSSI: "));
                 Serial.print(stats.totalRSSI / stats.rssiCount);
@@ -204,9 +481,19 @@ void loop() {
             Serial.print((millis() - stats.startTime) / 1000);
             Serial.println(F(" seconds"));
             Serial.println(F("------------------"));
+            if (registry.getCount() > 0) {
+                registry.printTable();
+            }
             Serial.println();
         }
     }
 
-    delay(10);
+    scheduler.run();
+    unsigned long txWait = pumpTxQueue();
+
+    // Idle until the LED pulse ends, the next packet arrives or the
+    // airtime budget covers the queued reply
+    if (loraComm.getRxPending() == 0 && ((txQueue.isEmpty() && !beaconDue) || loraComm.isTransmitting() || txWait > 0)) {
+        scheduler.sleep(txWait > 0 ? txWait : SCHEDULER_FOREVER);
+    }
 }
@@ -0,0 +1,84 @@
+#include "DutyCycle.h"
+
+DutyCycle::DutyCycle()
+    : tokens(DUTY_CYCLE_BUDGET_US), lastRefill(0), airtimeMs(0), airtimeRemainderUs(0),
+      throttled(0), rejected(0), waiting(false) {
+}
+
+void DutyCycle::refill() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - lastRefill;
+    lastRefill = now;
+
+    // DUTY_CYCLE_PERMILLE us of airtime per ms of wall time
+    if (elapsed >= DUTY_CYCLE_WINDOW_S * 1000UL) {
+        tokens = DUTY_CYCLE_BUDGET_US;
+        return;
+    }
+
+    uint32_t added = elapsed * DUTY_CYCLE_PERMILLE;
+    tokens = (added >= DUTY_CYCLE_BUDGET_US - tokens) ? DUTY_CYCLE_BUDGET_US : tokens + added;
+}
+
+unsigned long DutyCycle::getDelay(uint32_t airtimeUs) {
+    refill();
+
+    if (tokens >= airtimeUs) {
+        return 0;
+    }
+
+    // Count each time the budget runs dry, not every check while it is
+    if (!waiting) {
+        waiting = true;
+        throttled++;
+    }
+
+    return (airtimeUs - tokens + DUTY_CYCLE_PERMILLE - 1) / DUTY_CYCLE_PERMILLE;
+}
+
+bool DutyCycle::consume(uint32_t airtimeUs) {
+    refill();
+
+    if (tokens < airtimeUs) {
+        rejected++;
+        return false;
+    }
+
+    tokens -= airtimeUs;
+    waiting = false;
+
+    airtimeRemainderUs += airtimeUs % 1000;
+    airtimeMs += airtimeUs / 1000 + airtimeRemainderUs / 1000;
+    airtimeRemainderUs %= 1000;
+    return true;
+}
+
+uint32_t DutyCycle::getAirtimeMs() {
+    return airtimeMs;
+}
+
+uint32_t DutyCycle::getAvailableMs() {
+    refill();
+    return tokens / 1000;
+}
+
+uint32_t DutyCycle::getThrottled() {
+    return throttled;
+}
+
+uint32_t DutyCycle::getRejected() {
+    return rejected;
+}
+
+void DutyCycle::printStats() {
+    Serial.print(F("Airtime: "));
+    Serial.print(airtimeMs);
+    Serial.print(F(" ms, budget left "));
+    Serial.print(getAvailableMs());
+    Serial.print(F(" ms ("));
+    Serial.print(DUTY_CYCLE_PERMILLE / 10.0, 1);
+    Serial.print(F("% duty cycle), throttled "));
+    Serial.print(throttled);
+    Serial.print(F(", rejected "));
+    Serial.println(rejected);
+}
@@ -1,7 +1,24 @@
 #include "LoRaComm.h"
 #include <board_config.h>
 
-LoRaComm::LoRaComm() : lastRSSI(0), lastSNR(0.0) {
+// ESP32: interrupt handlers must sit in IRAM (flash cache may be off)
+#if defined(ESP32)
+    #define LORA_ISR_ATTR IRAM_ATTR
+#else
+    #define LORA_ISR_ATTR
+#endif
+
+LoRaComm* LoRaComm::instance = nullptr;
+
+LoRaComm::LoRaComm()
+    : lastRSSI(0), lastSNR(0.0),
+      rxFrequency(LORA_FREQUENCY), txFrequency(LORA_FREQUENCY), tunedFrequency(LORA_FREQUENCY),
+      rxHead(0), rxTail(0), rxDropped(0), rxFiltered(0), rxPacketCount(0),
+      filterAddress(MSG_ADDR_NONE), rxInterruptMode(false), irqPending(false), irqTime(0),
+      cadState(CAD_IDLE), cadStart(0), cadTimeoutMs(0), txBusy(false), txStartTime(0), txDoneCallback(nullptr), rxDoneCallback(nullptr) {
+    settings.spreadingFactor = LORA_SPREADING_FACTOR;
+    settings.bandwidth = (uint32_t)LORA_SIGNAL_BANDWIDTH;
+    settings.txPower = LORA_TX_POWER;
 }
 
 bool LoRaComm::begin() {
@@ -77,37 +94,94 @@ bool LoRaComm::begin() {
 
     Serial.println(F("LoRa.begin() succeeded!"));
 
+    // Packet data bypasses LoRa.read()/write() and uses burst transfers
+    fifo.begin(LORA_NSS);
+
     // Configure LoRa parameters
-    LoRa.setSpreadingFactor(LORA_SPREADING_FACTOR);
-    LoRa.setSignalBandwidth(LORA_SIGNAL_BANDWIDTH);
+    LoRa.setSpreadingFactor(settings.spreadingFactor);
+    LoRa.setSignalBandwidth(settings.bandwidth);
     LoRa.setCodingRate4(LORA_CODING_RATE);
     LoRa.setPreambleLength(LORA_PREAMBLE_LENGTH);
     LoRa.setSyncWord(LORA_SYNC_WORD);
-    LoRa.setTxPower(LORA_TX_POWER);
+    LoRa.setTxPower(settings.txPower);
 
     // Enable CRC
     LoRa.enableCrc();
 
+    // DIO0 events (TxDone, RxDone): the ISR only flags them, service()
+    // does the SPI work from loop()
+    instance = this;
+    pinMode(LORA_DIO0, INPUT);
+    attachInterrupt(digitalPinToInterrupt(LORA_DIO0), handleDio0, RISING);
+
     Serial.println(F("SUCCESS: LoRa module initialized"));
     printConfig();
 
     return true;
 }
 
+void LoRaComm::enableRxInterrupt() {
+    rxInterruptMode = true;
+    listen();
+}
+
+void LoRaComm::setAddressFilter(uint8_t localAddress) {
+    filterAddress = localAddress;
+}
+
 bool LoRaComm::sendPacket(const uint8_t* data, size_t length) {
-    if (length == 0 || length > 255) {
+    return transmit(data, length, false);
+}
+
+bool LoRaComm::sendPacketAsync(const uint8_t* data, size_t length) {
+    return transmit(data, length, true);
+}
+
+bool LoRaComm::transmit(const uint8_t* data, size_t length, bool async) {
+    if (length == 0 || length > LORA_MAX_PACKET_LENGTH) {
         Serial.println(F("ERROR: Invalid packet length"));
         return false;
     }
 
+    // Charged up front: a packet the budget cannot cover is not sent at all
+    if (!dutyCycle.consume(getAirtimeUs(length))) {
+        Serial.println(F("ERROR: Duty cycle limit reached"));
+        return false;
+    }
+
+    // Only one packet can be on air at a time
+    waitTransmitDone();
+    cancelCad();
+
     // Begin packet
-    LoRa.beginPacket();
+    if (!LoRa.beginPacket()) {
+        Serial.println(F("ERROR: Radio busy"));
+        return false;
+    }
+
+    // beginPacket() left the radio in standby: switch to the TX channel
+    tune(txFrequency);
 
-    // Write data
-    LoRa.write(data, length);
+    // Write data (single burst into the FIFO)
+    fifo.writePacket(data, (uint8_t)length);
+
+    if (async) {
+        // Start TX and return; service() finishes up after TxDone
+        txStartTime = millis();
+        txBusy = true;
+        fifo.mapDio0(SX1278_DIO0_TX_DONE);
+        LoRa.endPacket(true);
+        return true;
+    }
 
     // End packet and transmit
-    if (!LoRa.endPacket()) {
+    bool sent = LoRa.endPacket();
+
+    // endPacket() leaves the radio in standby; go back to listening
+    tune(rxFrequency);
+    listen();
+
+    if (!sent) {
         Serial.println(F("ERROR: Packet transmission failed"));
         return false;
     }
@@ -115,28 +189,209 @@ bool LoRaComm::sendPacket(const uint8_t* data, size_t length) {
     return true;
 }
 
+void LORA_ISR_ATTR LoRaComm::handleDio0() {
+    // No SPI here: flags are read and packets drained by service()
+    if (instance != nullptr) {
+        instance->irqTime = millis();
+        instance->irqPending = true;
+    }
+}
+
+void LoRaComm::service() {
+    serviceCad();
+
+    if (!irqPending) {
+        return;
+    }
+
+    // Taken together: on AVR the ISR could land between the bytes of irqTime
+    noInterrupts();
+    irqPending = false;
+    unsigned long eventTime = irqTime;
+    interrupts();
+
+    // In polling mode RxDone belongs to parsePacket()
+    uint8_t mask = SX1278_IRQ_TX_DONE;
+    if (rxInterruptMode) {
+        mask |= SX1278_IRQ_RX_DONE | SX1278_IRQ_CRC_ERROR;
+    }
+    uint8_t flags = fifo.takeIrqFlags(mask);
+
+    if ((flags & SX1278_IRQ_TX_DONE) && txBusy) {
+        finishTransmit();
+        if (txDoneCallback != nullptr) {
+            txDoneCallback();
+        }
+    }
+
+    if (flags & SX1278_IRQ_RX_DONE) {
+        drainPacket(!(flags & SX1278_IRQ_CRC_ERROR), eventTime);
+    }
+
+    // An event raised while the flags were read keeps DIO0 high without
+    // a new edge: pick it up on the next call
+    if (digitalRead(LORA_DIO0) == HIGH) {
+        irqTime = millis();
+        irqPending = true;
+    }
+}
+
+void LoRaComm::drainPacket(bool crcOk, unsigned long rxTime) {
+    // The FIFO holds only the newest packet: packets the modem counted
+    // beyond it were overwritten before loop() got here. The counter
+    // restarts whenever the radio enters RX.
+    uint16_t count = fifo.rxPacketCount();
+    uint16_t arrived = (count >= rxPacketCount) ? count - rxPacketCount : count;
+    rxPacketCount = count;
+
+    if (arrived == 0) {
+        return;  // Already drained, or only a corrupted packet (not counted)
+    }
+
+    // With a CRC error in the mix there is no telling which packet is bad
+    if (!crcOk) {
+        rxDropped += arrived;
+        return;
+    }
+
+    // The edge came with the first packet: a later one arrived by now
+    rxDropped += arrived - 1;
+    storePacket(fifo.seekRxPacket(), (arrived == 1) ? rxTime : millis());
+}
+
+void LoRaComm::listen() {
+    if (!rxInterruptMode) {
+        return;
+    }
+    LoRa.receive();
+    rxPacketCount = fifo.rxPacketCount();
+}
+
+void LoRaComm::finishTransmit() {
+    txBusy = false;
+
+    // The radio drops to standby after TX; resume listening
+    tune(rxFrequency);
+    listen();
+}
+
 int LoRaComm::receivePacket(uint8_t* buffer, size_t maxLength) {
-    int packetSize = LoRa.parsePacket();
+    const RxPacket* packet = peek();
 
-    if (packetSize == 0) {
+    if (packet == nullptr) {
         return 0;  // No packet available
     }
 
-    // Store RSSI and SNR
-    lastRSSI = LoRa.packetRssi();
-    lastSNR = LoRa.packetSnr();
-
-    // Read packet data
-    int bytesRead = 0;
-    while (LoRa.available() && (size_t)bytesRead < maxLength) {
-        buffer[bytesRead++] = LoRa.read();
+    // Copy packet data
+    size_t bytesRead = packet->length;
+    if (bytesRead > maxLength) {
+        bytesRead = maxLength;
     }
+    memcpy(buffer, packet->data, bytesRead);
+
+    pop();
 
-    return bytesRead;
+    return (int)bytesRead;
 }
 
 bool LoRaComm::isPacketAvailable() {
-    return LoRa.parsePacket() > 0;
+    return peek() != nullptr;
+}
+
+const RxPacket* LoRaComm::peek() {
+    service();
+    if (!rxInterruptMode) {
+        pollRadio();
+    }
+
+    if (rxHead == rxTail) {
+        return nullptr;
+    }
+
+    return &rxRing[rxTail & (LORA_RX_RING_SLOTS - 1)];
+}
+
+void LoRaComm::pop() {
+    uint8_t tail = rxTail;
+    if (rxHead == tail) {
+        return;
+    }
+
+    // Store RSSI and SNR of the consumed packet
+    const RxPacket& packet = rxRing[tail & (LORA_RX_RING_SLOTS - 1)];
+    lastRSSI = packet.rssi;
+    lastSNR = packet.snr;
+
+    // Hand the slot back to the producer
+    rxTail = tail + 1;
+}
+
+const volatile bool* LoRaComm::getEventFlag() {
+    return &irqPending;
+}
+
+uint8_t LoRaComm::getRxPending() {
+    return (uint8_t)(rxHead - rxTail);
+}
+
+uint32_t LoRaComm::getRxDropped() {
+    return rxDropped;
+}
+
+uint32_t LoRaComm::getRxFiltered() {
+    return rxFiltered;
+}
+
+void LoRaComm::pollRadio() {
+    // parsePacket() switches the radio to RX and would cut a transmission
+    // or a CAD cycle short
+    if (txBusy || cadState == CAD_RUNNING) {
+        return;
+    }
+
+    int packetSize = LoRa.parsePacket();
+
+    if (packetSize > 0) {
+        storePacket(packetSize, millis());
+    }
+}
+
+void LoRaComm::storePacket(int packetSize, unsigned long rxTime) {
+    uint8_t head = rxHead;
+    uint8_t length = (packetSize > LORA_MAX_PACKET_LENGTH) ? LORA_MAX_PACKET_LENGTH : (uint8_t)packetSize;
+
+    // Address filter: read the header only and leave other nodes' frames in the FIFO
+    uint8_t header[MSG_HEADER_PEEK_SIZE];
+    uint8_t headerLength = 0;
+    if (filterAddress != MSG_ADDR_NONE) {
+        headerLength = fifo.readFifo(header, (length < MSG_HEADER_PEEK_SIZE) ? length : MSG_HEADER_PEEK_SIZE);
+        if (!MessageProtocol::acceptsHeader(header, headerLength, filterAddress)) {
+            rxFiltered++;
+            return;
+        }
+    }
+
+    // Ring full: leave the packet in the FIFO, it is overwritten by the next one
+    if ((uint8_t)(head - rxTail) >= LORA_RX_RING_SLOTS) {
+        rxDropped++;
+        return;
+    }
+
+    RxPacket& slot = rxRing[head & (LORA_RX_RING_SLOTS - 1)];
+
+    // Read packet data (single burst from the FIFO, after the header if peeked)
+    memcpy(slot.data, header, headerLength);
+    slot.length = headerLength + fifo.readPacket(&slot.data[headerLength], length - headerLength);
+    slot.rssi = LoRa.packetRssi();
+    slot.snr = LoRa.packetSnr();
+    slot.timestamp = rxTime;
+
+    // Publish the slot to the consumer
+    rxHead = head + 1;
+
+    if (rxDoneCallback != nullptr) {
+        rxDoneCallback();
+    }
 }
 
 int LoRaComm::getRSSI() {
@@ -147,39 +402,235 @@ float LoRaComm::getSNR() {
     return lastSNR;
 }
 
+uint16_t LoRaComm::randomWord() {
+    return ((uint16_t)LoRa.random() << 8) | LoRa.random();
+}
+
 bool LoRaComm::isTransmitting() {
-    // Note: arduino-LoRa library doesn't expose this directly
-    // For now, we return false (blocking transmission mode)
-    return false;
+    service();
+    if (txBusy && millis() - txStartTime > LORA_TX_TIMEOUT_MS) {
+        // TxDone never arrived (DIO0 not wired?) - recover the radio
+        Serial.println(F("ERROR: TX done interrupt timeout"));
+        LoRa.idle();
+        finishTransmit();
+    }
+    return txBusy;
+}
+
+void LoRaComm::waitTransmitDone() {
+    while (isTransmitting()) {
+        yield();
+    }
+}
+
+void LoRaComm::onTxDone(void (*callback)()) {
+    txDoneCallback = callback;
+}
+
+void LoRaComm::onRxDone(void (*callback)()) {
+    rxDoneCallback = callback;
+}
+
+bool LoRaComm::applySettings(const RadioSettings& newSettings) {
+    if (!isValidSettings(newSettings)) {
+        return false;
+    }
+
+    // Modem registers are only written outside RX/TX
+    waitTransmitDone();
+    cancelCad();
+    LoRa.idle();
+
+    // The LoRa library also sets low data rate optimization from SF and bandwidth
+    LoRa.setSpreadingFactor(newSettings.spreadingFactor);
+    LoRa.setSignalBandwidth(newSettings.bandwidth);
+    LoRa.setTxPower(newSettings.txPower);
+    settings = newSettings;
+
+    listen();
+    return true;
+}
+
+const RadioSettings& LoRaComm::getSettings() {
+    return settings;
+}
+
+void LoRaComm::setRxFrequency(long frequency) {
+    rxFrequency = frequency;
+
+    // While on air (or sensing) the radio retunes once it is done
+    if (isTransmitting() || cadState == CAD_RUNNING || tunedFrequency == frequency) {
+        return;
+    }
+
+    LoRa.idle();
+    tune(frequency);
+    listen();
+}
+
+void LoRaComm::setTxFrequency(long frequency) {
+    txFrequency = frequency;
 }
 
-void LoRaComm::onReceive(void (*callback)(int)) {
-    LoRa.onReceive(callback);
+void LoRaComm::tune(long frequency) {
+    if (tunedFrequency != frequency) {
+        LoRa.setFrequency(frequency);
+        tunedFrequency = frequency;
+    }
+}
+
+bool LoRaComm::isValidSettings(const RadioSettings& candidate) {
+    return candidate.spreadingFactor >= 7 && candidate.spreadingFactor <= 12 &&
+           candidate.bandwidth >= 7800 && candidate.bandwidth <= 500000 &&
+           candidate.txPower >= 2 && candidate.txPower <= 20;
+}
+
+uint32_t LoRaComm::getAirtimeUs(size_t length) {
+    return loraTimeOnAirUs(length, settings.spreadingFactor, settings.bandwidth, LORA_CODING_RATE,
+                           LORA_PREAMBLE_LENGTH, LORA_PAYLOAD_CRC, LORA_IMPLICIT_HEADER,
+                           loraLowDataRateOptimize(settings.spreadingFactor, settings.bandwidth));
+}
+
+unsigned long LoRaComm::getTxDelay(size_t length) {
+    return dutyCycle.getDelay(getAirtimeUs(length));
+}
+
+DutyCycle& LoRaComm::getDutyCycle() {
+    return dutyCycle;
+}
+
+void LoRaComm::setListenBeforeTalk(bool enabled) {
+    lbt.setEnabled(enabled);
+}
+
+unsigned long LoRaComm::checkChannel(size_t length) {
+    if (!lbt.isEnabled()) {
+        return 0;
+    }
+
+    // CAD under way: come back once it should be done
+    serviceCad();
+    if (cadState == CAD_RUNNING) {
+        return 1;
+    }
+
+    // One slot is about the airtime of the frame waiting to go
+    unsigned long slotMs = getAirtimeUs(length) / 1000 + 1;
+
+    // A result is taken by the call that follows the cycle; one left
+    // over from a frame that went away meanwhile is out of date
+    if (cadState != CAD_IDLE) {
+        bool busy = (cadState == CAD_BUSY);
+        bool fresh = millis() - cadStart <= 2 * cadTimeoutMs;
+        cadState = CAD_IDLE;
+        if (fresh) {
+            return lbt.next(busy, slotMs);
+        }
+    }
+
+    // Still backing off: the channel is not sensed again before the slot
+    unsigned long wait = lbt.getBackoff();
+    if (wait > 0) {
+        return wait;
+    }
+
+    // Only one radio operation at a time
+    if (txBusy) {
+        return 1;
+    }
+
+    // A packet being received is activity already; CAD would cut it off
+    if (fifo.signalDetected()) {
+        return lbt.next(true, slotMs);
+    }
+
+    // CAD lasts under two symbols; allow four before reading it as clear
+    uint32_t symbolUs = loraQuarterSymbolUs(settings.spreadingFactor, settings.bandwidth) * 4;
+    cadTimeoutMs = (symbolUs * 4 + 1000) / 1000 + 1;
+
+    // Sense the channel the packet will go out on; serviceCad() goes
+    // back to listening once the cycle is over
+    LoRa.idle();
+    tune(txFrequency);
+    fifo.startCad();
+    cadState = CAD_RUNNING;
+    cadStart = millis();
+    return (symbolUs * 2) / 1000 + 1;
+}
+
+void LoRaComm::serviceCad() {
+    if (cadState != CAD_RUNNING) {
+        return;
+    }
+
+    // CAD not done in time reads as a clear channel
+    uint8_t flags = fifo.takeIrqFlags(SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED);
+    if (!(flags & SX1278_IRQ_CAD_DONE) && millis() - cadStart <= cadTimeoutMs) {
+        return;
+    }
+    cadState = (flags & SX1278_IRQ_CAD_DETECTED) ? CAD_BUSY : CAD_CLEAR;
+
+    // The radio drops to standby after CAD (idle() stops an overdue one)
+    LoRa.idle();
+    tune(rxFrequency);
+    listen();
+}
+
+void LoRaComm::cancelCad() {
+    if (cadState == CAD_RUNNING) {
+        LoRa.idle();
+        fifo.takeIrqFlags(SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED);
+        tune(rxFrequency);
+    }
+    cadState = CAD_IDLE;
+}
+
+ListenBeforeTalk& LoRaComm::getListenBeforeTalk() {
+    return lbt;
+}
+
+const SpiStats& LoRaComm::getSpiStats() {
+    return fifo.getStats();
 }
 
 void LoRaComm::printConfig() {
     Serial.println(F("--- LoRa Configuration ---"));
     Serial.print(F("Frequency: "));
-    Serial.print(LORA_FREQUENCY / 1E6);
-    Serial.println(F(" MHz"));
+    Serial.print(rxFrequency / 1E6);
+    Serial.print(F(" MHz"));
+    if (txFrequency != rxFrequency) {
+        Serial.print(F(", TX "));
+        Serial.print(txFrequency / 1E6);
+        Serial.print(F(" MHz"));
+    }
+    Serial.println();
 
     Serial.print(F("Spreading Factor: SF"));
-    Serial.println(LORA_SPREADING_FACTOR);
+    Serial.println(settings.spreadingFactor);
 
     Serial.print(F("Bandwidth: "));
-    Serial.print(LORA_SIGNAL_BANDWIDTH / 1E3);
+    Serial.print(settings.bandwidth / 1E3);
     Serial.println(F(" kHz"));
 
     Serial.print(F("Coding Rate: 4/"));
     Serial.println(LORA_CODING_RATE);
 
     Serial.print(F("TX Power: "));
-    Serial.print(LORA_TX_POWER);
+    Serial.print(settings.txPower);
     Serial.println(F(" dBm"));
 
     Serial.print(F("Sync Word: 0x"));
     Serial.println(LORA_SYNC_WORD, HEX);
 
+    Serial.print(F("Airtime (255 bytes): "));
+    Serial.print(getAirtimeUs(LORA_MAX_PACKET_LENGTH) / 1000.0, 1);
+    Serial.print(F(" ms, duty cycle "));
+    Serial.print(DUTY_CYCLE_PERMILLE / 10.0, 1);
+    Serial.println(F("%"));
+
+    Serial.print(F("Listen before talk: "));
+    Serial.println(lbt.isEnabled() ? F("on (CAD)") : F("off"));
+
     Serial.print(F("Pins - NSS: "));
     Serial.print(LORA_NSS);
     Serial.print(F(", DIO0: "));
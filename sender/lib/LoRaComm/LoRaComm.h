@@ -3,6 +3,43 @@
 
 #include <Arduino.h>
 #include <LoRa.h>
+#include "SX1278Fifo.h"
+#include "DutyCycle.h"
+#include "ListenBeforeTalk.h"
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Largest payload the SX1278 FIFO can hold
+#define LORA_MAX_PACKET_LENGTH 255
+
+// Longest a transmission may stay on air before it is considered lost
+// (SF12 / 125 kHz / 255 bytes is roughly 9 s)
+#define LORA_TX_TIMEOUT_MS 12000
+
+// Number of packet slots in the RX ring (must be a power of two)
+#ifndef LORA_RX_RING_SLOTS
+    #define LORA_RX_RING_SLOTS 4
+#endif
+
+static_assert((LORA_RX_RING_SLOTS & (LORA_RX_RING_SLOTS - 1)) == 0 && LORA_RX_RING_SLOTS <= 128,
+              "LORA_RX_RING_SLOTS must be a power of two <= 128");
+
+// Radio settings that may change at run time (adaptive data rate).
+// Everything else (coding rate, preamble, sync word) stays as configured.
+struct RadioSettings {
+    uint8_t spreadingFactor;  // 7-12
+    uint32_t bandwidth;       // Hz, 7800-500000
+    int8_t txPower;           // dBm, 2-20
+};
+
+// One received packet as drained from the SX1278 FIFO
+struct RxPacket {
+    uint8_t data[LORA_MAX_PACKET_LENGTH];
+    uint8_t length;
+    int16_t rssi;
+    float snr;
+    unsigned long timestamp;  // millis() at the RxDone edge (interrupt mode), else when drained
+};
 
 class LoRaComm {
 public:
@@ -11,27 +48,120 @@ public:
     // Initialize LoRa module with board-specific pins
     bool begin();
 
-    // Send raw packet data
+    // Switch to DIO0 RxDone interrupt mode: the ISR flags each packet and
+    // the next peek() drains it from the FIFO into the RX ring. Without
+    // this, the ring is filled by polling.
+    void enableRxInterrupt();
+
+    // Drop frames addressed to other nodes after reading only their header
+    // (no payload transfer, no checksum). MSG_ADDR_NONE accepts everything.
+    void setAddressFilter(uint8_t localAddress);
+
+    // Send raw packet data (blocks until the packet is on air and done).
+    // Both send calls refuse packets over the duty-cycle budget.
     bool sendPacket(const uint8_t* data, size_t length);
 
+    // Send raw packet data and return as soon as it is in the FIFO.
+    // Completion is signalled by the DIO0 TxDone interrupt and handled
+    // in isTransmitting(), see also onTxDone(). The data buffer may be reused
+    // immediately. Waits only if a previous transmission is still on air.
+    bool sendPacketAsync(const uint8_t* data, size_t length);
+
     // Receive packet data (non-blocking)
+    // Copies and removes the oldest buffered packet
     // Returns number of bytes received, 0 if no packet
     int receivePacket(uint8_t* buffer, size_t maxLength);
 
-    // Check if a packet is available
+    // Check if a packet is available (does not consume it)
     bool isPacketAvailable();
 
+    // Oldest buffered packet without removing it, nullptr if none
+    const RxPacket* peek();
+
+    // Release the packet returned by peek()
+    void pop();
+
+    // Set by the DIO0 interrupt until loop() has handled the event
+    // (pass to Scheduler::wakeOn())
+    const volatile bool* getEventFlag();
+
+    // Number of packets waiting in the RX ring
+    uint8_t getRxPending();
+
+    // Number of packets lost: RX ring full, or overwritten in the FIFO
+    // by a later packet before loop() drained them (interrupt mode)
+    uint32_t getRxDropped();
+
+    // Number of frames rejected by the address filter
+    uint32_t getRxFiltered();
+
     // Get signal strength of last received packet
     int getRSSI();
 
     // Get signal-to-noise ratio of last received packet
     float getSNR();
 
-    // Check if currently transmitting
+    // Random value from wideband RSSI noise, differs per boot
+    // (e.g. a first message ID the peer cannot mistake for an old one)
+    uint16_t randomWord();
+
+    // Check if an asynchronous transmission is still on air. Finishes a
+    // completed one (retune, resume RX), so call it from loop().
     bool isTransmitting();
 
-    // Set receive callback (interrupt-driven)
-    void onReceive(void (*callback)(int));
+    // Block until the current asynchronous transmission has finished
+    void waitTransmitDone();
+
+    // Set TX complete callback (runs from isTransmitting()/peek() in loop())
+    void onTxDone(void (*callback)());
+
+    // Set RX callback, run once a packet has been stored in the RX ring
+    // (from peek() in loop())
+    void onRxDone(void (*callback)());
+
+    // Switch spreading factor, bandwidth and TX power. Waits for a
+    // transmission on air, then resumes listening. False if out of range.
+    bool applySettings(const RadioSettings& settings);
+
+    // Settings in use
+    const RadioSettings& getSettings();
+
+    // Listen on this frequency (Hz), from now or once the transmission on
+    // air has ended. Default LORA_FREQUENCY.
+    void setRxFrequency(long frequency);
+
+    // Send (and sense the channel) on this frequency (Hz); the radio goes
+    // back to the RX frequency after each packet. Default LORA_FREQUENCY.
+    void setTxFrequency(long frequency);
+
+    // True if the radio supports these settings
+    static bool isValidSettings(const RadioSettings& settings);
+
+    // Time on air of a packet of this length with the current settings (us)
+    uint32_t getAirtimeUs(size_t length);
+
+    // ms until a packet of this length fits the duty-cycle budget, 0 if
+    // it may go now. Queue the packet meanwhile instead of sending it.
+    unsigned long getTxDelay(size_t length);
+
+    // Cumulative airtime and budget counters
+    DutyCycle& getDutyCycle();
+
+    // Run CAD before each transmission (default: LBT_ENABLED)
+    void setListenBeforeTalk(bool enabled);
+
+    // Sense the channel before sending a packet of this length: 0 if it
+    // is clear, ms to back off while it is busy (keep the packet queued),
+    // LBT_GIVE_UP once it has been busy for LBT_MAX_WAIT_MS (drop it).
+    // Always 0 with listen before talk off. Does not block: the first call
+    // starts CAD and returns its duration, a call after that takes the result.
+    unsigned long checkChannel(size_t length);
+
+    // Channel sensing and backoff counters
+    ListenBeforeTalk& getListenBeforeTalk();
+
+    // SPI traffic used to move packet data (transactions/bytes/packets)
+    const SpiStats& getSpiStats();
 
     // Get current configuration info
     void printConfig();
@@ -39,6 +169,89 @@ public:
 private:
     int lastRSSI;
     float lastSNR;
+
+    // Burst FIFO access (one SPI transaction per packet)
+    SX1278Fifo fifo;
+
+    // Airtime budget in front of every transmission
+    DutyCycle dutyCycle;
+
+    // CAD backoff in front of every transmission
+    ListenBeforeTalk lbt;
+
+    // Current spreading factor, bandwidth and TX power
+    RadioSettings settings;
+
+    // Channels for listening and sending, and the one the radio is on
+    long rxFrequency;
+    long txFrequency;
+    long tunedFrequency;
+
+    // Single-producer (service or poll) / single-consumer (peek/pop) packet ring.
+    // Head and tail are free-running counters, masked on access.
+    RxPacket rxRing[LORA_RX_RING_SLOTS];
+    // Filled from loop() only, so no interrupt guards are needed.
+    uint8_t rxHead;
+    uint8_t rxTail;
+    uint32_t rxDropped;
+    uint32_t rxFiltered;
+    uint16_t rxPacketCount;  // Modem's valid packet count already accounted for
+    uint8_t filterAddress;
+    bool rxInterruptMode;
+
+    // The only state shared with the DIO0 ISR
+    volatile bool irqPending;
+    volatile unsigned long irqTime;  // millis() of the last DIO0 edge
+
+    // Channel activity detection in progress, or its result not yet
+    // taken by checkChannel()
+    enum CadState : uint8_t { CAD_IDLE, CAD_RUNNING, CAD_CLEAR, CAD_BUSY };
+    CadState cadState;
+    unsigned long cadStart;
+    unsigned long cadTimeoutMs;
+
+    // Asynchronous transmit state
+    bool txBusy;
+    unsigned long txStartTime;
+    void (*txDoneCallback)();
+    void (*rxDoneCallback)();
+
+    static LoRaComm* instance;
+
+    // Common transmit path for blocking and asynchronous sends
+    bool transmit(const uint8_t* data, size_t length, bool async);
+
+    // Retune the radio if it is not on this frequency (outside RX/TX)
+    void tune(long frequency);
+
+    // DIO0 interrupt: flags the event and notes its time, nothing else
+    static void handleDio0();
+
+    // Read and clear the IRQ flags after a DIO0 event: finish a
+    // transmission, drain a received packet (from loop())
+    void service();
+
+    // Take the packet behind an RxDone raised at rxTime (unless corrupted),
+    // counting any the FIFO lost before it in rxDropped
+    void drainPacket(bool crcOk, unsigned long rxTime);
+
+    // Back to RX continuous in interrupt mode, with the packet count it starts from
+    void listen();
+
+    // Back to the RX channel and listening once a packet is out
+    void finishTransmit();
+
+    // Pick up a finished (or overdue) CAD cycle, then resume listening
+    void serviceCad();
+
+    // Stop a CAD cycle still running (before TX or a settings change)
+    void cancelCad();
+
+    // Poll the radio and move a pending packet into the ring
+    void pollRadio();
+
+    // Copy the packet currently in the FIFO into the next free slot
+    void storePacket(int packetSize, unsigned long rxTime);
 };
 
 #endif // LORA_COMM_H
@@ -0,0 +1,97 @@
+#ifndef SX1278_FIFO_H
+#define SX1278_FIFO_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+// SPI clock used for SX1278 register access (matches the LoRa library)
+#define SX1278_SPI_FREQUENCY 8E6
+
+// RegIrqFlags bits (cleared by writing 1)
+#define SX1278_IRQ_RX_DONE 0x40
+#define SX1278_IRQ_CRC_ERROR 0x20
+#define SX1278_IRQ_TX_DONE 0x08
+#define SX1278_IRQ_CAD_DONE 0x04
+#define SX1278_IRQ_CAD_DETECTED 0x01
+
+// DIO0 functions (RegDioMapping1 bits 7-6)
+#define SX1278_DIO0_RX_DONE 0x00
+#define SX1278_DIO0_TX_DONE 0x40
+#define SX1278_DIO0_CAD_DONE 0x80
+
+// SPI traffic generated by this layer
+struct SpiStats {
+    uint32_t transactions;  // Chip-select assertions
+    uint32_t bytes;         // Bytes clocked, including address bytes
+    uint32_t packets;       // Packets moved through the FIFO
+};
+
+// Direct SX1278 FIFO access with one burst transfer per packet.
+//
+// The LoRa library moves packet data one byte per SPI transaction
+// (LoRa.read()/LoRa.write()). This class reads or writes the whole
+// packet through RegFifo with a single chip-select window.
+class SX1278Fifo {
+public:
+    SX1278Fifo();
+
+    // Set chip-select pin and SPI bus (bus must already be initialized)
+    void begin(int nssPin, SPIClass& spi = SPI);
+
+    // Read the packet the radio just received.
+    // RegFifoAddrPtr must already point at the packet (seekRxPacket(),
+    // or the LoRa library's parsePacket()).
+    // Returns number of bytes read
+    uint8_t readPacket(uint8_t* buffer, uint8_t length);
+
+    // Read bytes from the current FIFO position without counting a packet.
+    // The pointer advances, so a following readPacket() continues after them
+    // (used to inspect a header before deciding to read the rest).
+    uint8_t readFifo(uint8_t* buffer, uint8_t length);
+
+    // Load a packet into the FIFO and set RegPayloadLength.
+    // Call between LoRa.beginPacket() and LoRa.endPacket().
+    void writePacket(const uint8_t* data, uint8_t length);
+
+    // True while the modem is locked on a packet (preamble or header
+    // found). That counts as activity: CAD would cut the packet off.
+    bool signalDetected();
+
+    // Start one channel activity detection cycle (about two symbols) and
+    // return. The radio drops to standby once done: poll the result with
+    // takeIrqFlags(SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED).
+    void startCad();
+
+    // Point RegFifoAddrPtr at the last packet received; returns its length
+    uint8_t seekRxPacket();
+
+    // Valid packets received since the radio last entered RX mode
+    // (RegRxPacketCntValue). The FIFO keeps only the last one: a count
+    // that moved by more than one per RxDone means packets were lost.
+    uint16_t rxPacketCount();
+
+    // Read the IRQ flags and clear those in mask, leaving the rest set
+    // for their owner. Returns the flags cleared.
+    uint8_t takeIrqFlags(uint8_t mask);
+
+    // Route an event to the DIO0 pin (SX1278_DIO0_*)
+    void mapDio0(uint8_t function);
+
+    // Single register access
+    uint8_t readRegister(uint8_t address);
+    void writeRegister(uint8_t address, uint8_t value);
+
+    // SPI transaction/byte counters
+    const SpiStats& getStats();
+    void resetStats();
+
+private:
+    int nss;
+    SPIClass* spi;
+    SpiStats stats;
+
+    void select();
+    void deselect();
+};
+
+#endif // SX1278_FIFO_H
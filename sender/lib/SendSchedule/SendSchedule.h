@@ -0,0 +1,81 @@
+#ifndef SEND_SCHEDULE_H
+#define SEND_SCHEDULE_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Random offset added to each send within its period (ms, 0 = none)
+#ifndef SEND_JITTER_MS
+    #define SEND_JITTER_MS 1000
+#endif
+
+// 1 = send in a slot derived from the short address once joined
+#ifndef SEND_SLOTTED
+    #define SEND_SLOTTED 0
+#endif
+
+// Gap between slots on top of the frame's airtime (ms)
+#ifndef SEND_SLOT_GUARD_MS
+    #define SEND_SLOT_GUARD_MS 20
+#endif
+
+// getSlot() result outside slotted mode
+#define SEND_NO_SLOT 0xFF
+
+// When the next periodic send goes out.
+//
+// A fixed grid from boot keeps nodes that power up together in lockstep,
+// colliding every period. Jitter mode starts the grid at a random phase
+// and adds a fresh random offset of up to SEND_JITTER_MS to every send,
+// so two nodes that collide once are unlikely to collide again. Slotted
+// mode cuts the period into slots one frame (plus guard) long and sends
+// in slot 1 + (address - first node address) modulo the rest, so joined
+// nodes with consecutive addresses never overlap. Periods start at the
+// receiver's MSG_BEACON (slot 0 is left for it); without beacons they
+// run on the local clock and drift slowly blurs the slots. Slotted mode
+// falls back to jitter until an address and an airtime are known.
+class SendSchedule {
+public:
+    SendSchedule(unsigned long periodMs);
+
+    // Seed the jitter from something unique to the node (its name), so
+    // nodes started at the same moment draw different offsets
+    void begin(const char* nodeName);
+
+    // Slotted mode: short address (MSG_ADDR_NONE: not joined yet)
+    void setAddress(uint8_t address);
+
+    // Airtime of a frame just sent; the slot is as long as the widest one
+    void recordAirtime(uint32_t airtimeUs);
+
+    // A period started at this millis() (beacon received). Ignored if the
+    // beacon's period differs from ours; false then.
+    bool sync(unsigned long periodStart, unsigned long periodMs);
+
+    // ms from now until the next send (call once per send)
+    unsigned long next();
+
+    // Current slot and slot count, SEND_NO_SLOT if not slotted
+    uint8_t getSlot();
+    uint8_t getSlotCount();
+
+    // Print mode, slot, sync and jitter
+    void printStats();
+
+private:
+    unsigned long period;
+    unsigned long cycleStart;   // Start of the current period
+    bool started;               // Jitter grid running
+    bool slotted;               // Last send was in an address slot
+    unsigned long phase;        // Period boundary offset from the last beacon
+    bool synced;
+    uint8_t address;
+    uint32_t airtimeMs;         // Widest frame sent so far
+    uint32_t rng;
+
+    uint32_t nextRandom(uint32_t range);
+    unsigned long slotLength();
+};
+
+#endif // SEND_SCHEDULE_H
@@ -0,0 +1,142 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <Arduino.h>
+#include "MessageProtocol.h"
+#include "board_config.h"
+
+// Frames waiting for the radio, all classes together
+#ifndef TX_QUEUE_SLOTS
+    #define TX_QUEUE_SLOTS 4
+#endif
+
+// Frames one class may have queued at once
+#ifndef TX_QUEUE_CLASS_DEPTH
+    #define TX_QUEUE_CLASS_DEPTH TX_QUEUE_SLOTS
+#endif
+
+// Bytes copied per slot. Longer frames can only be queued by reference.
+#ifndef TX_QUEUE_FRAME_SIZE
+    #define TX_QUEUE_FRAME_SIZE MSG_MAX_PACKET_SIZE
+#endif
+
+// Time-to-live for frames that never go stale
+#define TX_TTL_NONE 0
+
+static_assert(TX_QUEUE_SLOTS >= 1 && TX_QUEUE_SLOTS <= 255, "TX_QUEUE_SLOTS must be between 1 and 255");
+static_assert(TX_QUEUE_CLASS_DEPTH >= 1 && TX_QUEUE_CLASS_DEPTH <= TX_QUEUE_SLOTS,
+              "TX_QUEUE_CLASS_DEPTH must be between 1 and TX_QUEUE_SLOTS");
+
+// Priority classes, highest first
+enum TxClass {
+    TX_CLASS_CONTROL = 0,  // ACKs, join handshake
+    TX_CLASS_ALARM,        // Urgent application data (commands, alerts)
+    TX_CLASS_TELEMETRY,    // Sensor readings, stale after their TTL
+    TX_CLASS_BULK,         // Text and anything else that can wait
+    TX_CLASS_COUNT
+};
+
+// One queued frame
+struct TxEntry {
+    uint8_t data[TX_QUEUE_FRAME_SIZE];  // Copied frame
+    const uint8_t* frame;               // data, or a caller-owned buffer
+    uint8_t length;
+    uint8_t txClass;
+    uint8_t tag;                        // Caller's routing info (radio module, frame owner)
+    bool expires;
+    unsigned long deadline;             // millis() after which the frame is dropped
+};
+
+// Prioritized TX queue in front of the radio.
+//
+// Frames wait in bounded per-class FIFOs and leave in strict priority
+// order, so an ACK never queues behind bulk data: its wait is at most
+// the frame already on air. Telemetry given a time-to-live is dropped
+// once stale instead of going out late. When every slot is taken, a new
+// frame preempts the newest frame of the lowest class below its own.
+// Slots come from a fixed pool like the RX inbox.
+class TxQueue {
+public:
+    TxQueue();
+
+    // Buffer of TX_QUEUE_FRAME_SIZE bytes to encode the next frame of this
+    // class into, nullptr (counted as dropped) if the class is full or no
+    // slot can be freed. Queue it with commit().
+    uint8_t* reserve(TxClass txClass);
+
+    // Queue the frame encoded into reserve(). A length of 0 cancels.
+    bool commit(size_t length, unsigned long ttlMs = TX_TTL_NONE, uint8_t tag = 0);
+
+    // Copy a frame into the queue
+    bool enqueue(TxClass txClass, const uint8_t* frame, size_t length,
+                 unsigned long ttlMs = TX_TTL_NONE, uint8_t tag = 0);
+
+    // Queue a frame by reference: the buffer must stay unchanged until
+    // the frame is sent, dropped or cancelled (e.g. an ARQ window slot)
+    bool enqueueRef(TxClass txClass, const uint8_t* frame, size_t length,
+                    unsigned long ttlMs = TX_TTL_NONE, uint8_t tag = 0);
+
+    // Highest-priority frame still within its TTL, nullptr if none.
+    // Stale frames met on the way are dropped and counted as expired.
+    const TxEntry* peek();
+
+    // Remove the frame returned by peek() (after sending it)
+    void pop();
+
+    // Withdraw every queued reference to this buffer, returns number removed
+    uint8_t cancel(const uint8_t* frame);
+
+    // Called for each frame dropped after it was queued (expired or
+    // preempted), so the owner of a referenced buffer can react
+    void onDrop(void (*callback)(const TxEntry& entry));
+
+    // Occupancy
+    uint8_t getDepth(TxClass txClass);
+    uint8_t getCount();
+    bool isEmpty();
+
+    // Frames refused or preempted, and frames dropped as stale, per class
+    uint32_t getDropped(TxClass txClass);
+    uint32_t getExpired(TxClass txClass);
+
+    // Class name for logs
+    static const char* getClassName(uint8_t txClass);
+
+    // Print depth and drop counters per class
+    void printStats();
+
+private:
+    TxEntry pool[TX_QUEUE_SLOTS];
+
+    // Free slots (stack of pool indices)
+    uint8_t freeSlots[TX_QUEUE_SLOTS];
+    uint8_t freeCount;
+
+    // Queued slots per class in FIFO order (rings of pool indices)
+    uint8_t queue[TX_CLASS_COUNT][TX_QUEUE_CLASS_DEPTH];
+    uint8_t queueHead[TX_CLASS_COUNT];
+    uint8_t queueCount[TX_CLASS_COUNT];
+
+    uint32_t dropped[TX_CLASS_COUNT];
+    uint32_t expired[TX_CLASS_COUNT];
+
+    // Slot handed out by reserve(), not yet queued
+    uint8_t reserved;
+    uint8_t reservedClass;
+
+    // Class of the frame returned by peek()
+    uint8_t peekClass;
+
+    void (*dropCallback)(const TxEntry& entry);
+
+    // Take a free slot for this class, preempting lower classes if needed
+    bool allocate(uint8_t txClass, uint8_t& index);
+
+    // Append a filled slot to its class FIFO
+    void push(uint8_t index, uint8_t txClass, size_t length, unsigned long ttlMs, uint8_t tag);
+
+    // Remove the entry at position pos of a class FIFO, returning its slot
+    void removeAt(uint8_t txClass, uint8_t pos);
+};
+
+#endif // TX_QUEUE_H
@@ -2,20 +2,42 @@
 #include "LoRaComm.h"
 #include "MessageProtocol.h"
 #include "DummySensors.h"
+#include "Scheduler.h"
+#include "TxQueue.h"
+#include "SendSchedule.h"
+#include "ChannelHopper.h"
 #include "board_config.h"
 
 // ===== Global Objects =====
 LoRaComm loraComm;
 MessageProtocol protocol;
 DummySensors sensors;
+Scheduler scheduler;
+TxQueue txQueue;
 
 // ===== Configuration =====
 const unsigned long SEND_INTERVAL = 5000;  // Send every 5 seconds
-unsigned long lastSendTime = 0;
+SendSchedule sendSchedule(SEND_INTERVAL);  // Jitter or address slot within each interval
+uint8_t sendTask = SCHEDULER_NO_TASK;
+ChannelHopper hopper;  // Uplink channel per period (HOP_ENABLED), clock from the beacon
 uint8_t currentSensor = SENSOR_TEMPERATURE;  // Start with temperature
 
-// ===== Buffer =====
-uint8_t txBuffer[MSG_MAX_PACKET_SIZE];
+// ===== Snapshot =====
+// Sensors included in each MSG_SENSOR_BATCH frame
+const uint8_t SNAPSHOT_SENSORS[] = {SENSOR_TEMPERATURE, SENSOR_HUMIDITY, SENSOR_BATTERY, SENSOR_PRESSURE};
+const uint8_t SNAPSHOT_COUNT = sizeof(SNAPSHOT_SENSORS);
+
+// ===== Join State =====
+uint8_t shortAddr = MSG_ADDR_NONE;  // Assigned by the receiver's MSG_JOIN_ACCEPT
+uint8_t joinTask = SCHEDULER_NO_TASK;  // Retries the join request until accepted
+
+// ===== Function Prototypes =====
+void sendSensorData();
+void sendSnapshot();
+void sendNextSensor();
+void sendJoinRequest();
+void checkJoinReplies();
+unsigned long pumpTxQueue();
 
 void setup() {
     // Initialize Serial
@@ -44,6 +66,12 @@ void setup() {
         }
     }
 
+    // Listen between transmissions for join replies
+    loraComm.enableRxInterrupt();
+
+    // Radio events (flagged by the DIO0 interrupt) end the idle sleep in loop()
+    scheduler.wakeOn(loraComm.getEventFlag());
+
     // Initialize sensors
     sensors.begin();
     Serial.println(F("Dummy sensors initialized"));
@@ -53,71 +81,264 @@ void setup() {
     Serial.println(F("  System Ready - Transmitting"));
     Serial.println(F("===================================="));
     Serial.println(F("Sending sensor data every 5 seconds..."));
-    Serial.println(F("Rotating: Temp → Humid → Bat → Pressure"));
+    sendSchedule.printStats();
+    hopper.printStats();
+    if (SEND_SNAPSHOT) {
+        Serial.println(F("Snapshot: Temp + Humid + Bat + Pressure per packet"));
+    } else {
+        Serial.println(F("Rotating: Temp → Humid → Bat → Pressure"));
+    }
     Serial.println(F("===================================="));
     Serial.println();
+
+    // Short address: ask now, then retry until the receiver assigns one
+    joinTask = scheduler.every(JOIN_RETRY_INTERVAL_MS, sendJoinRequest, true);
+
+    // Not on a fixed grid from boot: nodes powered up together would
+    // collide on every send
+    sendSchedule.begin(DEVICE_NAME);
+    sendTask = scheduler.after(sendSchedule.next(), sendSensorData);
 }
 
 void loop() {
-    unsigned long currentTime = millis();
-
-    // Send sensor data at interval
-    if (currentTime - lastSendTime >= SEND_INTERVAL) {
-        lastSendTime = currentTime;
-
-        // Read sensor
-        float value;
-        const char* unit;
-        const char* name;
-        uint8_t sensorToSend = currentSensor;  // Save current sensor ID before updating
-
-        switch (currentSensor) {
-            case SENSOR_TEMPERATURE:
-                value = sensors.readTemperature();
-                unit = sensors.getSensorUnit(SENSOR_TEMPERATURE);
-                name = sensors.getSensorName(SENSOR_TEMPERATURE);
-                currentSensor = SENSOR_HUMIDITY;  // Next sensor
-                break;
-            case SENSOR_HUMIDITY:
-                value = sensors.readHumidity();
-                unit = sensors.getSensorUnit(SENSOR_HUMIDITY);
-                name = sensors.getSensorName(SENSOR_HUMIDITY);
-                currentSensor = SENSOR_BATTERY;
-                break;
-            case SENSOR_BATTERY:
-                value = sensors.readBatteryVoltage();
-                unit = sensors.getSensorUnit(SENSOR_BATTERY);
-                name = sensors.getSensorName(SENSOR_BATTERY);
-                currentSensor = SENSOR_PRESSURE;
-                break;
-            case SENSOR_PRESSURE:
-                value = sensors.readPressure();
-                unit = sensors.getSensorUnit(SENSOR_PRESSURE);
-                name = sensors.getSensorName(SENSOR_PRESSURE);
-                currentSensor = SENSOR_TEMPERATURE;  // Loop back
-                break;
-            default:
-                currentSensor = SENSOR_TEMPERATURE;
-                return;
-        }
+    checkJoinReplies();
+    scheduler.run();
+
+    // Hand the next frame to the radio once the previous one is done
+    unsigned long txWait = pumpTxQueue();
+
+    // Idle until the next send, join retry, radio event or airtime budget
+    if (loraComm.getRxPending() == 0 && (txQueue.isEmpty() || loraComm.isTransmitting() || txWait > 0)) {
+        scheduler.sleep(txWait > 0 ? txWait : SCHEDULER_FOREVER);
+    }
+}
+
+void sendSensorData() {
+    if (SEND_SNAPSHOT) {
+        sendSnapshot();
+    } else {
+        sendNextSensor();
+    }
 
-        // Encode sensor response with device name (use saved sensor ID)
-        size_t len = protocol.encodeSensorResponseWithDevice(DEVICE_NAME, sensorToSend, value, unit, txBuffer);
+    scheduler.reschedule(sendTask, sendSchedule.next());
+}
+
+void sendSnapshot() {
+    // Read every sensor into one batch behind a single device name
+    SensorReading readings[SNAPSHOT_COUNT];
+    for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+        readings[i].sensorId = SNAPSHOT_SENSORS[i];
+        readings[i].value = sensors.readSensorById(SNAPSHOT_SENSORS[i]);
+    }
 
-        if (len > 0 && loraComm.sendPacket(txBuffer, len)) {
-            Serial.print(F("[TX] "));
-            Serial.print(name);
-            Serial.print(F(": "));
-            Serial.print(value, 2);
+    // Encoded straight into the TX queue; stale once the next reading is due
+    uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+    size_t len = 0;
+    if (frame != nullptr && shortAddr != MSG_ADDR_NONE) {
+        len = protocol.encodeSensorBatch(shortAddr, readings, SNAPSHOT_COUNT, frame);
+    } else if (frame != nullptr) {
+        len = protocol.encodeSensorBatch(DEVICE_NAME, readings, SNAPSHOT_COUNT, frame);
+    }
+
+    if (txQueue.commit(len, SEND_INTERVAL)) {
+        sendSchedule.recordAirtime(loraComm.getAirtimeUs(len));
+        Serial.print(F("[TX] Snapshot:"));
+        for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+            Serial.print(F(" "));
+            Serial.print(sensors.getSensorName(readings[i].sensorId));
+            Serial.print(F(" "));
+            Serial.print(readings[i].value, 2);
             Serial.print(F(" "));
-            Serial.print(unit);
-            Serial.print(F(" ("));
-            Serial.print(len);
-            Serial.println(F(" bytes)"));
-        } else {
-            Serial.println(F("[ERROR] Failed to send packet"));
+            Serial.print(sensors.getSensorUnit(readings[i].sensorId));
+            if (i + 1 < SNAPSHOT_COUNT) {
+                Serial.print(F(","));
+            }
+        }
+        Serial.print(F(" ("));
+        Serial.print(len);
+        Serial.print(F(" bytes, "));
+        Serial.print(loraComm.getAirtimeUs(len) / 1000.0, 1);
+        Serial.print(F(" ms on air, "));
+        Serial.print(loraComm.getDutyCycle().getAirtimeMs());
+        Serial.print(F(" ms total, CAD busy "));
+        Serial.print(loraComm.getListenBeforeTalk().getBusy());
+        Serial.println(F(")"));
+    } else {
+        Serial.println(F("[ERROR] Failed to queue packet"));
+    }
+}
+
+void sendNextSensor() {
+    // Read sensor
+    float value;
+    const char* unit;
+    const char* name;
+    uint8_t sensorToSend = currentSensor;  // Save current sensor ID before updating
+
+    switch (currentSensor) {
+        case SENSOR_TEMPERATURE:
+            value = sensors.readTemperature();
+            unit = sensors.getSensorUnit(SENSOR_TEMPERATURE);
+            name = sensors.getSensorName(SENSOR_TEMPERATURE);
+            currentSensor = SENSOR_HUMIDITY;  // Next sensor
+            break;
+        case SENSOR_HUMIDITY:
+            value = sensors.readHumidity();
+            unit = sensors.getSensorUnit(SENSOR_HUMIDITY);
+            name = sensors.getSensorName(SENSOR_HUMIDITY);
+            currentSensor = SENSOR_BATTERY;
+            break;
+        case SENSOR_BATTERY:
+            value = sensors.readBatteryVoltage();
+            unit = sensors.getSensorUnit(SENSOR_BATTERY);
+            name = sensors.getSensorName(SENSOR_BATTERY);
+            currentSensor = SENSOR_PRESSURE;
+            break;
+        case SENSOR_PRESSURE:
+            value = sensors.readPressure();
+            unit = sensors.getSensorUnit(SENSOR_PRESSURE);
+            name = sensors.getSensorName(SENSOR_PRESSURE);
+            currentSensor = SENSOR_TEMPERATURE;  // Loop back
+            break;
+        default:
+            currentSensor = SENSOR_TEMPERATURE;
+            return;
+    }
+
+    // Encode compact sensor reading with short address or device name (use saved sensor ID)
+    uint8_t* frame = txQueue.reserve(TX_CLASS_TELEMETRY);
+    size_t len = 0;
+    if (frame != nullptr && shortAddr != MSG_ADDR_NONE) {
+        len = protocol.encodeSensorCompact(shortAddr, sensorToSend, value, frame);
+    } else if (frame != nullptr) {
+        len = protocol.encodeSensorCompact(DEVICE_NAME, sensorToSend, value, frame);
+    }
+
+    if (txQueue.commit(len, SEND_INTERVAL)) {
+        sendSchedule.recordAirtime(loraComm.getAirtimeUs(len));
+        Serial.print(F("[TX] "));
+        Serial.print(name);
+        Serial.print(F(": "));
+        Serial.print(value, 2);
+        Serial.print(F(" "));
+        Serial.print(unit);
+        Serial.print(F(" ("));
+        Serial.print(len);
+        Serial.print(F(" bytes, "));
+        Serial.print(loraComm.getAirtimeUs(len) / 1000.0, 1);
+        Serial.print(F(" ms on air, "));
+        Serial.print(loraComm.getDutyCycle().getAirtimeMs());
+        Serial.print(F(" ms total, CAD busy "));
+        Serial.print(loraComm.getListenBeforeTalk().getBusy());
+        Serial.println(F(")"));
+    } else {
+        Serial.println(F("[ERROR] Failed to queue packet"));
+    }
+}
+
+void sendJoinRequest() {
+    // Control class: goes out ahead of any queued telemetry
+    uint8_t* frame = txQueue.reserve(TX_CLASS_CONTROL);
+    size_t len = (frame != nullptr) ? protocol.encodeJoinRequest(DEVICE_NAME, frame) : 0;
+
+    if (txQueue.commit(len)) {
+        Serial.println(F("[JOIN] Requesting short address"));
+    } else {
+        Serial.println(F("[ERROR] Failed to queue join request"));
+    }
+}
+
+unsigned long pumpTxQueue() {
+    // One frame on air at a time; the queue picks the most urgent next
+    if (loraComm.isTransmitting()) {
+        return 0;
+    }
+
+    const TxEntry* entry = txQueue.peek();
+    if (entry == nullptr) {
+        return 0;
+    }
+
+    // Over the duty-cycle budget: the frame waits in the queue (its TTL
+    // still runs) and the loop sleeps until the budget covers it
+    unsigned long wait = loraComm.getTxDelay(entry->length);
+    if (wait > 0) {
+        return wait;
+    }
+
+    // Frequency hopping: uplink on this period's channel, never across a hop
+    if (HOP_ENABLED) {
+        wait = hopper.getTxDelay(loraComm.getAirtimeUs(entry->length));
+        if (wait > 0) {
+            return wait;
         }
+        loraComm.setTxFrequency(ChannelHopper::getFrequency(hopper.getChannel(millis())));
+    }
+
+    // Listen before talk: back off while another node is on air
+    wait = loraComm.checkChannel(entry->length);
+    if (wait == LBT_GIVE_UP) {
+        Serial.println(F("[ERROR] Channel busy, packet dropped"));
+        txQueue.pop();
+        return 0;
+    }
+    if (wait > 0) {
+        return wait;
     }
 
-    delay(10);
+    if (!loraComm.sendPacketAsync(entry->frame, entry->length)) {
+        Serial.println(F("[ERROR] Failed to send packet"));
+    }
+    txQueue.pop();
+    return 0;
+}
+
+void checkJoinReplies() {
+    const RxPacket* packet;
+
+    while ((packet = loraComm.peek()) != nullptr) {
+        MessageView message;
+        JoinInfo join;
+        BeaconInfo beacon;
+
+        bool valid = protocol.decodeView(packet->data, packet->length, message);
+        if (valid && protocol.parseJoin(message, join)) {
+            if (message.type() == MSG_JOIN_ACCEPT &&
+                strncmp(join.deviceName, DEVICE_NAME, sizeof(join.deviceName) - 1) == 0) {
+                shortAddr = join.address;
+                scheduler.stop(joinTask);
+
+                // Addressed frames from now on; ignore traffic for other nodes
+                protocol.setLocalAddress(shortAddr);
+                protocol.setDestination(MSG_ADDR_GATEWAY);
+                loraComm.setAddressFilter(shortAddr);
+                sendSchedule.setAddress(shortAddr);
+
+                Serial.print(F("[JOIN] Joined as 0x"));
+                Serial.println(shortAddr, HEX);
+            } else if (message.type() == MSG_JOIN_REJOIN && shortAddr != MSG_ADDR_NONE &&
+                       join.address == shortAddr) {
+                // Receiver lost our address: send the name inline until rejoined
+                shortAddr = MSG_ADDR_NONE;
+                scheduler.reschedule(joinTask, 0);
+                protocol.setLocalAddress(MSG_ADDR_NONE);
+                protocol.setDestination(MSG_ADDR_BROADCAST);
+                loraComm.setAddressFilter(MSG_ADDR_NONE);
+                sendSchedule.setAddress(MSG_ADDR_NONE);
+                Serial.println(F("[JOIN] Receiver requested rejoin"));
+            }
+        } else if (valid && protocol.parseBeacon(message, beacon)) {
+            // The beacon went on air offsetMs into the receiver's period
+            unsigned long periodStart = packet->timestamp - loraComm.getAirtimeUs(packet->length) / 1000 -
+                                        beacon.offsetMs;
+            bool wasSynced = hopper.isSynced();
+            sendSchedule.sync(periodStart, beacon.periodMs);
+            hopper.sync(periodStart, beacon.periodMs, beacon.hop, beacon.blacklist);
+            if (HOP_ENABLED && !wasSynced) {
+                hopper.printStats();
+            }
+        }
+
+        loraComm.pop();
+    }
 }
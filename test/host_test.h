@@ -0,0 +1,42 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Shared helpers for the host test executables (no framework: a failed
+// CHECK prints its location and exits non-zero, which ctest reports)
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+// Deterministic pseudo-random source for link simulations (xorshift32),
+// independent of rand() which MessageProtocol reseeds
+class SimRandom {
+public:
+    explicit SimRandom(uint32_t seed) : state(seed ? seed : 1) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // True with the given probability in percent
+    bool chance(uint8_t percent) { return next() % 100 < percent; }
+
+    // Uniform in [0, range)
+    uint32_t below(uint32_t range) { return range ? next() % range : 0; }
+
+private:
+    uint32_t state;
+};
+
+#endif // HOST_TEST_H
@@ -0,0 +1,162 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+static bool serialEcho = false;
+static unsigned long nowMs = 0;
+
+// ===== Serial =====
+
+void mockSerialEcho(bool enabled) {
+    serialEcho = enabled;
+}
+
+size_t Print::write(uint8_t c) {
+    if (serialEcho) {
+        putchar(c);
+    }
+    return 1;
+}
+
+size_t Print::write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        write(data[i]);
+    }
+    return length;
+}
+
+static size_t printFormatted(Print& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+static size_t printFormatted(Print& out, const char* format, ...) {
+    char text[48];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return out.write((const uint8_t*)text, n < (int)sizeof(text) ? (size_t)n : sizeof(text) - 1);
+}
+
+size_t Print::print(const __FlashStringHelper* text) {
+    return print(reinterpret_cast<const char*>(text));
+}
+
+size_t Print::print(const char* text) {
+    return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+    if (base == HEX) {
+        return print((unsigned long)value, base);
+    }
+    return printFormatted(*this, "%ld", value);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printFormatted(*this, base == HEX ? "%lX" : "%lu", value);
+}
+
+size_t Print::print(double value, int digits) {
+    return printFormatted(*this, "%.*f", digits, value);
+}
+
+size_t Print::println() {
+    return write('\n');
+}
+
+// ===== Time =====
+
+unsigned long millis() {
+    return nowMs;
+}
+
+unsigned long micros() {
+    return nowMs * 1000UL;
+}
+
+void delay(unsigned long ms) {
+    nowMs += ms;
+}
+
+void delayMicroseconds(unsigned int) {
+}
+
+void yield() {
+}
+
+void mockSetMillis(unsigned long ms) {
+    nowMs = ms;
+}
+
+void mockAdvance(unsigned long ms) {
+    nowMs += ms;
+}
+
+// ===== Random =====
+
+long random(long high) {
+    return high > 0 ? rand() % high : 0;
+}
+
+long random(long low, long high) {
+    return high > low ? low + rand() % (high - low) : low;
+}
+
+void randomSeed(unsigned long seed) {
+    srand((unsigned)seed);
+}
+
+// ===== GPIO and Interrupts =====
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+}
+
+int digitalRead(uint8_t) {
+    return LOW;
+}
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+#define MOCK_INTERRUPTS 64
+
+static void (*interruptHandlers[MOCK_INTERRUPTS])() = {};
+
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int) {
+    if (interrupt < MOCK_INTERRUPTS) {
+        interruptHandlers[interrupt] = handler;
+    }
+}
+
+void mockInterrupt(uint8_t interrupt) {
+    if (interrupt < MOCK_INTERRUPTS && interruptHandlers[interrupt] != nullptr) {
+        interruptHandlers[interrupt]();
+    }
+}
+
+void noInterrupts() {
+}
+
+void interrupts() {
+}
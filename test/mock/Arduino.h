@@ -0,0 +1,121 @@
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+// Minimal Arduino core for host builds of the lib/ sources.
+// Time is a simulated clock the tests move forward (mockAdvance()),
+// Serial output is discarded unless mockSerialEcho(true).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// ===== Core Constants =====
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define MSBFIRST 1
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+
+#define IRAM_ATTR
+#define digitalPinToInterrupt(p) (p)
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// F() strings are plain char arrays on the host
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+template <class T>
+T constrain(T x, T low, T high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+// ===== Serial =====
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c);
+    size_t write(const uint8_t* data, size_t length);
+
+    size_t print(const __FlashStringHelper* text);
+    size_t print(const char* text);
+    size_t print(char c);
+    size_t print(unsigned char value, int base = DEC);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println();
+    template <class T>
+    size_t println(T value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <class T>
+    size_t println(T value, int format) {
+        size_t n = print(value, format);
+        return n + println();
+    }
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() {}
+    operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// Print what the libs send to Serial (default: discard)
+void mockSerialEcho(bool enabled);
+
+// ===== Time =====
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Simulated clock: set or advance (ms)
+void mockSetMillis(unsigned long ms);
+void mockAdvance(unsigned long ms);
+
+// ===== Random =====
+
+long random(long high);
+long random(long low, long high);
+void randomSeed(unsigned long seed);
+
+// ===== GPIO and Interrupts =====
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+void noInterrupts();
+void interrupts();
+
+// Run the handler attached to this interrupt, as an edge on its pin would
+void mockInterrupt(uint8_t interrupt);
+
+#endif // MOCK_ARDUINO_H
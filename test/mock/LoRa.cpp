@@ -0,0 +1,72 @@
+#include "LoRa.h"
+#include "MockSx1278.h"
+
+#define MODE_LONG_RANGE 0x80
+
+LoRaClass LoRa;
+
+int LoRaClass::begin(long) {
+    mockRadio.reset();
+    mockRadio.setMode(MODE_LONG_RANGE | MOCK_MODE_STDBY);
+    return 1;
+}
+
+int LoRaClass::beginPacket(int) {
+    if ((mockRadio.getRegister(MOCK_REG_OP_MODE) & MOCK_MODE_MASK) == MOCK_MODE_TX) {
+        return 0;
+    }
+    idle();
+    mockRadio.setRegister(MOCK_REG_FIFO_ADDR_PTR, 0);
+    mockRadio.setRegister(MOCK_REG_PAYLOAD_LENGTH, 0);
+    return 1;
+}
+
+int LoRaClass::endPacket(bool async) {
+    mockRadio.setMode(MODE_LONG_RANGE | MOCK_MODE_TX);
+
+    // Done at once: TxDone is raised for an async send, taken otherwise
+    mockRadio.setMode(MODE_LONG_RANGE | MOCK_MODE_STDBY);
+    if (async) {
+        mockRadio.setRegister(MOCK_REG_IRQ_FLAGS, mockRadio.getRegister(MOCK_REG_IRQ_FLAGS) | 0x08);
+    }
+    return 1;
+}
+
+int LoRaClass::parsePacket(int) {
+    uint8_t flags = mockRadio.getRegister(MOCK_REG_IRQ_FLAGS);
+    if (!(flags & 0x40)) {
+        if ((mockRadio.getRegister(MOCK_REG_OP_MODE) & MOCK_MODE_MASK) != MOCK_MODE_RX_CONTINUOUS) {
+            receive();
+        }
+        return 0;
+    }
+
+    mockRadio.setRegister(MOCK_REG_IRQ_FLAGS, flags & ~0x60);
+    idle();
+    mockRadio.setRegister(MOCK_REG_FIFO_ADDR_PTR, mockRadio.getRegister(MOCK_REG_FIFO_RX_CURRENT_ADDR));
+    return mockRadio.getRegister(MOCK_REG_RX_NB_BYTES);
+}
+
+int LoRaClass::available() {
+    return 0;
+}
+
+int LoRaClass::read() {
+    return -1;
+}
+
+void LoRaClass::receive(int) {
+    mockRadio.setMode(MODE_LONG_RANGE | MOCK_MODE_RX_CONTINUOUS);
+}
+
+void LoRaClass::idle() {
+    mockRadio.setMode(MODE_LONG_RANGE | MOCK_MODE_STDBY);
+}
+
+void LoRaClass::sleep() {
+    mockRadio.setMode(MODE_LONG_RANGE);
+}
+
+byte LoRaClass::random() {
+    return (byte)rand();
+}
@@ -0,0 +1,48 @@
+#ifndef MOCK_LORA_H
+#define MOCK_LORA_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#define PA_OUTPUT_PA_BOOST_PIN 1
+
+// arduino-LoRa API on top of the SX1278 model (mockRadio). Mode changes
+// go to RegOpMode; modem settings are accepted and ignored. Transmissions
+// complete at once (the test moves the clock for their airtime).
+class LoRaClass {
+public:
+    int begin(long frequency);
+    void end() {}
+
+    void setPins(int, int, int) {}
+    void setSPI(SPIClass&) {}
+
+    int beginPacket(int implicitHeader = false);
+    int endPacket(bool async = false);
+
+    int parsePacket(int size = 0);
+    int packetRssi() { return -60; }
+    float packetSnr() { return 9.5f; }
+    int available();
+    int read();
+
+    void receive(int size = 0);
+    void idle();
+    void sleep();
+
+    void setTxPower(int, int = PA_OUTPUT_PA_BOOST_PIN) {}
+    void setFrequency(long) {}
+    void setSpreadingFactor(int) {}
+    void setSignalBandwidth(long) {}
+    void setCodingRate4(int) {}
+    void setPreambleLength(long) {}
+    void setSyncWord(int) {}
+    void enableCrc() {}
+    void disableCrc() {}
+
+    byte random();
+};
+
+extern LoRaClass LoRa;
+
+#endif // MOCK_LORA_H
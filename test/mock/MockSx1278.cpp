@@ -0,0 +1,151 @@
+#include "MockSx1278.h"
+#include <Arduino.h>
+
+#define SPI_WRITE_FLAG 0x80
+
+MockSx1278 mockRadio;
+
+MockSx1278::MockSx1278() {
+    reset();
+}
+
+void MockSx1278::reset() {
+    memset(registers, 0, sizeof(registers));
+    memset(fifo, 0, sizeof(fifo));
+    registers[MOCK_REG_OP_MODE] = 0x09;  // FSK standby after reset
+    // LoRa.begin() puts both TX and RX base at 0 for the full 256 bytes
+    address = 0;
+    writing = false;
+
+    channelBusy = nullptr;
+    cadDurationMs = 2;
+    cadStart = 0;
+    cadCycles = 0;
+    transmissions = 0;
+}
+
+// ===== SPI Side =====
+
+void MockSx1278::beginAccess(uint8_t addressByte) {
+    writing = (addressByte & SPI_WRITE_FLAG) != 0;
+    address = addressByte & ~SPI_WRITE_FLAG;
+}
+
+uint8_t MockSx1278::access(uint8_t mosi) {
+    uint8_t miso = 0;
+    if (writing) {
+        writeRegister(address, mosi);
+    } else {
+        miso = readRegister(address);
+    }
+
+    // Burst access walks the register map; RegFifo stays put
+    if (address != MOCK_REG_FIFO) {
+        address = (address + 1) & 0x7F;
+    }
+    return miso;
+}
+
+uint8_t MockSx1278::readRegister(uint8_t reg) {
+    if (reg == MOCK_REG_IRQ_FLAGS) {
+        updateCad();
+    }
+    if (reg == MOCK_REG_FIFO) {
+        return fifo[registers[MOCK_REG_FIFO_ADDR_PTR]++];
+    }
+    return registers[reg];
+}
+
+void MockSx1278::writeRegister(uint8_t reg, uint8_t value) {
+    if (reg == MOCK_REG_FIFO) {
+        fifo[registers[MOCK_REG_FIFO_ADDR_PTR]++] = value;
+    } else if (reg == MOCK_REG_IRQ_FLAGS) {
+        registers[reg] &= ~value;
+    } else if (reg == MOCK_REG_OP_MODE) {
+        setMode(value);
+    } else {
+        registers[reg] = value;
+    }
+}
+
+// ===== Test Side =====
+
+uint8_t MockSx1278::getRegister(uint8_t reg) {
+    return registers[reg & 0x7F];
+}
+
+void MockSx1278::setRegister(uint8_t reg, uint8_t value) {
+    registers[reg & 0x7F] = value;
+}
+
+void MockSx1278::receive(const uint8_t* data, uint8_t length, bool crcError) {
+    uint8_t start = registers[MOCK_REG_FIFO_RX_BASE_ADDR];
+    for (uint8_t i = 0; i < length; i++) {
+        fifo[(uint8_t)(start + i)] = data[i];
+    }
+    registers[MOCK_REG_FIFO_RX_CURRENT_ADDR] = start;
+    registers[MOCK_REG_RX_NB_BYTES] = length;
+    registers[MOCK_REG_IRQ_FLAGS] |= 0x40;  // RxDone
+    if (crcError) {
+        registers[MOCK_REG_IRQ_FLAGS] |= 0x20;  // PayloadCrcError
+        return;
+    }
+
+    uint16_t count = ((uint16_t)registers[MOCK_REG_RX_PACKET_CNT_MSB] << 8) | registers[MOCK_REG_RX_PACKET_CNT_LSB];
+    count++;
+    registers[MOCK_REG_RX_PACKET_CNT_MSB] = count >> 8;
+    registers[MOCK_REG_RX_PACKET_CNT_LSB] = count & 0xFF;
+}
+
+const uint8_t* MockSx1278::txPayload() {
+    return &fifo[registers[MOCK_REG_FIFO_TX_BASE_ADDR]];
+}
+
+uint8_t MockSx1278::txLength() {
+    return registers[MOCK_REG_PAYLOAD_LENGTH];
+}
+
+// ===== Modes and CAD =====
+
+void MockSx1278::setMode(uint8_t opMode) {
+    uint8_t mode = opMode & MOCK_MODE_MASK;
+    if (mode == MOCK_MODE_RX_CONTINUOUS && (registers[MOCK_REG_OP_MODE] & MOCK_MODE_MASK) != mode) {
+        registers[MOCK_REG_RX_PACKET_CNT_MSB] = 0;
+        registers[MOCK_REG_RX_PACKET_CNT_LSB] = 0;
+    } else if (mode == MOCK_MODE_CAD) {
+        cadStart = millis();
+        cadCycles++;
+    } else if (mode == MOCK_MODE_TX) {
+        transmissions++;
+    }
+    registers[MOCK_REG_OP_MODE] = opMode;
+}
+
+void MockSx1278::setChannel(bool (*busy)(unsigned long now)) {
+    channelBusy = busy;
+}
+
+void MockSx1278::setCadDurationMs(unsigned long ms) {
+    cadDurationMs = ms;
+}
+
+uint32_t MockSx1278::getCadCycles() {
+    return cadCycles;
+}
+
+uint32_t MockSx1278::getTransmissions() {
+    return transmissions;
+}
+
+void MockSx1278::updateCad() {
+    uint8_t& opMode = registers[MOCK_REG_OP_MODE];
+    if ((opMode & MOCK_MODE_MASK) != MOCK_MODE_CAD || millis() - cadStart < cadDurationMs) {
+        return;
+    }
+
+    registers[MOCK_REG_IRQ_FLAGS] |= 0x04;  // CadDone
+    if (channelBusy != nullptr && channelBusy(cadStart)) {
+        registers[MOCK_REG_IRQ_FLAGS] |= 0x01;  // CadDetected
+    }
+    opMode = (opMode & ~MOCK_MODE_MASK) | MOCK_MODE_STDBY;
+}
@@ -0,0 +1,97 @@
+#ifndef MOCK_SX1278_H
+#define MOCK_SX1278_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// SX1278 registers the model gives meaning to
+#define MOCK_REG_FIFO 0x00
+#define MOCK_REG_OP_MODE 0x01
+#define MOCK_REG_FIFO_ADDR_PTR 0x0D
+#define MOCK_REG_FIFO_TX_BASE_ADDR 0x0E
+#define MOCK_REG_FIFO_RX_BASE_ADDR 0x0F
+#define MOCK_REG_FIFO_RX_CURRENT_ADDR 0x10
+#define MOCK_REG_IRQ_FLAGS 0x12
+#define MOCK_REG_RX_NB_BYTES 0x13
+#define MOCK_REG_RX_PACKET_CNT_MSB 0x16
+#define MOCK_REG_RX_PACKET_CNT_LSB 0x17
+#define MOCK_REG_MODEM_STAT 0x18
+#define MOCK_REG_PAYLOAD_LENGTH 0x22
+
+// RegOpMode mode bits (LoRa mode, MSB set)
+#define MOCK_MODE_MASK 0x07
+#define MOCK_MODE_STDBY 0x01
+#define MOCK_MODE_TX 0x03
+#define MOCK_MODE_RX_CONTINUOUS 0x05
+#define MOCK_MODE_CAD 0x07
+
+// Register file and FIFO of one SX1278 behind the mock SPI bus.
+//
+// Each chip-select window starts with an address byte (MSB set: write);
+// the following bytes read or write that register, auto-incrementing
+// except on RegFifo, which moves RegFifoAddrPtr instead. RegIrqFlags
+// bits clear when written with 1, as on the chip.
+//
+// CAD runs on the simulated clock: a cycle started by writing CAD mode
+// to RegOpMode completes after the CAD duration, raising CadDone (and
+// CadDetected if the test's channel was busy when it started) and
+// dropping to standby, as the modem does.
+class MockSx1278 {
+public:
+    MockSx1278();
+
+    // Power-on state, with the FIFO base addresses LoRa.begin() sets
+    void reset();
+
+    // SPI side: address byte of a new access, then one data byte each
+    void beginAccess(uint8_t address);
+    uint8_t access(uint8_t mosi);
+
+    // Test side: registers without going over the bus
+    uint8_t getRegister(uint8_t address);
+    void setRegister(uint8_t address, uint8_t value);
+
+    // Place a received packet in the FIFO as the modem does on RxDone
+    // (over the previous one) and count it in RegRxPacketCntValue, which
+    // restarts each time RX mode is entered. A packet failing its CRC
+    // raises PayloadCrcError as well and is not counted.
+    void receive(const uint8_t* data, uint8_t length, bool crcError = false);
+
+    // Packet loaded for transmission (from RegFifoTxBaseAddr, RegPayloadLength long)
+    const uint8_t* txPayload();
+    uint8_t txLength();
+
+    // Write RegOpMode as the chip sees it (LoRa library calls come here)
+    void setMode(uint8_t opMode);
+
+    // Channel sensed by CAD: true while another node is on air
+    void setChannel(bool (*busy)(unsigned long now));
+    void setCadDurationMs(unsigned long ms);
+
+    // CAD cycles started and transmissions keyed since reset()
+    uint32_t getCadCycles();
+    uint32_t getTransmissions();
+
+private:
+    uint8_t registers[128];
+    uint8_t fifo[256];
+    uint8_t address;
+    bool writing;
+
+    bool (*channelBusy)(unsigned long now);
+    unsigned long cadDurationMs;
+    unsigned long cadStart;
+    uint32_t cadCycles;
+    uint32_t transmissions;
+
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+
+    // Complete a CAD cycle whose time is up
+    void updateCad();
+};
+
+// The chip the mock SPI bus talks to
+extern MockSx1278 mockRadio;
+
+#endif // MOCK_SX1278_H
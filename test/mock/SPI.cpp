@@ -0,0 +1,67 @@
+#include "SPI.h"
+#include "MockSx1278.h"
+
+SPIClass SPI;
+
+SPIClass::SPIClass() : addressPhase(false) {
+    resetCounters();
+}
+
+void SPIClass::beginTransaction(SPISettings) {
+    counters.transactions++;
+    addressPhase = true;
+}
+
+void SPIClass::endTransaction() {
+    addressPhase = false;
+}
+
+uint8_t SPIClass::clock(uint8_t mosi) {
+    counters.bytes++;
+    if (addressPhase) {
+        addressPhase = false;
+        mockRadio.beginAccess(mosi);
+        return 0;
+    }
+    return mockRadio.access(mosi);
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    counters.calls++;
+    return clock(data);
+}
+
+void SPIClass::transfer(void* buffer, size_t count) {
+    counters.calls++;
+    uint8_t* bytes = (uint8_t*)buffer;
+    for (size_t i = 0; i < count; i++) {
+        bytes[i] = clock(bytes[i]);
+    }
+}
+
+void SPIClass::transferBytes(const uint8_t* out, uint8_t* in, uint32_t count) {
+    counters.calls++;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t miso = clock(out != nullptr ? out[i] : 0xFF);
+        if (in != nullptr) {
+            in[i] = miso;
+        }
+    }
+}
+
+void SPIClass::writeBytes(const uint8_t* data, uint32_t count) {
+    counters.calls++;
+    for (uint32_t i = 0; i < count; i++) {
+        clock(data[i]);
+    }
+}
+
+const MockSpiCounters& SPIClass::getCounters() {
+    return counters;
+}
+
+void SPIClass::resetCounters() {
+    counters.transactions = 0;
+    counters.bytes = 0;
+    counters.calls = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef MOCK_SPI_H
+#define MOCK_SPI_H
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0
+
+class SPISettings {
+public:
+    SPISettings() {}
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+// Traffic seen on the mock bus
+struct MockSpiCounters {
+    uint32_t transactions;  // beginTransaction() .. endTransaction() windows
+    uint32_t bytes;         // Bytes clocked
+    uint32_t calls;         // transfer()/transferBytes()/writeBytes() calls
+};
+
+// SPI bus with one device on it (mockRadio). Every byte is clocked
+// through the SX1278 model, and the traffic is counted so access
+// patterns can be compared.
+class SPIClass {
+public:
+    SPIClass();
+
+    void begin() {}
+    void begin(int8_t, int8_t, int8_t, int8_t) {}
+    void end() {}
+
+    void beginTransaction(SPISettings settings);
+    void endTransaction();
+
+    // Arduino core API
+    uint8_t transfer(uint8_t data);
+    void transfer(void* buffer, size_t count);
+
+    // ESP32 core API
+    void transferBytes(const uint8_t* out, uint8_t* in, uint32_t count);
+    void writeBytes(const uint8_t* data, uint32_t count);
+
+    const MockSpiCounters& getCounters();
+    void resetCounters();
+
+private:
+    MockSpiCounters counters;
+    bool addressPhase;  // Next byte is the register address
+
+    uint8_t clock(uint8_t mosi);
+};
+
+extern SPIClass SPI;
+
+#endif // MOCK_SPI_H
@@ -0,0 +1,159 @@
+// Frame integrity checks: CRC check values, table vs bitwise reference,
+// corrupted frame rejection per mode, and throughput in bytes/us
+
+#include "host_test.h"
+#include "MessageProtocol.h"
+#include <chrono>
+
+#define BENCH_BUFFER_SIZE 4096
+#define BENCH_ROUNDS 4000     // 16 MB per checksum
+#define CORRUPT_TRIALS 20000
+
+MessageProtocol protocol;
+
+// ===== Bitwise Reference =====
+
+uint16_t referenceCrc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint32_t referenceCrc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+// ===== Check Values =====
+
+void testCheckValues() {
+    const uint8_t* check = (const uint8_t*)"123456789";
+    CHECK(protocol.calculateCrc16(check, 9) == 0x29B1);
+    CHECK(protocol.calculateCrc32(check, 9) == 0xCBF43926);
+    CHECK(protocol.calculateCrc16(check, 0) == 0xFFFF);
+    CHECK(protocol.calculateCrc32(check, 0) == 0x00000000);
+
+    // Every length and alignment around the 4-byte slicing step
+    SimRandom rng(0xC0C0);
+    uint8_t data[300];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)rng.next();
+    }
+    for (size_t offset = 0; offset < 4; offset++) {
+        for (size_t length = 0; length + offset <= sizeof(data); length++) {
+            CHECK(protocol.calculateCrc16(data + offset, length) == referenceCrc16(data + offset, length));
+            CHECK(protocol.calculateCrc32(data + offset, length) == referenceCrc32(data + offset, length));
+        }
+    }
+}
+
+// ===== Corrupted Frames =====
+
+// Flip 1..maxBits random bits after the FLAGS byte (which selects the
+// check itself) and count the frames that still decode
+uint32_t countUndetected(IntegrityMode mode, uint8_t maxBits, SimRandom& rng) {
+    protocol.setIntegrityMode(mode);
+    SensorReading readings[4] = {{1, 25.34f}, {2, 65.2f}, {3, 3.87f}, {4, 1013.25f}};
+    uint8_t frame[MSG_MAX_PACKET_SIZE];
+    size_t length = protocol.encodeSensorBatch("sender1", readings, 4, frame);
+    CHECK(length > 0);
+
+    MessageView view;
+    CHECK(protocol.decodeView(frame, length, view));
+
+    uint32_t undetected = 0;
+    uint8_t air[MSG_MAX_PACKET_SIZE];
+    for (uint32_t trial = 0; trial < CORRUPT_TRIALS; trial++) {
+        memcpy(air, frame, length);
+        uint8_t bits = 1 + rng.below(maxBits);
+        for (uint8_t b = 0; b < bits; b++) {
+            size_t index = 2 + rng.below(length - 2);
+            air[index] ^= (uint8_t)(1 << rng.below(8));
+        }
+        if (memcmp(air, frame, length) != 0 && protocol.decodeView(air, length, view)) {
+            undetected++;
+        }
+    }
+    return undetected;
+}
+
+void testCorruption() {
+    SimRandom rng(0xBAD);
+    const char* names[] = {"XOR", "CRC-16", "CRC-32"};
+    const IntegrityMode modes[] = {INTEGRITY_XOR, INTEGRITY_CRC16, INTEGRITY_CRC32};
+
+    for (int m = 0; m < 3; m++) {
+        uint32_t single = countUndetected(modes[m], 1, rng);
+        uint32_t few = countUndetected(modes[m], 3, rng);
+        uint32_t many = countUndetected(modes[m], 16, rng);
+        printf("  %-6s undetected of %u: %4u (1 bit), %4u (1-3 bits), %4u (1-16 bits)\n",
+               names[m], CORRUPT_TRIALS, single, few, many);
+
+        // Any single flip breaks the XOR; both CRCs catch all 1-3 bit errors
+        CHECK(single == 0);
+        if (modes[m] != INTEGRITY_XOR) {
+            CHECK(few == 0);
+            CHECK(many <= 2);
+        }
+    }
+    protocol.setIntegrityMode(MSG_DEFAULT_INTEGRITY);
+}
+
+// ===== Throughput =====
+
+template <typename Checksum>
+double bytesPerUs(const uint8_t* data, Checksum checksum, uint32_t& sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        sink += checksum(data, BENCH_BUFFER_SIZE);
+    }
+    auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    return (double)BENCH_BUFFER_SIZE * BENCH_ROUNDS / elapsed.count();
+}
+
+void benchmark() {
+    static uint8_t data[BENCH_BUFFER_SIZE];
+    SimRandom rng(0xFEED);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)rng.next();
+    }
+
+    uint32_t sink = 0;
+    double xorRate = bytesPerUs(data, [](const uint8_t* d, size_t n) { return (uint32_t)protocol.calculateChecksum(d, n); }, sink);
+    double crc16Rate = bytesPerUs(data, [](const uint8_t* d, size_t n) { return (uint32_t)protocol.calculateCrc16(d, n); }, sink);
+    double crc32Rate = bytesPerUs(data, [](const uint8_t* d, size_t n) { return protocol.calculateCrc32(d, n); }, sink);
+    double bit16Rate = bytesPerUs(data, [](const uint8_t* d, size_t n) { return (uint32_t)referenceCrc16(d, n); }, sink);
+    double bit32Rate = bytesPerUs(data, [](const uint8_t* d, size_t n) { return referenceCrc32(d, n); }, sink);
+
+    printf("  XOR              %8.1f bytes/us\n", xorRate);
+    printf("  CRC-16 table     %8.1f bytes/us (bitwise %.1f)\n", crc16Rate, bit16Rate);
+    printf("  CRC-32 table     %8.1f bytes/us (bitwise %.1f)\n", crc32Rate, bit32Rate);
+    printf("  (sink %08X)\n", sink);
+}
+
+int main() {
+    #if defined(ESP32)
+        printf("Slicing-by-4 (ESP32 build)\n");
+    #else
+        printf("Byte-wise table (AVR build)\n");
+    #endif
+
+    testCheckValues();
+    printf("Corrupted frames\n");
+    testCorruption();
+    printf("Throughput\n");
+    benchmark();
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,231 @@
+// 16 KB transfer through ArqWindow (selective ACK) and Reassembler over
+// a simulated link that drops data frames, drops ACKs and corrupts bytes
+
+#include "host_test.h"
+#include "ArqWindow.h"
+#include "MessageProtocol.h"
+#include "Reassembler.h"
+
+#define TRANSFER_SIZE 16384
+#define FRAME_MS 10           // Airtime of one frame on the simulated link
+#define SENDER_ADDRESS 0x01
+#define RECEIVER_ADDRESS 0x02
+
+// ===== Simulated Link =====
+
+struct Link {
+    SimRandom rng;
+    uint8_t dataLoss;     // % of data frames lost
+    uint8_t ackLoss;      // % of ACKs lost
+    uint8_t corruption;   // % of data frames with a flipped byte
+
+    uint32_t framesSent;
+    uint32_t framesLost;
+    uint32_t framesCorrupted;
+    uint32_t acksLost;
+
+    Link(uint32_t seed, uint8_t data, uint8_t ack, uint8_t corrupt)
+        : rng(seed), dataLoss(data), ackLoss(ack), corruption(corrupt),
+          framesSent(0), framesLost(0), framesCorrupted(0), acksLost(0) {}
+};
+
+// Sending end: ARQ send window, SYN handshake as in the master firmware
+struct Sender {
+    MessageProtocol protocol;
+    ArqWindow window;
+
+    Sender() {
+        protocol.setLocalAddress(SENDER_ADDRESS);
+        protocol.setDestination(RECEIVER_ADDRESS);
+        protocol.setIntegrityMode(INTEGRITY_CRC16);
+
+        // Open the sequence: SYN, one frame on air until the first ACK
+        protocol.setSyn(true);
+        window.setLimit(1);
+    }
+
+    void handleAck(uint16_t cumulative, uint32_t bitmap) {
+        if (window.acknowledge(cumulative) > 0 && protocol.hasSyn()) {
+            protocol.setSyn(false);
+            window.setLimit(ARQ_WINDOW_SIZE);
+        }
+        window.acknowledgeSelective(cumulative, bitmap);
+    }
+};
+
+// Receiving end: ARQ receive window plus reassembly
+struct Receiver {
+    MessageProtocol protocol;
+    ArqReceiver sequence;
+    Reassembler reassembler;
+    const uint8_t* expected;
+    bool complete;
+    uint32_t accepted;
+    uint32_t duplicates;
+    uint32_t rejected;
+
+    Receiver() : expected(nullptr), complete(false), accepted(0), duplicates(0), rejected(0) {
+        protocol.setLocalAddress(RECEIVER_ADDRESS);
+    }
+};
+
+// One frame over the air; the receiver's SACK comes back unless lost
+void transmit(Link& link, Receiver& rx, Sender& tx, const uint8_t* frame, size_t length) {
+    link.framesSent++;
+    mockAdvance(FRAME_MS);
+
+    if (link.rng.chance(link.dataLoss)) {
+        link.framesLost++;
+        return;
+    }
+
+    uint8_t air[MSG_MAX_PACKET_SIZE];
+    memcpy(air, frame, length);
+    if (link.rng.chance(link.corruption)) {
+        air[link.rng.below(length)] ^= (uint8_t)(1 + link.rng.below(255));
+        link.framesCorrupted++;
+    }
+
+    MessageView view;
+    if (!rx.protocol.decodeView(air, length, view)) {
+        rx.rejected++;
+        return;
+    }
+
+    if (rx.sequence.accept(view.messageId(), view.isSyn())) {
+        rx.accepted++;
+        FragmentInfo fragment;
+        const uint8_t* data;
+        size_t dataLength;
+        CHECK(rx.protocol.parseFragment(view, fragment, data, dataLength));
+
+        const Reassembly* done = rx.reassembler.add(view.source(), fragment, data, dataLength);
+        if (done != nullptr) {
+            CHECK(!rx.complete);
+            CHECK(done->length == TRANSFER_SIZE);
+            CHECK(memcmp(done->data, rx.expected, TRANSFER_SIZE) == 0);
+            rx.complete = true;
+            rx.reassembler.release(done);
+        }
+    } else {
+        rx.duplicates++;
+    }
+
+    if (link.rng.chance(link.ackLoss)) {
+        link.acksLost++;
+        return;
+    }
+
+    mockAdvance(FRAME_MS);
+    tx.handleAck(rx.sequence.getCumulativeAck(), rx.sequence.getSelectiveBitmap());
+}
+
+// ===== Transfer =====
+
+// Push the payload through; returns simulated ms taken
+unsigned long runTransfer(Link& link, const uint8_t* payload) {
+    Sender tx;
+    ArqWindow& window = tx.window;
+    Receiver rx;
+    rx.expected = payload;
+
+    uint8_t count = MessageProtocol::getFragmentCount(TRANSFER_SIZE);
+    CHECK(count == (TRANSFER_SIZE + MSG_FRAGMENT_DATA_SIZE - 1) / MSG_FRAGMENT_DATA_SIZE);
+
+    unsigned long start = millis();
+    uint8_t next = 0;
+
+    while (next < count || !window.isEmpty()) {
+        CHECK(millis() - start < 3600000UL);
+
+        // Fill the window with new fragments
+        uint8_t* frame;
+        while (next < count && (frame = window.nextFrame()) != nullptr) {
+            size_t offset = (size_t)next * MSG_FRAGMENT_DATA_SIZE;
+            size_t length = TRANSFER_SIZE - offset;
+            if (length > MSG_FRAGMENT_DATA_SIZE) {
+                length = MSG_FRAGMENT_DATA_SIZE;
+            }
+
+            FragmentInfo fragment = {7, next, count, MSG_TEXT};
+            uint16_t msgId = 0;
+            size_t frameLength = tx.protocol.encodeFragment(fragment, payload + offset, length, frame, &msgId);
+            CHECK(frameLength > 0 && msgId != 0);
+
+            window.commit(frameLength, msgId);
+            window.markSent(frame);
+            next++;
+            transmit(link, rx, tx, frame, frameLength);
+        }
+
+        // Resend timed out frames and SACK holes, else wait for the next timeout
+        ArqSlot* slot = window.nextExpired();
+        if (slot != nullptr) {
+            window.markRetransmitted(slot);
+            window.markSent(slot->frame);
+            transmit(link, rx, tx, slot->frame, slot->length);
+        } else if (!window.isEmpty()) {
+            mockAdvance(window.timeUntilExpiry());
+        }
+    }
+
+    CHECK(rx.complete);
+    CHECK(rx.accepted == count);
+    CHECK(rx.reassembler.getCompleted() == 1);
+    CHECK(rx.reassembler.getActive() == 0);
+
+    unsigned long elapsed = millis() - start;
+    printf("  %u fragments: %u frames sent (%u lost, %u corrupted, %u rejected), "
+           "%u ACKs lost, %u duplicates, %lu ms simulated\n",
+           count, link.framesSent, link.framesLost, link.framesCorrupted, rx.rejected,
+           link.acksLost, rx.duplicates, elapsed);
+    CHECK(rx.rejected >= link.framesCorrupted * 9 / 10);
+    return elapsed;
+}
+
+// ===== Eviction =====
+
+void testEviction() {
+    Reassembler reassembler;
+    uint8_t data[MSG_FRAGMENT_DATA_SIZE] = {0};
+    FragmentInfo first = {1, 0, 3, MSG_TEXT};
+    FragmentInfo second = {2, 0, 3, MSG_TEXT};
+    FragmentInfo third = {3, 0, 3, MSG_TEXT};
+
+    // Both slots busy: a third transfer is refused until one stalls out
+    CHECK(reassembler.add(9, first, data, sizeof(data)) == nullptr);
+    CHECK(reassembler.add(9, second, data, sizeof(data)) == nullptr);
+    CHECK(reassembler.add(9, third, data, sizeof(data)) == nullptr);
+    CHECK(reassembler.getRefused() == 1 && reassembler.getActive() == 2);
+
+    mockAdvance(REASSEMBLY_TIMEOUT_MS + 1);
+    CHECK(reassembler.add(9, third, data, sizeof(data)) == nullptr);
+    CHECK(reassembler.getEvicted() == 2 && reassembler.getActive() == 1);
+
+    // A transfer larger than a slot is refused outright
+    FragmentInfo huge = {4, 0, REASSEMBLY_BUFFER_SIZE / MSG_FRAGMENT_DATA_SIZE + 2, MSG_TEXT};
+    CHECK(reassembler.add(9, huge, data, sizeof(data)) == nullptr);
+    CHECK(reassembler.getRefused() == 2);
+}
+
+int main() {
+    static uint8_t payload[TRANSFER_SIZE];
+    SimRandom fill(0x5EED);
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t)fill.next();
+    }
+
+    printf("Clean link\n");
+    Link clean(1, 0, 0, 0);
+    runTransfer(clean, payload);
+    CHECK(clean.framesSent == MessageProtocol::getFragmentCount(TRANSFER_SIZE));
+
+    printf("Lossy link (30%% data loss, 30%% ACK loss, 5%% corrupted)\n");
+    Link lossy(2, 30, 30, 5);
+    runTransfer(lossy, payload);
+    CHECK(lossy.framesSent < 4u * MessageProtocol::getFragmentCount(TRANSFER_SIZE));
+
+    testEviction();
+    printf("ok\n");
+    return 0;
+}
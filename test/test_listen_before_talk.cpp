@@ -0,0 +1,287 @@
+// Listen before talk on a busy channel: LoRaComm::checkChannel() driven
+// as the firmware's TX queue does, against the SX1278 model's CAD, plus
+// a contention simulation of nodes waking together with and without LBT
+
+#include "host_test.h"
+#include "LoRaComm.h"
+#include "MockSx1278.h"
+
+#define FRAME_LENGTH 32
+#define CONTENTION_NODES 8
+#define CONTENTION_ROUNDS 500
+
+// ===== Simulated Channel =====
+
+// Another node's traffic: on air in [from, to)
+struct BusyPeriod {
+    unsigned long from;
+    unsigned long to;
+};
+
+const BusyPeriod* busyPeriods = nullptr;
+size_t busyCount = 0;
+
+bool channelBusy(unsigned long now) {
+    for (size_t i = 0; i < busyCount; i++) {
+        if (now >= busyPeriods[i].from && now < busyPeriods[i].to) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void setTraffic(const BusyPeriod* periods, size_t count) {
+    busyPeriods = periods;
+    busyCount = count;
+}
+
+// Fresh radio at t = 0 on a channel with the given traffic
+void startRadio(LoRaComm& radio, const BusyPeriod* periods, size_t count) {
+    CHECK(radio.begin());
+    mockSetMillis(0);  // After begin()'s reset delays
+    setTraffic(periods, count);
+    mockRadio.setChannel(channelBusy);
+    mockRadio.setCadDurationMs(2);  // Two symbols at SF7 / 125 kHz
+}
+
+// ===== Driver =====
+
+// One frame through the TX queue: checkChannel() each loop pass, sleep
+// for what it returns, send on 0. Returns the send time, -1 if dropped.
+long sendFrame(LoRaComm& radio, const uint8_t* frame) {
+    for (;;) {
+        unsigned long before = millis();
+        unsigned long wait = radio.checkChannel(FRAME_LENGTH);
+        CHECK(millis() == before);  // Never blocks the loop
+
+        if (wait == LBT_GIVE_UP) {
+            return -1;
+        }
+        if (wait == 0) {
+            uint32_t keyed = mockRadio.getTransmissions();
+            CHECK(radio.sendPacket(frame, FRAME_LENGTH));
+            CHECK(mockRadio.getTransmissions() == keyed + 1);
+            return (long)millis();
+        }
+        mockAdvance(wait);
+    }
+}
+
+// ===== Scenarios =====
+
+void testClearChannel(const uint8_t* frame) {
+    LoRaComm radio;
+    startRadio(radio, nullptr, 0);
+    radio.enableRxInterrupt();
+
+    // First call starts CAD and returns at once
+    unsigned long wait = radio.checkChannel(FRAME_LENGTH);
+    CHECK(wait > 0 && wait < 10);
+    CHECK(mockRadio.getCadCycles() == 1);
+    CHECK((mockRadio.getRegister(MOCK_REG_OP_MODE) & MOCK_MODE_MASK) == MOCK_MODE_CAD);
+
+    // The next call after the cycle takes the result; the radio listens again
+    mockAdvance(wait);
+    CHECK(radio.checkChannel(FRAME_LENGTH) == 0);
+    CHECK((mockRadio.getRegister(MOCK_REG_OP_MODE) & MOCK_MODE_MASK) == MOCK_MODE_RX_CONTINUOUS);
+    CHECK(mockRadio.getRegister(MOCK_REG_IRQ_FLAGS) == 0);
+
+    long sent = sendFrame(radio, frame);
+    printf("  clear channel: sent at %ld ms after %u CAD cycle(s)\n", sent, mockRadio.getCadCycles());
+    CHECK(sent >= 0 && sent < 10);
+}
+
+void testBusyPeriod(const uint8_t* frame) {
+    const BusyPeriod traffic[] = {{0, 500}};
+    LoRaComm radio;
+    startRadio(radio, traffic, 1);
+
+    long sent = sendFrame(radio, frame);
+    ListenBeforeTalk& lbt = radio.getListenBeforeTalk();
+    printf("  busy 0-500 ms: sent at %ld ms, %u CAD cycles, %u backoffs (%u ms)\n",
+           sent, mockRadio.getCadCycles(), lbt.getBackoffs(), lbt.getBackoffMs());
+
+    // Not before the other node is off air, and CAD only once per backoff
+    CHECK(sent >= 500);
+    CHECK(lbt.getBusy() > 0 && lbt.getGaveUp() == 0);
+    CHECK(mockRadio.getCadCycles() == lbt.getChecks());
+}
+
+void testTraffic(const uint8_t* frame) {
+    // Another node sends a frame every 150 ms; ours fits a gap
+    const unsigned long airMs = loraTimeOnAirUs(FRAME_LENGTH) / 1000 + 1;
+    BusyPeriod traffic[8];
+    for (size_t i = 0; i < 8; i++) {
+        traffic[i].from = i * 150;
+        traffic[i].to = i * 150 + airMs;
+    }
+    LoRaComm radio;
+    startRadio(radio, traffic, 8);
+
+    long sent = sendFrame(radio, frame);
+    printf("  periodic traffic: sent at %ld ms after %u busy checks\n",
+           sent, radio.getListenBeforeTalk().getBusy());
+    CHECK(sent > 0);
+    CHECK(radio.getListenBeforeTalk().getBusy() > 0);
+    CHECK(!channelBusy(sent - 2));
+}
+
+void testGiveUp(const uint8_t* frame) {
+    const BusyPeriod traffic[] = {{0, 100000}};
+    LoRaComm radio;
+    startRadio(radio, traffic, 1);
+
+    long sent = sendFrame(radio, frame);
+    unsigned long slotMs = radio.getAirtimeUs(FRAME_LENGTH) / 1000 + 1;
+    printf("  busy for good: gave up at %lu ms\n", millis());
+    CHECK(sent == -1);
+    CHECK(radio.getListenBeforeTalk().getGaveUp() == 1);
+    CHECK(millis() >= LBT_MAX_WAIT_MS);
+    CHECK(millis() < LBT_MAX_WAIT_MS + (1UL << LBT_MAX_BACKOFF_EXP) * slotMs + 20);
+    CHECK(mockRadio.getTransmissions() == 0);
+
+    // The next frame starts over on a channel that has cleared
+    setTraffic(nullptr, 0);
+    CHECK(sendFrame(radio, frame) >= 0);
+}
+
+void testReceptionUnderWay() {
+    LoRaComm radio;
+    startRadio(radio, nullptr, 0);
+
+    // Modem locked on a preamble: busy without cutting it off with CAD
+    mockRadio.setRegister(MOCK_REG_MODEM_STAT, 0x01);
+    unsigned long wait = radio.checkChannel(FRAME_LENGTH);
+    CHECK(wait > 0 && wait != LBT_GIVE_UP);
+    CHECK(mockRadio.getCadCycles() == 0);
+    CHECK(radio.getListenBeforeTalk().getBusy() == 1);
+}
+
+void testStaleResult() {
+    LoRaComm radio;
+    startRadio(radio, nullptr, 0);
+
+    // A result left over while the frame was dropped is not used later
+    CHECK(radio.checkChannel(FRAME_LENGTH) > 0);
+    mockAdvance(100);
+    CHECK(radio.checkChannel(FRAME_LENGTH) > 0);
+    CHECK(mockRadio.getCadCycles() == 2);
+    mockAdvance(5);
+    CHECK(radio.checkChannel(FRAME_LENGTH) == 0);
+}
+
+// ===== Contention =====
+
+// Nodes that wake within 200 ms of each other each send one frame.
+// CAD samples the channel when it starts and reports two symbols later.
+void simulateContention(bool sense, SimRandom& rng) {
+    const unsigned long airMs = loraTimeOnAirUs(FRAME_LENGTH) / 1000 + 1;
+    const unsigned long cadMs = 3;
+    const unsigned long NEVER = (unsigned long)-1;
+
+    uint32_t sent = 0;
+    uint32_t collided = 0;
+    uint32_t dropped = 0;
+    unsigned long delayMs = 0;
+
+    for (int round = 0; round < CONTENTION_ROUNDS; round++) {
+        ListenBeforeTalk lbt[CONTENTION_NODES];
+        unsigned long wake[CONTENTION_NODES];
+        unsigned long ready[CONTENTION_NODES];
+        unsigned long start[CONTENTION_NODES];
+        bool sensing[CONTENTION_NODES];
+        bool sensedBusy[CONTENTION_NODES];
+        bool done[CONTENTION_NODES];
+
+        mockSetMillis(0);
+        for (int i = 0; i < CONTENTION_NODES; i++) {
+            lbt[i].setEnabled(sense);
+            wake[i] = ready[i] = rng.below(200);
+            start[i] = NEVER;
+            sensing[i] = sensedBusy[i] = done[i] = false;
+        }
+
+        for (unsigned long t = 0; t < 10000; t++, mockAdvance(1)) {
+            for (int i = 0; i < CONTENTION_NODES; i++) {
+                if (done[i] || t < ready[i]) {
+                    continue;
+                }
+                if (!sense) {
+                    start[i] = t;
+                    done[i] = true;
+                } else if (!sensing[i]) {
+                    sensedBusy[i] = false;
+                    for (int j = 0; j < CONTENTION_NODES; j++) {
+                        if (start[j] != NEVER && t >= start[j] && t < start[j] + airMs) {
+                            sensedBusy[i] = true;
+                        }
+                    }
+                    sensing[i] = true;
+                    ready[i] = t + cadMs;
+                } else {
+                    sensing[i] = false;
+                    unsigned long wait = lbt[i].next(sensedBusy[i], airMs);
+                    if (wait == 0) {
+                        start[i] = t;
+                        done[i] = true;
+                    } else if (wait == LBT_GIVE_UP) {
+                        done[i] = true;
+                    } else {
+                        ready[i] = t + wait;
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < CONTENTION_NODES; i++) {
+            if (start[i] == NEVER) {
+                dropped++;
+                continue;
+            }
+            sent++;
+            delayMs += start[i] - wake[i];
+            for (int j = 0; j < CONTENTION_NODES; j++) {
+                if (j != i && start[j] != NEVER && start[j] < start[i] + airMs && start[i] < start[j] + airMs) {
+                    collided++;
+                    break;
+                }
+            }
+        }
+    }
+
+    uint32_t frames = CONTENTION_NODES * CONTENTION_ROUNDS;
+    printf("  %-5s %u frames: %u collided (%.1f%%), %u dropped, mean delay %.0f ms\n",
+           sense ? "LBT" : "blind", frames, collided, 100.0 * collided / frames, dropped,
+           sent ? (double)delayMs / sent : 0.0);
+
+    if (sense) {
+        // Only nodes sensing within one CAD cycle of each other collide
+        CHECK(collided * 4 < frames);
+        CHECK(dropped * 100 < frames);
+    } else {
+        CHECK(dropped == 0);
+    }
+}
+
+int main() {
+    uint8_t frame[FRAME_LENGTH];
+    for (size_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (uint8_t)i;
+    }
+
+    printf("LoRaComm::checkChannel()\n");
+    testClearChannel(frame);
+    testBusyPeriod(frame);
+    testTraffic(frame);
+    testGiveUp(frame);
+    testReceptionUnderWay();
+    testStaleResult();
+
+    printf("Contention (%u nodes waking within 200 ms, %u rounds)\n", CONTENTION_NODES, CONTENTION_ROUNDS);
+    SimRandom blindRng(7);
+    SimRandom lbtRng(7);
+    simulateContention(false, blindRng);
+    simulateContention(true, lbtRng);
+    printf("ok\n");
+    return 0;
+}
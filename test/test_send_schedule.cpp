@@ -0,0 +1,171 @@
+// Periodic senders sharing one channel: delivery ratio of a fixed grid
+// from boot against SendSchedule (jitter, or address slots with
+// SEND_SLOTTED) for 10 to 80 nodes that power up together.
+// Pure collision channel: any overlap loses every frame involved.
+
+#include "host_test.h"
+#include "DutyCycle.h"
+#include "SendSchedule.h"
+#include <algorithm>
+#include <vector>
+
+#define SEND_INTERVAL 5000          // As in the sender firmware
+#define BEACON_INTERVAL_MS 60000    // Receiver built with SLOT_BEACON_INTERVAL_MS 60000
+#define FRAME_LENGTH 26             // Joined snapshot (short address, 4 readings)
+#define SIM_DURATION_MS 3600000.0
+#define BOOT_SPREAD_MS 20           // Nodes powered up together
+#define CLOCK_SKEW_PPM 100          // Crystal tolerance, either way
+
+enum Mode { FIXED_GRID, SCHEDULE, SCHEDULE_BEACON };
+
+// One node: its own clock (boot offset and skew against the channel's)
+struct Node {
+    SendSchedule* schedule;
+    double boot;
+    double skew;
+    double nextSend;  // Channel time
+
+    double toLocal(double global) const { return (global - boot) * (1 + skew); }
+    double toGlobal(double local) const { return local / (1 + skew) + boot; }
+
+    // Run the node's millis() at this channel time
+    void setClock(double global) const { mockSetMillis((unsigned long)toLocal(global)); }
+};
+
+struct Transmission {
+    double start;
+    int node;  // -1: beacon
+
+    bool operator<(const Transmission& other) const { return start < other.start; }
+};
+
+// ===== Simulation =====
+
+// Share of node frames that went out without overlapping another frame
+double simulate(int count, Mode mode, uint32_t seed) {
+    const double airMs = loraTimeOnAirUs(FRAME_LENGTH) / 1000.0;
+    SimRandom rng(seed);
+    std::vector<Node> nodes(count);
+    std::vector<Transmission> air;
+
+    for (int i = 0; i < count; i++) {
+        Node& node = nodes[i];
+        node.schedule = new SendSchedule(SEND_INTERVAL);
+        node.boot = rng.below(BOOT_SPREAD_MS);
+        node.skew = ((int)rng.below(2 * CLOCK_SKEW_PPM + 1) - CLOCK_SKEW_PPM) * 1e-6;
+
+        char name[16];
+        snprintf(name, sizeof(name), "node%d", i);
+        mockSetMillis(0);
+        node.schedule->begin(name);
+        node.schedule->setAddress(MSG_ADDR_FIRST_NODE + i);
+        node.schedule->recordAirtime(loraTimeOnAirUs(FRAME_LENGTH));
+
+        // First send decided once setup is done
+        double local = 1800;
+        mockSetMillis((unsigned long)local);
+        local += (mode == FIXED_GRID) ? SEND_INTERVAL : node.schedule->next();
+        node.nextSend = node.toGlobal(local);
+    }
+
+    double nextBeacon = (mode == SCHEDULE_BEACON) ? 1000 : SIM_DURATION_MS;
+    for (;;) {
+        int k = 0;
+        for (int i = 1; i < count; i++) {
+            if (nodes[i].nextSend < nodes[k].nextSend) {
+                k = i;
+            }
+        }
+
+        // The beacon goes first once every node has planned past it
+        if (nextBeacon < SIM_DURATION_MS && nextBeacon <= nodes[k].nextSend) {
+            air.push_back({nextBeacon, -1});
+            for (Node& node : nodes) {
+                node.setClock(nextBeacon + airMs);
+                node.schedule->sync((unsigned long)node.toLocal(nextBeacon), SEND_INTERVAL);
+            }
+            nextBeacon += BEACON_INTERVAL_MS;
+            continue;
+        }
+
+        Node& node = nodes[k];
+        if (node.nextSend > SIM_DURATION_MS) {
+            break;
+        }
+        air.push_back({node.nextSend, k});
+
+        if (mode == FIXED_GRID) {
+            node.nextSend += SEND_INTERVAL / (1 + node.skew);
+        } else {
+            node.setClock(node.nextSend);
+            node.nextSend = node.toGlobal(millis() + node.schedule->next());
+        }
+    }
+
+    // Overlaps show up between neighbours in start order
+    std::sort(air.begin(), air.end());
+    uint32_t delivered = 0;
+    uint32_t total = 0;
+    for (size_t i = 0; i < air.size(); i++) {
+        if (air[i].node < 0) {
+            continue;
+        }
+        total++;
+        bool collided = (i > 0 && air[i].start - air[i - 1].start < airMs) ||
+                        (i + 1 < air.size() && air[i + 1].start - air[i].start < airMs);
+        if (!collided) {
+            delivered++;
+        }
+    }
+
+    for (Node& node : nodes) {
+        delete node.schedule;
+    }
+    return (double)delivered / total;
+}
+
+// Best a slotted period can do: nodes alone in their address slot
+double slotBound(int count) {
+    SendSchedule schedule(SEND_INTERVAL);
+    schedule.setAddress(MSG_ADDR_FIRST_NODE);
+    schedule.recordAirtime(loraTimeOnAirUs(FRAME_LENGTH));
+    int slots = schedule.getSlotCount() - 1;  // Slot 0 is the beacon's
+    if (slots <= 0) {
+        return 0;
+    }
+    int shared = count > slots ? count - slots : 0;
+    int alone = slots - shared > 0 ? slots - shared : 0;
+    return count <= slots ? 1.0 : (double)alone / count;
+}
+
+int main() {
+    printf("%s build, %u ms frames every %u ms\n", SEND_SLOTTED ? "Slotted" : "Jitter",
+           (unsigned)(loraTimeOnAirUs(FRAME_LENGTH) / 1000), SEND_INTERVAL);
+
+    const int counts[] = {10, 50, 80};
+    for (int count : counts) {
+        double fixed = simulate(count, FIXED_GRID, 1);
+        double scheduled = simulate(count, SCHEDULE, 1);
+
+        #if SEND_SLOTTED
+            double beacon = simulate(count, SCHEDULE_BEACON, 1);
+            double bound = slotBound(count);
+            printf("  %2d nodes: fixed grid %5.1f%%, slots on local clock %5.1f%%, slots with beacon %5.1f%% "
+                   "(alone in a slot %5.1f%%)\n", count, 100 * fixed, 100 * scheduled, 100 * beacon, 100 * bound);
+
+            // Beacons undo the drift: only nodes sharing a slot collide
+            CHECK(beacon >= scheduled);
+            CHECK(beacon > fixed + 0.4);
+            CHECK(beacon > bound - 0.01);
+        #else
+            printf("  %2d nodes: fixed grid %5.1f%%, jitter %5.1f%%\n", count, 100 * fixed, 100 * scheduled);
+
+            // Lockstep nodes lose nearly everything; jitter spreads them
+            CHECK(fixed < 0.2);
+            CHECK(scheduled > fixed + 0.1);
+        #endif
+    }
+
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Compact readings on air: fixed-point values round-trip at the sensor's
+// resolution, out-of-range values saturate and NaN arrives as NaN, in
+// compact and batch frames
+
+#include "host_test.h"
+#include "MessageProtocol.h"
+
+#define SHORT_ADDRESS 0x12
+
+MessageProtocol protocol;
+
+// Reading after one compact frame through encode and decode
+float roundTrip(uint8_t sensorId, float value) {
+    uint8_t buffer[MSG_MAX_PACKET_SIZE];
+    size_t len = protocol.encodeSensorCompact(SHORT_ADDRESS, sensorId, value, buffer);
+    CHECK(len > 0);
+
+    MessageView view;
+    SensorData data;
+    CHECK(protocol.decodeView(buffer, len, view));
+    CHECK(view.type() == MSG_SENSOR_COMPACT);
+    CHECK(protocol.parseSensorCompact(view, data));
+    CHECK(data.sensorId == sensorId);
+    return data.value;
+}
+
+// ===== Scenarios =====
+
+void testResolution() {
+    // Two decimals for every sensor in the dictionary
+    const float values[] = {0.0f, 25.34f, -12.5f, 3.87f, 1013.25f, -0.01f, 0.004f};
+    for (float value : values) {
+        float decoded = roundTrip(SENSOR_TEMPERATURE, value);
+        CHECK(fabsf(decoded - value) <= 0.005f + fabsf(value) * 1e-6f);
+    }
+}
+
+void testSaturation() {
+    // Scaled past the int32 range: clamped, sign kept
+    const float large[] = {3e7f, 1e30f, INFINITY};
+    for (float value : large) {
+        float high = roundTrip(SENSOR_PRESSURE, value);
+        float low = roundTrip(SENSOR_PRESSURE, -value);
+        printf("  %g -> %g, %g -> %g\n", value, high, -value, low);
+        CHECK(high == (float)INT32_MAX / 100);
+        CHECK(low == -(float)INT32_MAX / 100);
+    }
+
+    // Just inside the range is not clamped
+    CHECK(roundTrip(SENSOR_PRESSURE, 2e7f) == 2e7f);
+}
+
+void testNan() {
+    // A failed sensor read stays recognisable at the receiver
+    CHECK(isnan(roundTrip(SENSOR_HUMIDITY, NAN)));
+    CHECK(!isnan(roundTrip(SENSOR_HUMIDITY, -(float)INT32_MAX / 100)));
+}
+
+void testBatch() {
+    const SensorReading readings[] = {
+        {SENSOR_TEMPERATURE, 21.5f},
+        {SENSOR_HUMIDITY, NAN},
+        {SENSOR_BATTERY, -INFINITY},
+        {SENSOR_PRESSURE, 1013.25f},
+    };
+    uint8_t buffer[MSG_MAX_PACKET_SIZE];
+    size_t len = protocol.encodeSensorBatch(SHORT_ADDRESS, readings, 4, buffer);
+    CHECK(len > 0);
+
+    MessageView view;
+    SensorBatch batch;
+    CHECK(protocol.decodeView(buffer, len, view));
+    CHECK(protocol.parseSensorBatch(view, batch));
+    CHECK(batch.count == 4);
+    CHECK(batch.readings[0].value == 21.5f);
+    CHECK(isnan(batch.readings[1].value));
+    CHECK(batch.readings[2].value == -(float)INT32_MAX / 100);
+    CHECK(batch.readings[3].value == 1013.25f);
+}
+
+int main() {
+    printf("Compact readings\n");
+    testResolution();
+    testSaturation();
+    testNan();
+    testBatch();
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,180 @@
+// SPI traffic of SX1278Fifo burst access against the per-byte pattern of
+// the LoRa library (LoRa.write()/LoRa.read()), counted on a mocked bus
+// with an SX1278 register/FIFO model behind it
+
+#include "host_test.h"
+#include "MockSx1278.h"
+#include "SX1278Fifo.h"
+
+SX1278Fifo fifo;
+
+struct Traffic {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t calls;
+};
+
+Traffic measure(const MockSpiCounters& before) {
+    const MockSpiCounters& after = SPI.getCounters();
+    Traffic traffic = {
+        after.transactions - before.transactions,
+        after.bytes - before.bytes,
+        after.calls - before.calls,
+    };
+    return traffic;
+}
+
+void printRow(const char* path, uint8_t length, const Traffic& traffic) {
+    printf("  %-22s %3u bytes: %4u transactions, %4u bytes clocked, %4u calls\n",
+           path, length, traffic.transactions, traffic.bytes, traffic.calls);
+}
+
+// ===== Per-Byte Reference =====
+
+// LoRa.beginPacket() .. LoRa.write(buffer, size): one register write per byte
+void writePerByte(const uint8_t* data, uint8_t length) {
+    uint8_t current = fifo.readRegister(MOCK_REG_PAYLOAD_LENGTH);
+    for (uint8_t i = 0; i < length; i++) {
+        fifo.writeRegister(MOCK_REG_FIFO, data[i]);
+    }
+    fifo.writeRegister(MOCK_REG_PAYLOAD_LENGTH, current + length);
+}
+
+// while (LoRa.available()) LoRa.read(): read() checks available() again
+void readPerByte(uint8_t* buffer) {
+    uint8_t index = 0;
+    while (fifo.readRegister(MOCK_REG_RX_NB_BYTES) > index) {
+        if (fifo.readRegister(MOCK_REG_RX_NB_BYTES) > index) {
+            buffer[index++] = fifo.readRegister(MOCK_REG_FIFO);
+        }
+    }
+}
+
+// ===== Transmit =====
+
+void testWrite(const uint8_t* data, uint8_t length) {
+    // Burst path
+    mockRadio.reset();
+    fifo.writeRegister(MOCK_REG_FIFO_ADDR_PTR, mockRadio.getRegister(MOCK_REG_FIFO_TX_BASE_ADDR));
+    fifo.resetStats();
+    MockSpiCounters before = SPI.getCounters();
+
+    fifo.writePacket(data, length);
+    Traffic burst = measure(before);
+
+    CHECK(mockRadio.txLength() == length);
+    CHECK(memcmp(mockRadio.txPayload(), data, length) == 0);
+
+    // FIFO burst plus the RegPayloadLength write
+    CHECK(burst.transactions == 2);
+    CHECK(burst.bytes == 1u + length + 2);
+    #if defined(ESP32)
+        CHECK(burst.calls == 1u + 1 + 2);
+    #else
+        CHECK(burst.calls == 1u + (length + 31) / 32 + 2);
+    #endif
+
+    // The layer's own counters agree with the bus
+    CHECK(fifo.getStats().transactions == burst.transactions);
+    CHECK(fifo.getStats().bytes == burst.bytes);
+    CHECK(fifo.getStats().packets == 1);
+
+    // Per-byte reference
+    mockRadio.reset();
+    fifo.writeRegister(MOCK_REG_FIFO_ADDR_PTR, mockRadio.getRegister(MOCK_REG_FIFO_TX_BASE_ADDR));
+    before = SPI.getCounters();
+
+    writePerByte(data, length);
+    Traffic perByte = measure(before);
+
+    CHECK(mockRadio.txLength() == length);
+    CHECK(memcmp(mockRadio.txPayload(), data, length) == 0);
+    CHECK(perByte.transactions == length + 2u);
+
+    printRow("write, burst", length, burst);
+    printRow("write, per byte", length, perByte);
+}
+
+// ===== Receive =====
+
+void testRead(const uint8_t* data, uint8_t length) {
+    uint8_t buffer[256];
+
+    // Burst path
+    mockRadio.reset();
+    mockRadio.receive(data, length);
+    CHECK(fifo.seekRxPacket() == length);
+    MockSpiCounters before = SPI.getCounters();
+
+    memset(buffer, 0, sizeof(buffer));
+    CHECK(fifo.readPacket(buffer, length) == length);
+    Traffic burst = measure(before);
+
+    CHECK(memcmp(buffer, data, length) == 0);
+    CHECK(burst.transactions == 1);
+    CHECK(burst.bytes == 1u + length);
+
+    // Header peek then the rest continues from the same FIFO position
+    CHECK(fifo.seekRxPacket() == length);
+    memset(buffer, 0, sizeof(buffer));
+    uint8_t head = length < 4 ? length : 4;
+    CHECK(fifo.readFifo(buffer, head) == head);
+    fifo.readPacket(buffer + head, length - head);
+    CHECK(memcmp(buffer, data, length) == 0);
+
+    // Per-byte reference
+    mockRadio.reset();
+    mockRadio.receive(data, length);
+    CHECK(fifo.seekRxPacket() == length);
+    before = SPI.getCounters();
+
+    memset(buffer, 0, sizeof(buffer));
+    readPerByte(buffer);
+    Traffic perByte = measure(before);
+
+    CHECK(memcmp(buffer, data, length) == 0);
+    CHECK(perByte.transactions == 3u * length + 1);
+
+    printRow("read, burst", length, burst);
+    printRow("read, per byte", length, perByte);
+}
+
+// ===== IRQ Flags =====
+
+void testIrqFlags() {
+    mockRadio.reset();
+    mockRadio.setRegister(MOCK_REG_IRQ_FLAGS,
+                          SX1278_IRQ_RX_DONE | SX1278_IRQ_TX_DONE | SX1278_IRQ_CAD_DONE);
+
+    // Only the masked flags are taken; the rest stay for their owner
+    CHECK(fifo.takeIrqFlags(SX1278_IRQ_CAD_DONE | SX1278_IRQ_CAD_DETECTED) == SX1278_IRQ_CAD_DONE);
+    CHECK(mockRadio.getRegister(MOCK_REG_IRQ_FLAGS) == (SX1278_IRQ_RX_DONE | SX1278_IRQ_TX_DONE));
+    CHECK(fifo.takeIrqFlags(SX1278_IRQ_CAD_DONE) == 0);
+}
+
+int main() {
+    SPI.begin();
+    fifo.begin(LORA_NSS, SPI);
+
+    uint8_t data[255];
+    SimRandom fill(0xF1F0);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)fill.next();
+    }
+
+    #if defined(ESP32)
+        printf("ESP32 path (writeBytes/transferBytes)\n");
+    #else
+        printf("Arduino core path (transfer(buffer, count))\n");
+    #endif
+
+    const uint8_t lengths[] = {1, 16, 33, 64, 255};
+    for (uint8_t length : lengths) {
+        testWrite(data, length);
+        testRead(data, length);
+    }
+
+    testIrqFlags();
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Time on air of one full sensor snapshot: a single batch frame against
+// rotating one compact frame per sensor, across spreading factors, with
+// the device named inline and with a joined short address
+
+#include "host_test.h"
+#include "DutyCycle.h"
+#include "MessageProtocol.h"
+
+#define DEVICE_NAME "sender1"
+#define SHORT_ADDRESS 0x12
+
+const SensorReading SNAPSHOT[] = {
+    {SENSOR_TEMPERATURE, 25.34f},
+    {SENSOR_HUMIDITY, 65.2f},
+    {SENSOR_BATTERY, 3.87f},
+    {SENSOR_PRESSURE, 1013.25f},
+};
+const uint8_t SNAPSHOT_COUNT = sizeof(SNAPSHOT) / sizeof(SNAPSHOT[0]);
+
+MessageProtocol protocol;
+
+// ===== Airtime Model =====
+
+// Semtech AN1200.13 in floating point, to check the integer version
+double referenceTimeOnAirUs(size_t length, uint8_t sf, double bandwidth, uint8_t codingRate, uint16_t preamble) {
+    bool ldro = loraLowDataRateOptimize(sf, (uint32_t)bandwidth);
+    double symbolUs = (double)(1UL << sf) / bandwidth * 1e6;
+    double bits = 8.0 * length - 4.0 * sf + 28 + 16;
+    double payloadSymbols = 8 + fmax(ceil(bits / (4.0 * (sf - (ldro ? 2 : 0)))) * codingRate, 0);
+    return (preamble + 4.25 + payloadSymbols) * symbolUs;
+}
+
+void testTimeOnAir() {
+    static_assert(loraTimeOnAirUs(10, 7, 125000, 5, 8, true, false, false) == 41216, "SF7 reference");
+
+    const uint32_t bandwidths[] = {62500, 125000, 250000};
+    for (uint32_t bandwidth : bandwidths) {
+        for (uint8_t sf = 7; sf <= 12; sf++) {
+            for (size_t length = 0; length <= 255; length++) {
+                double expected = referenceTimeOnAirUs(length, sf, bandwidth, 5, 8);
+                uint32_t actual = loraTimeOnAirUs(length, sf, bandwidth, 5, 8, true, false,
+                                                  loraLowDataRateOptimize(sf, bandwidth));
+                CHECK(fabs(actual - expected) < 1.0);
+            }
+        }
+    }
+}
+
+// ===== Snapshot vs Rotation =====
+
+struct Frames {
+    size_t snapshotBytes;
+    size_t rotationBytes;  // All compact frames of one rotation
+    size_t rotationFrames[SNAPSHOT_COUNT];
+};
+
+Frames encodeFrames(bool joined) {
+    Frames frames = {};
+    uint8_t frame[MSG_MAX_PACKET_SIZE];
+    MessageView view;
+
+    frames.snapshotBytes = joined
+        ? protocol.encodeSensorBatch(SHORT_ADDRESS, SNAPSHOT, SNAPSHOT_COUNT, frame)
+        : protocol.encodeSensorBatch(DEVICE_NAME, SNAPSHOT, SNAPSHOT_COUNT, frame);
+    CHECK(frames.snapshotBytes > 0);
+
+    // The batch carries every reading
+    SensorBatch batch;
+    CHECK(protocol.decodeView(frame, frames.snapshotBytes, view));
+    CHECK(protocol.parseSensorBatch(view, batch));
+    CHECK(batch.count == SNAPSHOT_COUNT);
+    for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+        CHECK(batch.readings[i].sensorId == SNAPSHOT[i].sensorId);
+        CHECK(fabs(batch.readings[i].value - SNAPSHOT[i].value) < 0.01f);
+    }
+
+    for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+        size_t length = joined
+            ? protocol.encodeSensorCompact(SHORT_ADDRESS, SNAPSHOT[i].sensorId, SNAPSHOT[i].value, frame)
+            : protocol.encodeSensorCompact(DEVICE_NAME, SNAPSHOT[i].sensorId, SNAPSHOT[i].value, frame);
+        CHECK(length > 0);
+
+        SensorData data;
+        CHECK(protocol.decodeView(frame, length, view));
+        CHECK(protocol.parseSensorCompact(view, data));
+        CHECK(data.sensorId == SNAPSHOT[i].sensorId);
+
+        frames.rotationFrames[i] = length;
+        frames.rotationBytes += length;
+    }
+    return frames;
+}
+
+void compare(const char* label, const Frames& frames) {
+    printf("%s: snapshot %u bytes, rotation %u frames / %u bytes\n", label,
+           (unsigned)frames.snapshotBytes, SNAPSHOT_COUNT, (unsigned)frames.rotationBytes);
+
+    for (uint8_t sf = 7; sf <= 12; sf++) {
+        bool ldro = loraLowDataRateOptimize(sf, 125000);
+        uint32_t snapshotUs = loraTimeOnAirUs(frames.snapshotBytes, sf, 125000, 5, 8, true, false, ldro);
+        uint32_t rotationUs = 0;
+        for (uint8_t i = 0; i < SNAPSHOT_COUNT; i++) {
+            rotationUs += loraTimeOnAirUs(frames.rotationFrames[i], sf, 125000, 5, 8, true, false, ldro);
+        }
+
+        // Snapshots per duty-cycle window against full rotations
+        printf("  SF%-2u %8.1f ms vs %8.1f ms (%3.0f%%), %5u vs %5u snapshots per %u s at %u permille\n",
+               sf, snapshotUs / 1000.0, rotationUs / 1000.0, 100.0 * snapshotUs / rotationUs,
+               (unsigned)(DUTY_CYCLE_BUDGET_US / snapshotUs), (unsigned)(DUTY_CYCLE_BUDGET_US / rotationUs),
+               DUTY_CYCLE_WINDOW_S, DUTY_CYCLE_PERMILLE);
+
+        // One preamble and header instead of four pays off at every SF
+        CHECK(snapshotUs < rotationUs);
+    }
+}
+
+int main() {
+    protocol.setLocalAddress(SHORT_ADDRESS);
+    testTimeOnAir();
+
+    Frames named = encodeFrames(false);
+    Frames joined = encodeFrames(true);
+    compare("Named device", named);
+    compare("Joined (short address)", joined);
+
+    // The short address removes the name from every frame
+    CHECK(joined.snapshotBytes < named.snapshotBytes);
+    CHECK(joined.rotationBytes < named.rotationBytes);
+
+    // The board's configuration uses the same model
+    CHECK(loraTimeOnAirUs(joined.snapshotBytes) ==
+          loraTimeOnAirUs(joined.snapshotBytes, LORA_SPREADING_FACTOR, (uint32_t)LORA_SIGNAL_BANDWIDTH,
+                          LORA_CODING_RATE, LORA_PREAMBLE_LENGTH, true, false,
+                          loraLowDataRateOptimize(LORA_SPREADING_FACTOR, (uint32_t)LORA_SIGNAL_BANDWIDTH)));
+    printf("ok\n");
+    return 0;
+}